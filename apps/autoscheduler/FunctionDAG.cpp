@@ -595,6 +595,16 @@ FunctionDAG::FunctionDAG(const vector<Function> &outputs, const MachineParams &p
         node_map[f] = &nodes[i];
     }
 
+    // The bounds of the values of every Func, both symbolic and with the
+    // parameter estimates applied. These only depend on the pipeline, so
+    // compute them once rather than for every stage.
+    const FuncValueBounds func_value_bounds = compute_function_value_bounds(order, env);
+    FuncValueBounds func_value_bounds_with_estimates = func_value_bounds;
+    for (auto &p : func_value_bounds_with_estimates) {
+        p.second.min = apply_param_estimates.mutate(p.second.min);
+        p.second.max = apply_param_estimates.mutate(p.second.max);
+    }
+
     int stage_count = 0;
 
     for (size_t i = order.size(); i > 0; i--) {
@@ -650,7 +660,6 @@ FunctionDAG::FunctionDAG(const vector<Function> &outputs, const MachineParams &p
                 node.region_computed.resize(consumer.dimensions());
             }
 
-            FuncValueBounds func_value_bounds = compute_function_value_bounds(order, env);
             for (int j = 0; j < consumer.dimensions(); j++) {
                 // The region computed always uses the full extent of the rvars
                 Interval in = bounds_of_expr_in_scope(def.args()[j], stage_scope_with_concrete_rvar_bounds, func_value_bounds);
@@ -887,11 +896,6 @@ FunctionDAG::FunctionDAG(const vector<Function> &outputs, const MachineParams &p
 
             exprs = apply_param_estimates.mutate(exprs);
 
-            for (auto &p : func_value_bounds) {
-                p.second.min = apply_param_estimates.mutate(p.second.min);
-                p.second.max = apply_param_estimates.mutate(p.second.max);
-            }
-
             // For this stage scope we want symbolic bounds for the rvars
 
             // Now create the edges that lead to this func
@@ -901,7 +905,7 @@ FunctionDAG::FunctionDAG(const vector<Function> &outputs, const MachineParams &p
             // TODO: peephole the boundary condition call pattern instead of assuming the user used the builtin
             node.is_boundary_condition = node.is_pointwise && starts_with(node.func.name(), "repeat_edge");
 
-            auto boxes = boxes_required(exprs, stage_scope_with_symbolic_rvar_bounds, func_value_bounds);
+            auto boxes = boxes_required(exprs, stage_scope_with_symbolic_rvar_bounds, func_value_bounds_with_estimates);
             for (auto &p : boxes) {
                 auto it = env.find(p.first);
                 if (it != env.end() && p.first != consumer.name()) {
@@ -1,5 +1,6 @@
 #include "FunctionDAG.h"
 #include "Halide.h"
+#include "halide_benchmark.h"
 #include <sstream>
 
 using namespace Halide;
@@ -162,6 +163,35 @@ void test_matmul(const MachineParams &params, const Target &target) {
               << "\n\nwithout_extern:\n " << without_extern.str() << "\n";
 }
 
+// Time the construction of the FunctionDAG for a deep stencil
+// pipeline. Most of the time goes into the bounds queries for every
+// stage, so this tracks the cost of bounds inference in the
+// autoscheduler.
+void test_deep_pipeline(const MachineParams &params, const Target &target) {
+    Var x("x"), y("y");
+    ImageParam input(Float(32), 2, "input");
+    input.dim(0).set_estimate(0, 2048);
+    input.dim(1).set_estimate(0, 2048);
+
+    const int stages = 64;
+    std::vector<Func> fs(stages);
+    fs[0](x, y) = input(x, y);
+    for (int i = 1; i < stages; i++) {
+        Func blur_x;
+        blur_x(x, y) = fs[i - 1](x - 1, y) + fs[i - 1](x, y) * 2 + fs[i - 1](x + 1, y);
+        fs[i](x, y) = blur_x(x, y - 1) + blur_x(x, y) * 2 + blur_x(x, y + 1);
+    }
+    fs.back().set_estimate(x, 0, 2000).set_estimate(y, 0, 2000);
+
+    std::vector<Halide::Internal::Function> v;
+    v.push_back(fs.back().function());
+    double t = Halide::Tools::benchmark(3, 1, [&]() {
+        Halide::Internal::Autoscheduler::FunctionDAG d(v, params, target);
+    });
+    std::cout << "FunctionDAG construction for " << stages
+              << " stages: " << t * 1e3 << " ms\n";
+}
+
 int main(int argc, char **argv) {
     // Use a fixed target for the analysis to get consistent results from this test.
     MachineParams params(32, 16000000, 40);
@@ -169,6 +199,7 @@ int main(int argc, char **argv) {
 
     test_coeff_wise(params, target);
     test_matmul(params, target);
+    test_deep_pipeline(params, target);
 
     return 0;
 }
@@ -18,8 +18,10 @@ public:
         h.define_extern("an_extern_stage", {f}, Int(16), 0, NameMangling::C);
         output(x, y) = cast<uint16_t>(max(0, f(y, x) + f(x, y) + an_extern_func(x, y) + h()));
 
-        f.compute_root().vectorize(x, 8);
+        // The parallel loops become OpenMP parallel loops in the C output.
+        f.compute_root().vectorize(x, 8).parallel(y);
         h.compute_root();
+        output.parallel(y);
     }
 };
 
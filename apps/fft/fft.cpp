@@ -6,7 +6,9 @@
 
 #include <cassert>
 #include <cmath>
+#include <complex>
 #include <cstddef>
+#include <cstdint>
 #include <limits>
 #include <map>
 #include <ostream>
@@ -62,6 +64,12 @@ int product(const vector<int> &R) {
     return p;
 }
 
+// Radices larger than this are too expensive to compute directly; FFTs
+// with such a factor use Bluestein's algorithm instead.
+const int kMaxDirectRadix = 16;
+
+vector<int> radix_factor(int N);
+
 // These tersely named functions concatenate vectors of Var/Expr for use
 // in generating argument lists to Halide functions. They are named to avoid
 // bloating the code, since these are used extremely frequently, and often many
@@ -290,6 +298,10 @@ ComplexFunc twiddle_factors(int N, Expr gain, int sign,
     return W;
 }
 
+ComplexFunc bluestein_dim1(ComplexFunc x, int N, int sign, int extent_0,
+                           Expr gain, bool parallel, const string &prefix,
+                           const Target &target);
+
 // Compute the N point DFT of dimension 1 (columns) of x using
 // radix R.
 ComplexFunc fft_dim1(ComplexFunc x,
@@ -303,6 +315,12 @@ ComplexFunc fft_dim1(ComplexFunc x,
                      TwiddleFactorSet *twiddle_cache) {
     int N = product(NR);
 
+    for (int R : NR) {
+        if (R > kMaxDirectRadix) {
+            return bluestein_dim1(x, N, sign, extent_0, gain, parallel, prefix, target);
+        }
+    }
+
     vector<Var> args = x.args();
     Var n0(args[0]), n1(args[1]);
     args.erase(args.begin());
@@ -420,6 +438,112 @@ ComplexFunc fft_dim1(ComplexFunc x,
     return x;
 }
 
+// A simple radix 2 FFT in double precision, used to precompute constant
+// transforms when building the pipeline. The size of x must be a power of 2.
+void reference_fft(vector<std::complex<double>> &x, int sign) {
+    const int n = (int)x.size();
+    for (int i = 1, k = 0; i < n; i++) {
+        int bit = n >> 1;
+        for (; k & bit; bit >>= 1) {
+            k ^= bit;
+        }
+        k ^= bit;
+        if (i < k) {
+            std::swap(x[i], x[k]);
+        }
+    }
+    for (int len = 2; len <= n; len *= 2) {
+        for (int i = 0; i < n; i += len) {
+            for (int k = 0; k < len / 2; k++) {
+                std::complex<double> w = std::polar(1.0, sign * 2 * M_PI * k / len);
+                std::complex<double> u = x[i + k];
+                std::complex<double> v = x[i + k + len / 2] * w;
+                x[i + k] = u + v;
+                x[i + k + len / 2] = u - v;
+            }
+        }
+    }
+}
+
+// Compute the N point DFT of dimension 1 of x using Bluestein's
+// algorithm. Rewriting nk = (n^2 + k^2 - (k - n)^2) / 2 turns the DFT
+// into a convolution with a chirp c_n = e^(sign*pi*j*n^2/N):
+//
+//   X_k = c_k * sum[ (x_n c_n) (c_(k-n))* ]
+//
+// The convolution is computed with FFTs of a power of 2 size M >= 2N - 1,
+// so this works for any N, and in particular for large primes.
+ComplexFunc bluestein_dim1(ComplexFunc x, int N, int sign, int extent_0,
+                           Expr gain, bool parallel, const string &prefix,
+                           const Target &target) {
+    int M = 1;
+    while (M < 2 * N - 1) {
+        M *= 2;
+    }
+
+    vector<Var> args = x.args();
+    Var n0(args[0]), n1(args[1]);
+    args.erase(args.begin());
+    args.erase(args.begin());
+
+    // n^2 mod 2N keeps the argument of the chirp small.
+    Var n("n");
+    ComplexFunc chirp(prefix + "chirp");
+    chirp(n) = expj((sign * kPi / N) * cast<float>((n * n) % (2 * N)));
+    chirp.compute_root();
+
+    // The transform of the (circular) conjugate chirp is a constant, so
+    // compute it now, along with the 1/M of the inverse transform.
+    vector<std::complex<double>> b(M, 0.0);
+    for (int m = 0; m < N; m++) {
+        b[m] = std::polar(1.0, -sign * M_PI * (double)(((int64_t)m * m) % (2 * N)) / N);
+        b[(M - m) % M] = b[m];
+    }
+    reference_fft(b, -1);
+    Buffer<float> kernel({M, 2}, prefix + "bluestein_kernel");
+    for (int m = 0; m < M; m++) {
+        kernel(m, 0) = (float)(b[m].real() / M);
+        kernel(m, 1) = (float)(b[m].imag() / M);
+    }
+    ComplexFunc K(prefix + "bluestein_K");
+    K(n) = ComplexExpr(kernel(n, 0), kernel(n, 1));
+
+    // Apply the chirp and pad with zeros to M points.
+    Expr n1_clamped = min(n1, N - 1);
+    ComplexFunc chirped(prefix + "chirped");
+    chirped(A({n0, n1}, args)) =
+        select(n1 < N, x(A({n0, n1_clamped}, args)) * chirp(n1_clamped), ComplexExpr(0.0f, 0.0f));
+
+    // The forward and inverse transforms need different twiddle factors.
+    TwiddleFactorSet fwd_twiddles, inv_twiddles;
+    vector<int> RM = radix_factor(M);
+    ComplexFunc fwd = fft_dim1(chirped, RM, -1, extent_0, 1.0f, false,
+                               prefix + "bluestein_fwd_", target, &fwd_twiddles);
+
+    ComplexFunc filtered(prefix + "bluestein_filtered");
+    filtered(A({n0, n1}, args)) = fwd(A({n0, n1}, args)) * K(n1);
+
+    ComplexFunc conv = fft_dim1(filtered, RM, 1, extent_0, 1.0f, false,
+                                prefix + "bluestein_inv_", target, &inv_twiddles);
+
+    ComplexFunc X(prefix + "bluestein");
+    X(A({n0, n1}, args)) = conv(A({n0, n1}, args)) * chirp(n1) * gain;
+
+    // Compute everything in the same groups of DFTs as fft_dim1.
+    const int vector_width = gcd(target.natural_vector_size(X.output_types()[0]), extent_0);
+    X.bound(n1, 0, N)
+        .split(n0, group, n0, vector_width)
+        .reorder(n0, n1, group)
+        .vectorize(n0);
+    if (parallel) {
+        X.parallel(group);
+    }
+    conv.compute_at(X, group);
+    fwd.compute_at(conv, group);
+
+    return X;
+}
+
 // transpose the first two dimensions of x.
 template<typename FuncType>
 FuncType transpose(FuncType f) {
@@ -476,6 +600,206 @@ std::pair<FuncType, FuncType> tiled_transpose(FuncType f, int max_tile_size,
     return {fT, f_tiledT};
 }
 
+// Round extent up to a multiple of the vector size, so that odd numbers of
+// DFTs can still be vectorized across. The DFTs past extent are discarded.
+int padded_extent(int extent, const Target &target) {
+    const int v = target.natural_vector_size<float>();
+    return ((extent + v - 1) / v) * v;
+}
+
+// Compute the DFT of dimension 1 of the real valued function r, by zipping
+// each pair of adjacent elements of dimension 0 into one complex sequence,
+// and computing two real DFTs with one complex FFT (see the comment above
+// fft2d_r2c). Unlike the zipping done in fft2d_r2c, this works for any
+// size. pairs is the number of pairs to compute together. The result is
+// defined for any n1, but only bins [0, N/2] are independent. Also returns
+// the complex FFT, to be scheduled by the caller.
+std::pair<ComplexFunc, ComplexFunc> r2c_dim1(Func r,
+                                             const vector<int> &R,
+                                             int pairs,
+                                             Expr gain,
+                                             bool parallel,
+                                             const string &prefix,
+                                             const Target &target) {
+    const int N = product(R);
+
+    vector<Var> args(r.args());
+    Var n0(args[0]), n1(args[1]);
+    args.erase(args.begin());
+    args.erase(args.begin());
+
+    ComplexFunc zipped(prefix + "paired");
+    zipped(A({n0, n1}, args)) =
+        ComplexExpr(r(A({2 * n0, n1}, args)), r(A({2 * n0 + 1, n1}, args)));
+
+    TwiddleFactorSet twiddle_cache;
+    ComplexFunc Z = fft_dim1(zipped, R, -1, pairs, 1.0f, parallel, prefix, target, &twiddle_cache);
+
+    Expr k = n1 % N;
+    ComplexExpr Zk = Z(A({n0 / 2, k}, args));
+    ComplexExpr conjsymZ = conj(Z(A({n0 / 2, (N - k) % N}, args)));
+    ComplexFunc unzipped(prefix + "unpaired");
+    unzipped(A({n0, n1}, args)) =
+        select(n0 % 2 == 0, Zk + conjsymZ, -j * (Zk - conjsymZ)) * (gain / 2);
+
+    return {unzipped, Z};
+}
+
+// The inverse of r2c_dim1: compute the real valued inverse DFT of dimension 1
+// of c, two elements of dimension 0 at a time. c only needs to be defined for
+// bins [0, N/2]; the rest follow from conjugate symmetry. Also returns the
+// complex FFT, to be scheduled by the caller.
+std::pair<Func, ComplexFunc> c2r_dim1(ComplexFunc c,
+                                      const vector<int> &R,
+                                      int pairs,
+                                      Expr gain,
+                                      bool parallel,
+                                      const string &prefix,
+                                      const Target &target) {
+    const int N = product(R);
+
+    vector<Var> args(c.args());
+    Var n0(args[0]), n1(args[1]);
+    args.erase(args.begin());
+    args.erase(args.begin());
+
+    auto bins = [&](Expr m) -> ComplexExpr {
+        return select(n1 <= N / 2,
+                      c(A({m, min(n1, N / 2)}, args)),
+                      conj(c(A({m, clamp(N - n1, 0, N / 2)}, args))));
+    };
+    ComplexFunc zipped(prefix + "paired");
+    zipped(A({n0, n1}, args)) = bins(2 * n0) + j * bins(2 * n0 + 1);
+
+    TwiddleFactorSet twiddle_cache;
+    ComplexFunc z = fft_dim1(zipped, R, 1, pairs, gain, parallel, prefix, target, &twiddle_cache);
+
+    ComplexExpr zn = z(A({n0 / 2, n1}, args));
+    Func unzipped(prefix + "unpaired");
+    unzipped(A({n0, n1}, args)) = select(n0 % 2 == 0, re(zn), im(zn));
+
+    return {unzipped, z};
+}
+
+// Real to complex 2D DFT for sizes the zipping in fft2d_r2c can't handle:
+// the real DFTs of the columns, two at a time, followed by complex DFTs of
+// the N1 / 2 + 1 independent rows.
+ComplexFunc fft2d_r2c_paired(Func r,
+                             const vector<int> &R0,
+                             const vector<int> &R1,
+                             const Target &target,
+                             const Fft2dDesc &desc) {
+    string prefix = desc.name.empty() ? "r2c_" : desc.name + "_";
+
+    vector<Var> args(r.args());
+    Var n0(args[0]), n1(args[1]);
+    args.erase(args.begin());
+    args.erase(args.begin());
+
+    Var outer = Var::outermost();
+    if (!args.empty()) {
+        outer = args.front();
+    }
+
+    const int N0 = product(R0);
+    const int N1 = product(R1);
+    const int rows = N1 / 2 + 1;
+
+    // If N0 is odd, the last pair gets a column of zeros.
+    Func r_padded(prefix + "padded");
+    r_padded(A({n0, n1}, args)) = select(n0 < N0, r(A({min(n0, N0 - 1), n1}, args)), 0.0f);
+
+    ComplexFunc cols, dft1;
+    std::tie(cols, dft1) = r2c_dim1(r_padded, R1, padded_extent((N0 + 1) / 2, target),
+                                    1.0f, desc.parallel, prefix, target);
+
+    TwiddleFactorSet twiddle_cache;
+    ComplexFunc dftT = fft_dim1(transpose(cols),
+                                R0,
+                                -1,  // sign
+                                padded_extent(rows, target),
+                                desc.gain,
+                                desc.parallel,
+                                prefix,
+                                target,
+                                &twiddle_cache);
+    ComplexFunc dft = transpose(dftT);
+
+    dft1.compute_at(dft, outer);
+    dftT.compute_at(dft, outer);
+    if (desc.schedule_input) {
+        r.compute_at(dft1, group);
+    }
+
+    dft.vectorize(n0, target.natural_vector_size<float>(), TailStrategy::GuardWithIf);
+    dft.bound(n0, 0, N0);
+    dft.bound(n1, 0, rows);
+
+    return dft;
+}
+
+// The inverse of fft2d_r2c_paired.
+Func fft2d_c2r_paired(ComplexFunc c,
+                      const vector<int> &R0,
+                      const vector<int> &R1,
+                      const Target &target,
+                      const Fft2dDesc &desc) {
+    string prefix = desc.name.empty() ? "c2r_" : desc.name + "_";
+
+    vector<Var> args = c.args();
+    Var n0(args[0]), n1(args[1]);
+    args.erase(args.begin());
+    args.erase(args.begin());
+
+    Var outer = Var::outermost();
+    if (!args.empty()) {
+        outer = args.front();
+    }
+
+    const int N0 = product(R0);
+    const int N1 = product(R1);
+    const int rows = N1 / 2 + 1;
+
+    // Inverse DFT of the independent rows. The rows past N1 / 2 only pad
+    // out the vectors, so just read the last row for them.
+    ComplexFunc c_rows(prefix + "rows");
+    c_rows(A({n0, n1}, args)) = c(A({n0, min(n1, rows - 1)}, args));
+
+    TwiddleFactorSet twiddle_cache;
+    ComplexFunc dft0T = fft_dim1(transpose(c_rows),
+                                 R0,
+                                 1,  // sign
+                                 padded_extent(rows, target),
+                                 1.0f,
+                                 desc.parallel,
+                                 prefix,
+                                 target,
+                                 &twiddle_cache);
+    ComplexFunc dft0 = transpose(dft0T);
+
+    // If N0 is odd, the last pair gets a column of zeros.
+    ComplexFunc dft0_padded(prefix + "padded");
+    dft0_padded(A({n0, n1}, args)) =
+        select(n0 < N0, dft0(A({min(n0, N0 - 1), n1}, args)), ComplexExpr(0.0f, 0.0f));
+
+    Func unzipped;
+    ComplexFunc dft;
+    std::tie(unzipped, dft) = c2r_dim1(dft0_padded, R1, padded_extent((N0 + 1) / 2, target),
+                                       desc.gain, desc.parallel, prefix, target);
+
+    dft0T.compute_at(unzipped, outer);
+    dft.compute_at(unzipped, outer);
+    if (desc.schedule_input) {
+        c.compute_at(unzipped, outer);
+    }
+
+    unzipped.vectorize(n0, target.natural_vector_size<float>(), TailStrategy::GuardWithIf);
+    unzipped.bound(n0, 0, N0);
+    unzipped.bound(n1, 0, N1);
+
+    return unzipped;
+}
+
 }  // namespace
 
 ComplexFunc fft2d_c2c(ComplexFunc x,
@@ -687,6 +1011,11 @@ ComplexFunc fft2d_r2c(Func r,
     int N0 = product(R0);
     int N1 = product(R1);
 
+    // The zipping below needs an even number of columns and a Nyquist row.
+    if (N0 % 2 != 0 || N1 % 2 != 0) {
+        return fft2d_r2c_paired(r, R0, R1, target, desc);
+    }
+
     const int natural_vector_size = target.natural_vector_size(r.output_types()[0]);
 
     // If this FFT is small, the logic related to zipping and unzipping
@@ -907,6 +1236,11 @@ Func fft2d_c2r(ComplexFunc c,
     // forward FFTs.
     c = ComplexFunc(repeat_edge((Func)c, Expr(0), Expr(N0), Expr(0), Expr((N1 + 1) / 2 + 1)));
 
+    // The zipping below needs an even number of columns and a Nyquist row.
+    if (N0 % 2 != 0 || N1 % 2 != 0) {
+        return fft2d_c2r_paired(c, R0, R1, target, desc);
+    }
+
     // If this FFT is small, the logic related to zipping and unzipping
     // the FFT may be expensive compared to just brute forcing with a complex
     // FFT.
@@ -1080,7 +1414,7 @@ vector<int> radix_factor(int N) {
     }
 
     // Factor N into factors found in the 'radices' set.
-    static const int radices[] = {8, 6, 4, 2};
+    static const int radices[] = {8, 6, 4, 2, 3, 5, 7};
     vector<int> R;
     for (int r : radices) {
         while (N % r == 0) {
@@ -1120,3 +1454,93 @@ Func fft2d_c2r(ComplexFunc c,
                const Fft2dDesc &desc) {
     return fft2d_c2r(c, radix_factor(N0), radix_factor(N1), target, desc);
 }
+
+namespace {
+
+// Schedule the result of a batch of 1D DFTs, computed by computing the
+// transposed DFTs in groups of rows.
+template<typename FuncType>
+void schedule_1d_batch(FuncType dft, Func dftT, int rows_per_group,
+                       const Target &target, const Fft2dDesc &desc) {
+    Var n = dft.args()[0];
+    Var row = dft.args()[1];
+    dft.split(row, group, row, rows_per_group, TailStrategy::GuardWithIf)
+        .reorder(n, row, group)
+        .vectorize(n, target.natural_vector_size<float>(), TailStrategy::GuardWithIf);
+    if (desc.parallel) {
+        dft.parallel(group);
+    }
+    dftT.compute_at(dft, group);
+}
+
+}  // namespace
+
+ComplexFunc fft1d_c2c(ComplexFunc x, int N, int sign,
+                      const Target &target,
+                      const Fft2dDesc &desc) {
+    string prefix = desc.name.empty() ? "c2c1d_" : desc.name + "_";
+
+    // Transpose, so that each vector lane computes the DFT of a different row.
+    const int vector_size = target.natural_vector_size<float>();
+    TwiddleFactorSet twiddle_cache;
+    ComplexFunc dftT = fft_dim1(transpose(x),
+                                radix_factor(N),
+                                sign,
+                                vector_size,
+                                desc.gain,
+                                false,
+                                prefix,
+                                target,
+                                &twiddle_cache);
+    ComplexFunc dft = transpose(dftT);
+
+    schedule_1d_batch(dft, dftT, vector_size, target, desc);
+    if (desc.schedule_input) {
+        x.compute_at(dftT, group);
+    }
+    dft.bound(dft.args()[0], 0, N);
+
+    return dft;
+}
+
+ComplexFunc fft1d_r2c(Func r, int N,
+                      const Target &target,
+                      const Fft2dDesc &desc) {
+    string prefix = desc.name.empty() ? "r2c1d_" : desc.name + "_";
+
+    // Each vector lane computes the DFTs of a pair of rows.
+    const int vector_size = target.natural_vector_size<float>();
+    ComplexFunc unzippedT, dftT;
+    std::tie(unzippedT, dftT) = r2c_dim1(transpose(r), radix_factor(N), vector_size,
+                                         desc.gain, false, prefix, target);
+    ComplexFunc dft = transpose(unzippedT);
+
+    schedule_1d_batch(dft, dftT, vector_size * 2, target, desc);
+    if (desc.schedule_input) {
+        r.compute_at(dftT, group);
+    }
+    dft.bound(dft.args()[0], 0, N / 2 + 1);
+
+    return dft;
+}
+
+Func fft1d_c2r(ComplexFunc c, int N,
+               const Target &target,
+               const Fft2dDesc &desc) {
+    string prefix = desc.name.empty() ? "c2r1d_" : desc.name + "_";
+
+    const int vector_size = target.natural_vector_size<float>();
+    Func unzippedT;
+    ComplexFunc dftT;
+    std::tie(unzippedT, dftT) = c2r_dim1(transpose(c), radix_factor(N), vector_size,
+                                         desc.gain, false, prefix, target);
+    Func unzipped = transpose(unzippedT);
+
+    schedule_1d_batch(unzipped, dftT, vector_size * 2, target, desc);
+    if (desc.schedule_input) {
+        c.compute_at(dftT, group);
+    }
+    unzipped.bound(unzipped.args()[0], 0, N);
+
+    return unzipped;
+}
@@ -54,7 +54,8 @@ ComplexFunc fft2d_c2c(ComplexFunc x, int N0, int N1, int sign,
 // function r. The first 2 dimensions of r should be defined on at least [0, N0)
 // and [0, N1) for dimensions 0, 1, respectively. Note that the transform domain
 // has dimensions N0 x N1 / 2 + 1 due to the conjugate symmetry of real DFTs.
-// There is no normalization.
+// Any N0 and N1 are supported, though even sizes are fastest. There is no
+// normalization.
 ComplexFunc fft2d_r2c(Halide::Func r, int N0, int N1,
                       const Halide::Target &target,
                       const Fft2dDesc &desc = Fft2dDesc());
@@ -66,4 +67,30 @@ Halide::Func fft2d_c2r(ComplexFunc c, int N0, int N1,
                        const Halide::Target &target,
                        const Fft2dDesc &desc = Fft2dDesc());
 
+// Compute the N point 1D complex DFT of dimension 0 of x, for every row
+// (dimension 1) of x. The rows are transformed in groups, one row per vector
+// lane, so x should be defined for rows past the last one up to a multiple of
+// the vector size (e.g. by applying a boundary condition to an input).
+// sign = -1 indicates a forward FFT, sign = 1 indicates an inverse FFT. There
+// is no normalization. N may have any factors; large prime factors are
+// handled with Bluestein's algorithm.
+ComplexFunc fft1d_c2c(ComplexFunc x, int N, int sign,
+                      const Halide::Target &target,
+                      const Fft2dDesc &desc = Fft2dDesc());
+
+// Compute the N point 1D complex DFT of dimension 0 of each row of a real
+// valued function r. Pairs of rows are transformed with one complex FFT, so
+// the transform domain has N / 2 + 1 bins, for any N. See fft1d_c2c for the
+// rows that r should be defined for. There is no normalization.
+ComplexFunc fft1d_r2c(Halide::Func r, int N,
+                      const Halide::Target &target,
+                      const Fft2dDesc &desc = Fft2dDesc());
+
+// Compute the real valued N point 1D inverse DFT of dimension 0 of each row
+// of c. c only needs to be defined on the N / 2 + 1 bins [0, N / 2]. There
+// is no normalization.
+Halide::Func fft1d_c2r(ComplexFunc c, int N,
+                       const Halide::Target &target,
+                       const Fft2dDesc &desc = Fft2dDesc());
+
 #endif
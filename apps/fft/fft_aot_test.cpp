@@ -8,6 +8,7 @@
 
 #include "fft_forward_c2c.h"
 #include "fft_forward_r2c.h"
+#include "fft_forward_r2c_batch.h"
 #include "fft_inverse_c2c.h"
 #include "fft_inverse_c2r.h"
 
@@ -15,6 +16,10 @@ namespace {
 const float kPi = 3.14159265358979310000f;
 
 const int32_t kSize = 16;
+
+// The batched 1D FFT has an odd size and number of rows.
+const int32_t kBatchSize = 15;
+const int32_t kBatchRows = 7;
 }  // namespace
 
 using Halide::Runtime::Buffer;
@@ -292,5 +297,43 @@ int main(int argc, char **argv) {
         }
     }
 
+    // Batched forward real to complex test.
+    {
+        std::cout << "Batched forward real to complex test.\n";
+
+        auto in = Buffer<float, 3>::make_interleaved(kBatchSize, kBatchRows, 1);
+        for (int j = 0; j < kBatchRows; j++) {
+            for (int i = 0; i < kBatchSize; i++) {
+                in(i, j) = cos(2 * kPi * (j + 1) * i / kBatchSize) + 0.25f * (i % (j + 2));
+            }
+        }
+
+        auto out = Buffer<float, 3>::make_interleaved(kBatchSize / 2 + 1, kBatchRows, 2);
+
+        int halide_result;
+        halide_result = fft_forward_r2c_batch(in, out);
+        if (halide_result != 0) {
+            std::cerr << "fft_forward_r2c_batch failed returning " << halide_result << "\n";
+            exit(1);
+        }
+
+        for (int j = 0; j < kBatchRows; j++) {
+            for (int k = 0; k < kBatchSize / 2 + 1; k++) {
+                double real_expected = 0, imaginary_expected = 0;
+                for (int i = 0; i < kBatchSize; i++) {
+                    real_expected += in(i, j) * cos(2 * kPi * i * k / kBatchSize);
+                    imaginary_expected -= in(i, j) * sin(2 * kPi * i * k / kBatchSize);
+                }
+                if (fabs(re(out, k, j) - real_expected) > .001 ||
+                    fabs(im(out, k, j) - imaginary_expected) > .001) {
+                    std::cerr << "fft_forward_r2c_batch mismatch at (" << k << ", " << j << ") "
+                              << re(out, k, j) << " + " << im(out, k, j) << "j vs. "
+                              << real_expected << " + " << imaginary_expected << "j\n";
+                    exit(1);
+                }
+            }
+        }
+    }
+
     exit(0);
 }
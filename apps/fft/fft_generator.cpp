@@ -65,7 +65,8 @@ public:
 
     // Size of first dimension, required to be greater than zero.
     GeneratorParam<int32_t> size0{"size0", 1};
-    // Size of second dimension, may be zero for 1D FFT.
+    // Size of second dimension. If zero, the FFT is a batch of 1D FFTs of
+    // size0, one for each row of the input (dimension 1, any extent).
     GeneratorParam<int32_t> size1{"size1", 0};
     // TODO(zalman): Add support for 3D and maybe 4D FFTs
 
@@ -81,6 +82,9 @@ public:
     // Dim0: extent = size0, stride = 2
     // Dim1: extent = size1, stride = size0 * 2
     // Dim2: extent = 2, stride = 1 (real followed by imaginary components)
+    //
+    // The complex side of a real FFT only has size1 / 2 + 1 rows in 2D, or
+    // size0 / 2 + 1 columns for a batch of 1D FFTs.
     Input<Buffer<float>> input{"input", 3};
     Output<Buffer<float>> output{"output", 3};
 
@@ -100,6 +104,53 @@ public:
 
         const int sign = (direction == FFTDirection::SamplesToFrequency) ? -1 : 1;
 
+        if (size1 == 0) {
+            generate_1d(sign, desc);
+        } else {
+            generate_2d(sign, desc);
+        }
+
+        if (output_number_type == FFTNumberType::Real) {
+            if (real_result.defined()) {
+                output(x, y, c) = real_result(x, y);
+            } else {
+                output(x, y, c) = re(complex_result(x, y));
+            }
+        } else {
+            output(x, y, c) = mux(c, {re(complex_result(x, y)), im(complex_result(x, y))});
+        }
+    }
+
+    // A batch of 1D FFTs, one for each row of the input. The rows are
+    // transformed in groups, so clamp the rows we read to the input.
+    void generate_1d(int sign, const Fft2dDesc &desc) {
+        Expr row = clamp(y, input.dim(1).min(), input.dim(1).max());
+
+        if (input_number_type == FFTNumberType::Real) {
+            if (direction == FFTDirection::SamplesToFrequency) {
+                Func in;
+                in(x, y) = input(x, row, 0);
+
+                complex_result = fft1d_r2c(in, size0, target, desc);
+            } else {
+                ComplexFunc in;
+                in(x, y) = ComplexExpr(input(x, row, 0), 0);
+
+                complex_result = fft1d_c2c(in, size0, sign, target, desc);
+            }
+        } else {
+            ComplexFunc in;
+            in(x, y) = ComplexExpr(input(x, row, 0), input(x, row, 1));
+            if (output_number_type == FFTNumberType::Real &&
+                direction == FFTDirection::FrequencyToSamples) {
+                real_result = fft1d_c2r(in, size0, target, desc);
+            } else {
+                complex_result = fft1d_c2c(in, size0, sign, target, desc);
+            }
+        }
+    }
+
+    void generate_2d(int sign, const Fft2dDesc &desc) {
         if (input_number_type == FFTNumberType::Real) {
             if (direction == FFTDirection::SamplesToFrequency) {
                 // TODO: Not sure why this is necessary as ImageParam
@@ -125,16 +176,6 @@ public:
                 complex_result = fft2d_c2c(in, size0, size1, sign, target, desc);
             }
         }
-
-        if (output_number_type == FFTNumberType::Real) {
-            if (real_result.defined()) {
-                output(x, y, c) = real_result(x, y);
-            } else {
-                output(x, y, c) = re(complex_result(x, y));
-            }
-        } else {
-            output(x, y, c) = mux(c, {re(complex_result(x, y)), im(complex_result(x, y))});
-        }
     }
 
     void schedule() {
@@ -130,6 +130,58 @@ int main(int argc, char **argv) {
         }
     }
 
+    // Check the batched 1D transforms of the rows of the input against a
+    // direct DFT. The rows are transformed in groups, so they need a
+    // boundary condition.
+    {
+        Func in_rows = BoundaryConditions::repeat_edge(in);
+        Func rows_r("rows_r");
+        rows_r(x, y) = in_rows(x, y);
+        ComplexFunc rows_c("rows_c");
+        rows_c(x, y) = in_rows(x, y);
+
+        Realization c2c_1d = fft1d_c2c(rows_c, W, -1, target, fwd_desc).realize(W, H, target);
+        Realization r2c_1d = fft1d_r2c(rows_r, W, target, fwd_desc).realize(W / 2 + 1, H, target);
+        Buffer<float> c2c_re = c2c_1d[0], c2c_im = c2c_1d[1];
+        Buffer<float> r2c_re = r2c_1d[0], r2c_im = r2c_1d[1];
+
+        // The inverse of the real transform should give back the input.
+        ComplexFunc r2c_bins("r2c_bins");
+        r2c_bins(x, y) = ComplexExpr(BoundaryConditions::repeat_edge(r2c_re)(x, y),
+                                     BoundaryConditions::repeat_edge(r2c_im)(x, y));
+        Fft2dDesc inv_1d_desc;
+        inv_1d_desc.gain = 1.0f / W;
+        Buffer<float> round_trip = fft1d_c2r(r2c_bins, W, target, inv_1d_desc).realize(W, H, target);
+
+        const float tolerance = 1e-4f * W;
+        for (int y = 0; y < H; y++) {
+            for (int k = 0; k < W; k++) {
+                double re_k = 0, im_k = 0;
+                for (int x = 0; x < W; x++) {
+                    re_k += in(x, y) * cos(2 * M_PI * x * k / W);
+                    im_k -= in(x, y) * sin(2 * M_PI * x * k / W);
+                }
+                if (fabs(c2c_re(k, y) - re_k) > tolerance || fabs(c2c_im(k, y) - im_k) > tolerance) {
+                    printf("c2c_1d(%d, %d) = %f + %fj instead of %f + %fj\n",
+                           k, y, c2c_re(k, y), c2c_im(k, y), re_k, im_k);
+                    return -1;
+                }
+                if (k <= W / 2 &&
+                    (fabs(r2c_re(k, y) - re_k) > tolerance || fabs(r2c_im(k, y) - im_k) > tolerance)) {
+                    printf("r2c_1d(%d, %d) = %f + %fj instead of %f + %fj\n",
+                           k, y, r2c_re(k, y), r2c_im(k, y), re_k, im_k);
+                    return -1;
+                }
+            }
+            for (int x = 0; x < W; x++) {
+                if (fabs(round_trip(x, y) - in(x, y)) > 1e-4f) {
+                    printf("c2r_1d(%d, %d) = %f instead of %f\n", x, y, round_trip(x, y), in(x, y));
+                    return -1;
+                }
+            }
+        }
+    }
+
     // For a description of the methodology used here, see
     // http://www.fftw.org/speed/method.html
 
@@ -230,10 +282,70 @@ int main(int argc, char **argv) {
            2.5 * W * H * (log2(W) + log2(H)) / fftw_t,
            fftw_t / halide_t);
 
+    // Batches of 1D transforms, one for each of the H rows.
+    ComplexFunc c2c_1d_in;
+    // All reps read from the same input. See notes on c2c_in. The rows
+    // are transformed in groups, so clamp the rows read.
+    c2c_1d_in(x, y, rep) = {re_in(x, clamp(y, 0, H - 1)), im_in(x, clamp(y, 0, H - 1))};
+    Func bench_c2c_1d = fft1d_c2c(c2c_1d_in, W, -1, target, fwd_desc);
+    bench_c2c_1d.compile_to_lowered_stmt(output_dir + "c2c_1d.html", bench_c2c_1d.infer_arguments(), HTML);
+    Realization R_c2c_1d = bench_c2c_1d.realize(W, H, reps, target);
+    // Write all reps to the same place in memory. See notes on R_c2c.
+    R_c2c_1d[0].raw_buffer()->dim[2].stride = 0;
+    R_c2c_1d[1].raw_buffer()->dim[2].stride = 0;
+
+    halide_t = benchmark(samples, 1, [&]() { bench_c2c_1d.realize(R_c2c_1d); }) * 1e6 / reps;
+#ifdef WITH_FFTW
+    fftwf_plan c2c_1d_plan = fftwf_plan_many_dft(1, &W, H,
+                                                 (fftwf_complex *)&fftw_c1[0], nullptr, 1, W,
+                                                 (fftwf_complex *)&fftw_c2[0], nullptr, 1, W,
+                                                 FFTW_FORWARD, FFTW_EXHAUSTIVE);
+    fftw_t = benchmark(samples, reps, [&]() { fftwf_execute(c2c_1d_plan); }) * 1e6;
+#else
+    fftw_t = 0;
+#endif
+    printf("%12s %10.3f %10.2f %10.3f %10.2f %10.3g\n",
+           "c2c 1d",
+           halide_t,
+           5 * W * H * log2(W) / halide_t,
+           fftw_t,
+           5 * W * H * log2(W) / fftw_t,
+           fftw_t / halide_t);
+
+    Func r2c_1d_in;
+    // All reps read from the same input. See notes on c2c_1d_in.
+    r2c_1d_in(x, y, rep) = re_in(x, clamp(y, 0, H - 1));
+    Func bench_r2c_1d = fft1d_r2c(r2c_1d_in, W, target, fwd_desc);
+    bench_r2c_1d.compile_to_lowered_stmt(output_dir + "r2c_1d.html", bench_r2c_1d.infer_arguments(), HTML);
+    Realization R_r2c_1d = bench_r2c_1d.realize(W / 2 + 1, H, reps, target);
+    // Write all reps to the same place in memory. See notes on R_c2c.
+    R_r2c_1d[0].raw_buffer()->dim[2].stride = 0;
+    R_r2c_1d[1].raw_buffer()->dim[2].stride = 0;
+
+    halide_t = benchmark(samples, 1, [&]() { bench_r2c_1d.realize(R_r2c_1d); }) * 1e6 / reps;
+#ifdef WITH_FFTW
+    fftwf_plan r2c_1d_plan = fftwf_plan_many_dft_r2c(1, &W, H,
+                                                     &fftw_r[0], nullptr, 1, W,
+                                                     (fftwf_complex *)&fftw_c1[0], nullptr, 1, W / 2 + 1,
+                                                     FFTW_EXHAUSTIVE);
+    fftw_t = benchmark(samples, reps, [&]() { fftwf_execute(r2c_1d_plan); }) * 1e6;
+#else
+    fftw_t = 0;
+#endif
+    printf("%12s %10.3f %10.2f %10.3f %10.2f %10.3g\n",
+           "r2c 1d",
+           halide_t,
+           2.5 * W * H * log2(W) / halide_t,
+           fftw_t,
+           2.5 * W * H * log2(W) / fftw_t,
+           fftw_t / halide_t);
+
 #ifdef WITH_FFTW
     fftwf_destroy_plan(c2c_plan);
     fftwf_destroy_plan(r2c_plan);
     fftwf_destroy_plan(c2r_plan);
+    fftwf_destroy_plan(c2c_1d_plan);
+    fftwf_destroy_plan(r2c_1d_plan);
 #endif
 
     return 0;
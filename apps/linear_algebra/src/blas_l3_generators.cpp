@@ -1,15 +1,57 @@
 #include "Halide.h"
+#include <algorithm>
 #include <vector>
 
 using namespace Halide;
 
 namespace {
 
-// Generator class for BLAS gemm operations.
-template<class T>
-class GEMMGenerator : public Generator<GEMMGenerator<T>> {
+// Register and cache blocking for the packed gemm below. As in
+// BLIS, the micro-kernel accumulates an mr x nr tile of the output
+// in registers, over kc elements of the sum at a time. A is packed
+// into panels of mr rows and B into panels of nr columns, so that
+// the micro-kernel reads both contiguously. kc is chosen so that a
+// micro-panel of each stays in L1, mc so that an mc x kc block of A
+// stays in L2, and nc so that a kc x nc panel of B stays in L3.
+struct GEMMBlocking {
+    int mr, nr;
+    int kc, mc, nc;
+};
+
+GEMMBlocking choose_gemm_blocking(const Target &target, const Type &t,
+                                  int l1_size, int l2_size, int l3_size) {
+    GEMMBlocking b;
+    const int lanes = target.natural_vector_size(t);
+    b.mr = 2 * std::max(4, lanes);
+
+    // AVX-512 and AArch64 have 32 vector registers, everything else
+    // we care about has 16. Keep a few of them free for loading A
+    // and broadcasting B, and use the rest as accumulators.
+    int registers = 16;
+    if (target.has_feature(Target::AVX512) ||
+        target.has_feature(Target::AVX512_KNL) ||
+        target.has_feature(Target::AVX512_Skylake) ||
+        target.has_feature(Target::AVX512_Cannonlake) ||
+        (target.arch == Target::ARM && target.bits == 64)) {
+        registers = 32;
+    }
+    const int registers_per_column = std::max(1, b.mr / lanes);
+    b.nr = std::max(1, std::min(12, (registers - 4) / registers_per_column));
+
+    const int bytes = t.bytes();
+    b.kc = std::max(8, (l1_size * 3 / 4) / ((b.mr + b.nr) * bytes) / 8 * 8);
+    b.mc = std::max(b.mr, (l2_size / 2) / (b.kc * bytes) / b.mr * b.mr);
+    b.nc = std::max(b.nr, (l3_size / 2) / (b.kc * bytes) / b.nr * b.nr);
+    return b;
+}
+
+// Generator class for BLAS gemm operations. The batched variant
+// takes 3D buffers, with the matrices stacked along the last
+// dimension, and computes one gemm per batch element.
+template<class T, bool batched = false>
+class GEMMGenerator : public Generator<GEMMGenerator<T, batched>> {
 public:
-    typedef Generator<GEMMGenerator<T>> Base;
+    typedef Generator<GEMMGenerator<T, batched>> Base;
     using Base::get_target;
     using Base::natural_vector_size;
     using Base::target;
@@ -21,158 +63,158 @@ public:
     GeneratorParam<bool> transpose_A_ = {"transpose_A", false};
     GeneratorParam<bool> transpose_B_ = {"transpose_B", false};
 
+    // Cache sizes in bytes, used to pick the blocking.
+    GeneratorParam<int> l1_cache_size_ = {"l1_cache_size", 32 * 1024};
+    GeneratorParam<int> l2_cache_size_ = {"l2_cache_size", 256 * 1024};
+    GeneratorParam<int> l3_cache_size_ = {"l3_cache_size", 2 * 1024 * 1024};
+
     // Standard ordering of parameters in GEMM functions.
     Input<T> a_ = {"a_", 1};
-    Input<Buffer<T>> A_ = {"A_", 2};
-    Input<Buffer<T>> B_ = {"B_", 2};
+    Input<Buffer<T>> A_ = {"A_", batched ? 3 : 2};
+    Input<Buffer<T>> B_ = {"B_", batched ? 3 : 2};
     Input<T> b_ = {"b_", 1};
-    Input<Buffer<T>> C_ = {"C_", 2};
+    Input<Buffer<T>> C_ = {"C_", batched ? 3 : 2};
 
-    Output<Buffer<T>> result_ = {"result", 2};
+    Output<Buffer<T>> result_ = {"result", batched ? 3 : 2};
 
     void generate() {
         // Matrices are interpreted as column-major by default. The
         // transpose GeneratorParams are used to handle cases where
-        // one or both is actually row major.
-        const Expr num_rows = A_.width();
-        const Expr num_cols = B_.height();
-        const Expr sum_size = A_.height();
-
-        const int vec = std::max(4, natural_vector_size(a_.type()));
-        const int s = vec * 2;
-
-        Input<Buffer<T>> *A_in = &A_;
-        Input<Buffer<T>> *B_in = &B_;
-
-        // If they're both transposed, then reverse the order and transpose the result instead.
-        const bool transpose_AB = (bool)transpose_A_ && (bool)transpose_B_;
-        const bool transpose_A = !transpose_AB && (bool)transpose_A_;
-        const bool transpose_B = !transpose_AB && (bool)transpose_B_;
-        if (transpose_AB) {
-            std::swap(A_in, B_in);
+        // one or both is actually row major. The transposes are
+        // folded into the packing of A and B.
+        const bool transpose_A = transpose_A_;
+        const bool transpose_B = transpose_B_;
+        const Expr num_rows = transpose_A ? A_.height() : A_.width();
+        const Expr num_cols = transpose_B ? B_.width() : B_.height();
+        const Expr sum_size = transpose_A ? A_.width() : A_.height();
+
+        const GEMMBlocking blk = choose_gemm_blocking(get_target(), a_.type(),
+                                                      l1_cache_size_, l2_cache_size_,
+                                                      l3_cache_size_);
+        const int mr = blk.mr, nr = blk.nr;
+
+        Var i("i"), j("j"), k("k"), ko("ko");
+        Var ii("ii"), ji("ji"), io("io"), jo("jo"), ic("ic"), jc("jc"), t("t");
+
+        // Everything carries the batch index along as its last
+        // argument, if there is one.
+        std::vector<Var> batch;
+        if (batched) {
+            batch.push_back(Var("batch"));
         }
-
-        Var i, j, ii, ji, jii, iii, io, jo, t;
-        Var ti[3], tj[3];
-
-        // Swizzle A for better memory order in the inner loop.
-        Func A("A"), B("B"), Btmp("Btmp"), As("As"), Atmp("Atmp");
-        Atmp(i, j) = BoundaryConditions::constant_exterior(*A_in, cast<T>(0))(i, j);
-
+        auto vars = [&](std::vector<Var> v) {
+            v.insert(v.end(), batch.begin(), batch.end());
+            return v;
+        };
+        auto args = [&](std::vector<Expr> e) {
+            e.insert(e.end(), batch.begin(), batch.end());
+            return e;
+        };
+
+        // Pack A into panels of mr rows and B into panels of nr
+        // columns. Both are padded with zeros, so the micro-kernel
+        // never needs to handle a partial tile or a partial block
+        // of the sum.
+        Func Atmp("Atmp"), Btmp("Btmp"), Ap("Ap"), Bp("Bp");
+        Atmp = BoundaryConditions::constant_exterior(A_, cast<T>(0));
+        Btmp = BoundaryConditions::constant_exterior(B_, cast<T>(0));
         if (transpose_A) {
-            As(i, j, io) = Atmp(j, io * s + i);
+            Ap(vars({ii, k, io})) = Atmp(args({k, io * mr + ii}));
         } else {
-            As(i, j, io) = Atmp(io * s + i, j);
+            Ap(vars({ii, k, io})) = Atmp(args({io * mr + ii, k}));
         }
-
-        A(i, j) = As(i % s, j, i / s);
-
-        Btmp(i, j) = (*B_in)(i, j);
         if (transpose_B) {
-            B(i, j) = Btmp(j, i);
+            Bp(vars({ji, k, jo})) = Btmp(args({jo * nr + ji, k}));
         } else {
-            B(i, j) = Btmp(i, j);
+            Bp(vars({ji, k, jo})) = Btmp(args({k, jo * nr + ji}));
         }
 
-        Var k("k");
-        Func prod;
-        // Express all the products we need to do a matrix multiply as a 3D Func.
-        prod(k, i, j) = A(i, k) * B(k, j);
-
-        // Reduce the products along k.
+        // The micro-kernel: the product of one block of kc columns
+        // of A with the matching kc rows of B. Small sums use a
+        // single short block rather than padding out to kc.
+        const Expr kc = min(blk.kc, sum_size);
+        RDom rk(0, kc, "rk");
+        Func mk("mk");
+        mk(vars({i, j, ko})) += (Ap(args({i % mr, ko * kc + rk, i / mr})) *
+                                 Bp(args({j % nr, ko * kc + rk, j / nr})));
+
+        // Accumulate the blocks of the sum.
+        RDom rko(0, (sum_size + kc - 1) / kc, "rko");
         Func AB("AB");
-        RDom rv(0, sum_size);
-        AB(i, j) += prod(rv, i, j);
-
-        Func ABt("ABt");
-        if (transpose_AB) {
-            // Transpose A*B if necessary.
-            ABt(i, j) = AB(j, i);
-        } else {
-            ABt(i, j) = AB(i, j);
-        }
+        AB(vars({i, j})) += mk(args({i, j, rko}));
 
         // Do the part that makes it a 'general' matrix multiply.
-        result_(i, j) = (a_ * ABt(i, j) + b_ * C_(i, j));
-
-        result_.tile(i, j, ti[1], tj[1], i, j, 2 * s, 2 * s, TailStrategy::GuardWithIf);
-        if (transpose_AB) {
-            result_
-                .tile(i, j, ii, ji, 4, s)
-                .tile(i, j, ti[0], tj[0], i, j, s / 4, 1);
-
-        } else {
-            result_
-                .tile(i, j, ii, ji, s, 4)
-                .tile(i, j, ti[0], tj[0], i, j, 1, s / 4);
+        result_(vars({i, j})) = (a_ * AB(args({i, j})) + b_ * C_(args({i, j})));
+
+        // Each task computes an mc x nc block of the output.
+        result_
+            .tile(i, j, ic, jc, i, j, blk.mc, blk.nc, TailStrategy::GuardWithIf)
+            .tile(i, j, io, jo, ii, ji, mr, nr, TailStrategy::GuardWithIf)
+            .vectorize(ii)
+            .unroll(ji)
+            .fuse(ic, jc, t);
+        Var task = t;
+        if (batched) {
+            task = Var("task");
+            result_.fuse(t, batch[0], task);
         }
-
-        // If we have enough work per task, parallelize over these tiles.
-        result_.specialize(num_rows >= 512 && num_cols >= 512)
-            .fuse(tj[1], ti[1], t)
-            .parallel(t);
-
-        // Otherwise tile one more time before parallelizing, or don't
-        // parallelize at all.
-        result_.specialize(num_rows >= 128 && num_cols >= 128)
-            .tile(ti[1], tj[1], ti[2], tj[2], ti[1], tj[1], 2, 2)
-            .fuse(tj[2], ti[2], t)
-            .parallel(t);
-
-        result_.rename(tj[0], t);
-
-        result_.bound(i, 0, num_rows).bound(j, 0, num_cols);
-
-        As.compute_root()
-            .split(j, jo, ji, s)
-            .reorder(i, ji, io, jo)
-            .unroll(i)
-            .vectorize(ji)
-            .specialize(A_.width() >= 256 && A_.height() >= 256)
-            .parallel(jo, 4);
-
-        Atmp.compute_at(As, io)
+        result_.parallel(task);
+
+        // Walk the block of the output one block of the sum at a
+        // time, and within that one nr-wide column panel at a time.
+        // The mc x kc block of A is packed once per block of the sum
+        // and stays in L2, and each kc x nr micro-panel of B is reused
+        // across all of it.
+        AB.compute_at(result_, task)
+            .vectorize(i, natural_vector_size(a_.type()));
+        AB.update()
+            .split(i, io, ii, mr)
+            .split(j, jo, ji, nr)
+            .reorder(ii, ji, io, jo, rko)
+            .vectorize(ii)
+            .unroll(ji);
+
+        Ap.compute_at(AB, rko)
+            .bound(ii, 0, mr)
+            .vectorize(ii);
+
+        Bp.compute_at(AB, jo)
+            .bound(ji, 0, nr)
+            .unroll(ji);
+
+        // The accumulators are a constant-size tile, which LLVM
+        // keeps in registers across the loop over the sum.
+        mk.compute_at(AB, io)
+            .bound_extent(i, mr)
+            .bound_extent(j, nr)
             .vectorize(i)
-            .unroll(j);
-
-        if (transpose_B) {
-            B.compute_at(result_, t)
-                .tile(i, j, ii, ji, 8, 8)
-                .vectorize(ii)
-                .unroll(ji);
-            Btmp.reorder_storage(j, i)
-                .compute_at(B, i)
-                .vectorize(i)
-                .unroll(j);
-        }
-
-        AB.compute_at(result_, i)
-            .bound_extent(j, 4)
             .unroll(j)
-            .bound_extent(i, s)
-            .vectorize(i)
             .update()
-            .reorder(i, j, rv)
-            .unroll(j)
-            .unroll(rv, 2)
-            .vectorize(i);
-        if (transpose_AB) {
-            ABt.compute_at(result_, i)
-                .bound_extent(i, 4)
-                .unroll(i)
-                .bound_extent(j, s)
-                .vectorize(j);
-        }
+            .reorder(i, j, rk)
+            .vectorize(i)
+            .unroll(j);
 
         A_.dim(0).set_min(0).dim(1).set_min(0);
-        B_.dim(0).set_bounds(0, sum_size).dim(1).set_min(0);
-        C_.dim(0).set_bounds(0, num_rows);
-        C_.dim(1).set_bounds(0, num_cols);
+        B_.dim(0).set_min(0).dim(1).set_min(0);
+        B_.dim(transpose_B ? 1 : 0).set_extent(sum_size);
+        C_.dim(0).set_bounds(0, num_rows).dim(1).set_bounds(0, num_cols);
         result_.dim(0).set_bounds(0, num_rows).dim(1).set_bounds(0, num_cols);
+        if (batched) {
+            const Expr batch_size = A_.dim(2).extent();
+            A_.dim(2).set_min(0);
+            B_.dim(2).set_bounds(0, batch_size);
+            C_.dim(2).set_bounds(0, batch_size);
+            result_.dim(2).set_bounds(0, batch_size);
+        }
     }
 };
 
+template<class T>
+using BatchedGEMMGenerator = GEMMGenerator<T, true>;
+
 }  // namespace
 
 HALIDE_REGISTER_GENERATOR(GEMMGenerator<float>, sgemm)
 HALIDE_REGISTER_GENERATOR(GEMMGenerator<double>, dgemm)
+HALIDE_REGISTER_GENERATOR(BatchedGEMMGenerator<float>, sgemm_batched)
+HALIDE_REGISTER_GENERATOR(BatchedGEMMGenerator<double>, dgemm_batched)
@@ -1,5 +1,7 @@
 #include "halide_blas.h"
 #include "HalideBuffer.h"
+#include <climits>
+#include <cstdint>
 #include <iostream>
 #include <string.h>
 
@@ -29,6 +31,42 @@ Buffer<T> init_matrix_buffer(const int M, const int N, T *A, const int lda) {
     return Buffer<T>(A, 2, shape);
 }
 
+template<typename T>
+Buffer<T> init_batched_matrix_buffer(const int M, const int N, const int batch_count,
+                                     T *A, const int lda, const int stride) {
+    halide_dimension_t shape[] = {{0, M, 1}, {0, N, lda}, {0, batch_count, stride}};
+    return Buffer<T>(A, 3, shape);
+}
+
+bool is_transposed(const enum HBLAS_TRANSPOSE Trans) {
+    return Trans == HblasTrans || Trans == HblasConjTrans;
+}
+
+// If the matrices are evenly spaced in memory, find the spacing in
+// elements, so that the whole batch can go to Halide as one buffer.
+template<typename T>
+bool find_batch_stride(const T *const X[], const int batch_count, int *stride) {
+    *stride = 0;
+    if (batch_count < 2) {
+        return true;
+    }
+    const intptr_t bytes = (intptr_t)X[1] - (intptr_t)X[0];
+    if (bytes % (intptr_t)sizeof(T) != 0) {
+        return false;
+    }
+    for (int i = 2; i < batch_count; i++) {
+        if ((intptr_t)X[i] - (intptr_t)X[i - 1] != bytes) {
+            return false;
+        }
+    }
+    const intptr_t elements = bytes / (intptr_t)sizeof(T);
+    if (elements < INT_MIN || elements > INT_MAX) {
+        return false;
+    }
+    *stride = (int)elements;
+    return true;
+}
+
 }  // namespace
 
 #ifdef __cplusplus
@@ -289,6 +327,104 @@ void hblas_dgemm(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA
     assert_no_error(halide_dgemm(tA, tB, alpha, buff_A, buff_B, beta, buff_C));
 }
 
+void hblas_sgemm_strided_batched(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA,
+                                 const enum HBLAS_TRANSPOSE TransB, const int M, const int N,
+                                 const int K, const float alpha, const float *A,
+                                 const int lda, const int strideA, const float *B,
+                                 const int ldb, const int strideB, const float beta,
+                                 float *C, const int ldc, const int strideC,
+                                 const int batch_count) {
+    if (batch_count <= 0) {
+        return;
+    }
+    const bool tA = is_transposed(TransA), tB = is_transposed(TransB);
+
+    auto buff_A = init_batched_matrix_buffer(tA ? K : M, tA ? M : K, batch_count,
+                                             const_cast<float *>(A), lda, strideA);
+    auto buff_B = init_batched_matrix_buffer(tB ? N : K, tB ? K : N, batch_count,
+                                             const_cast<float *>(B), ldb, strideB);
+    auto buff_C = init_batched_matrix_buffer(M, N, batch_count, C, ldc, strideC);
+
+    assert_no_error(halide_sgemm_batched(tA, tB, alpha, buff_A, buff_B, beta, buff_C));
+}
+
+void hblas_sgemm_batched(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA,
+                         const enum HBLAS_TRANSPOSE TransB, const int M, const int N,
+                         const int K, const float alpha, const float *const A[],
+                         const int lda, const float *const B[], const int ldb,
+                         const float beta, float *const C[], const int ldc,
+                         const int batch_count) {
+    if (batch_count <= 0) {
+        return;
+    }
+
+    // Arrays of pointers usually come from slicing one big allocation,
+    // in which case the strided kernel can do the whole batch at once.
+    int strideA, strideB, strideC;
+    if (find_batch_stride(A, batch_count, &strideA) &&
+        find_batch_stride(B, batch_count, &strideB) &&
+        find_batch_stride(C, batch_count, &strideC) &&
+        (batch_count == 1 || strideC > 0)) {
+        hblas_sgemm_strided_batched(Order, TransA, TransB, M, N, K, alpha,
+                                     A[0], lda, strideA, B[0], ldb, strideB,
+                                     beta, C[0], ldc, strideC, batch_count);
+        return;
+    }
+
+    for (int i = 0; i < batch_count; i++) {
+        hblas_sgemm(Order, TransA, TransB, M, N, K, alpha, A[i], lda, B[i], ldb, beta, C[i], ldc);
+    }
+}
+
+void hblas_dgemm_strided_batched(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA,
+                                 const enum HBLAS_TRANSPOSE TransB, const int M, const int N,
+                                 const int K, const double alpha, const double *A,
+                                 const int lda, const int strideA, const double *B,
+                                 const int ldb, const int strideB, const double beta,
+                                 double *C, const int ldc, const int strideC,
+                                 const int batch_count) {
+    if (batch_count <= 0) {
+        return;
+    }
+    const bool tA = is_transposed(TransA), tB = is_transposed(TransB);
+
+    auto buff_A = init_batched_matrix_buffer(tA ? K : M, tA ? M : K, batch_count,
+                                             const_cast<double *>(A), lda, strideA);
+    auto buff_B = init_batched_matrix_buffer(tB ? N : K, tB ? K : N, batch_count,
+                                             const_cast<double *>(B), ldb, strideB);
+    auto buff_C = init_batched_matrix_buffer(M, N, batch_count, C, ldc, strideC);
+
+    assert_no_error(halide_dgemm_batched(tA, tB, alpha, buff_A, buff_B, beta, buff_C));
+}
+
+void hblas_dgemm_batched(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA,
+                         const enum HBLAS_TRANSPOSE TransB, const int M, const int N,
+                         const int K, const double alpha, const double *const A[],
+                         const int lda, const double *const B[], const int ldb,
+                         const double beta, double *const C[], const int ldc,
+                         const int batch_count) {
+    if (batch_count <= 0) {
+        return;
+    }
+
+    // Arrays of pointers usually come from slicing one big allocation,
+    // in which case the strided kernel can do the whole batch at once.
+    int strideA, strideB, strideC;
+    if (find_batch_stride(A, batch_count, &strideA) &&
+        find_batch_stride(B, batch_count, &strideB) &&
+        find_batch_stride(C, batch_count, &strideC) &&
+        (batch_count == 1 || strideC > 0)) {
+        hblas_dgemm_strided_batched(Order, TransA, TransB, M, N, K, alpha,
+                                     A[0], lda, strideA, B[0], ldb, strideB,
+                                     beta, C[0], ldc, strideC, batch_count);
+        return;
+    }
+
+    for (int i = 0; i < batch_count; i++) {
+        hblas_dgemm(Order, TransA, TransB, M, N, K, alpha, A[i], lda, B[i], ldb, beta, C[i], ldc);
+    }
+}
+
 #ifdef __cplusplus
 }
 #endif
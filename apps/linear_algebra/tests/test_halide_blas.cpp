@@ -113,6 +113,38 @@
         return compareMatrices(N, eC, aC);      \
     }
 
+// Batches of small, non-square matrices, each stored in a slot of
+// size*size elements and picked out by the pointer arrays Ap, Bp and
+// Cp. The reference runs one cblas call per matrix.
+#define L3_BATCHED_TEST(method, ab_slot, c_slot, cblas_code, hblas_code) \
+    bool test_##method(int N) {                                          \
+        const int M = 23, N_ = 17, K = 29, size = 32, batch = 16;        \
+        Scalar alpha = random_scalar();                                  \
+        Scalar beta = random_scalar();                                   \
+        Vector eA(random_vector(size * size * batch));                   \
+        Vector eB(random_vector(size * size * batch));                   \
+        Vector eC(random_vector(size * size * batch));                   \
+        Vector aA(eA), aB(eB), aC(eC);                                   \
+                                                                         \
+        std::vector<const Scalar *> Ap(batch), Bp(batch);                \
+        std::vector<Scalar *> Cp(batch);                                 \
+        for (int b = 0; b < batch; b++) {                                \
+            Ap[b] = &(eA[0]) + (ab_slot)*size * size;                    \
+            Bp[b] = &(eB[0]) + (ab_slot)*size * size;                    \
+            Cp[b] = &(eC[0]) + (c_slot)*size * size;                     \
+            cblas_code;                                                  \
+        }                                                                \
+                                                                         \
+        for (int b = 0; b < batch; b++) {                                \
+            Ap[b] = &(aA[0]) + (ab_slot)*size * size;                    \
+            Bp[b] = &(aB[0]) + (ab_slot)*size * size;                    \
+            Cp[b] = &(aC[0]) + (c_slot)*size * size;                     \
+        }                                                                \
+        hblas_code;                                                      \
+                                                                         \
+        return compareVectors(size * size * batch, eC, aC);              \
+    }
+
 template<class T>
 struct BLASTestBase {
     typedef T Scalar;
@@ -213,6 +245,9 @@ struct BLASFloatTests : public BLASTestBase<float> {
         RUN_TEST(sgemm_transA);
         RUN_TEST(sgemm_transB);
         RUN_TEST(sgemm_transAB);
+        RUN_TEST(sgemm_strided_batched);
+        RUN_TEST(sgemm_batched);
+        RUN_TEST(sgemm_batched_scattered);
     }
 
     L1_VECTOR_TEST(scopy, scopy(N, x, 1, y, 1))
@@ -244,6 +279,22 @@ struct BLASFloatTests : public BLASTestBase<float> {
     L3_TEST(sgemm_transAB,
             cblas_sgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N),
             hblas_sgemm(HblasColMajor, HblasTrans, HblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N));
+
+    L3_BATCHED_TEST(sgemm_strided_batched, b, b,
+                    cblas_sgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, M, N_, K, alpha, Ap[b], M, Bp[b], K, beta, Cp[b], M),
+                    hblas_sgemm_strided_batched(HblasColMajor, HblasNoTrans, HblasNoTrans, M, N_, K, alpha,
+                                                Ap[0], M, size * size, Bp[0], K, size * size,
+                                                beta, Cp[0], M, size * size, batch));
+    // A and B in reverse order, which is still evenly spaced.
+    L3_BATCHED_TEST(sgemm_batched, batch - 1 - b, b,
+                    cblas_sgemm(CblasColMajor, CblasTrans, CblasTrans, M, N_, K, alpha, Ap[b], K, Bp[b], N_, beta, Cp[b], M),
+                    hblas_sgemm_batched(HblasColMajor, HblasTrans, HblasTrans, M, N_, K, alpha,
+                                        Ap.data(), K, Bp.data(), N_, beta, Cp.data(), M, batch));
+    // C out of order, which falls back to one gemm per matrix.
+    L3_BATCHED_TEST(sgemm_batched_scattered, b, (b * 5) % batch,
+                    cblas_sgemm(CblasColMajor, CblasNoTrans, CblasTrans, M, N_, K, alpha, Ap[b], M, Bp[b], N_, beta, Cp[b], M),
+                    hblas_sgemm_batched(HblasColMajor, HblasNoTrans, HblasTrans, M, N_, K, alpha,
+                                        Ap.data(), M, Bp.data(), N_, beta, Cp.data(), M, batch));
 };
 
 struct BLASDoubleTests : public BLASTestBase<double> {
@@ -260,6 +311,9 @@ struct BLASDoubleTests : public BLASTestBase<double> {
         RUN_TEST(dgemm_transA);
         RUN_TEST(dgemm_transB);
         RUN_TEST(dgemm_transAB);
+        RUN_TEST(dgemm_strided_batched);
+        RUN_TEST(dgemm_batched);
+        RUN_TEST(dgemm_batched_scattered);
     }
 
     L1_VECTOR_TEST(dcopy, dcopy(N, x, 1, y, 1))
@@ -291,6 +345,22 @@ struct BLASDoubleTests : public BLASTestBase<double> {
     L3_TEST(dgemm_transAB,
             cblas_dgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N),
             hblas_dgemm(HblasColMajor, HblasTrans, HblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N));
+
+    L3_BATCHED_TEST(dgemm_strided_batched, b, b,
+                    cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, M, N_, K, alpha, Ap[b], M, Bp[b], K, beta, Cp[b], M),
+                    hblas_dgemm_strided_batched(HblasColMajor, HblasNoTrans, HblasNoTrans, M, N_, K, alpha,
+                                                Ap[0], M, size * size, Bp[0], K, size * size,
+                                                beta, Cp[0], M, size * size, batch));
+    // A and B in reverse order, which is still evenly spaced.
+    L3_BATCHED_TEST(dgemm_batched, batch - 1 - b, b,
+                    cblas_dgemm(CblasColMajor, CblasTrans, CblasTrans, M, N_, K, alpha, Ap[b], K, Bp[b], N_, beta, Cp[b], M),
+                    hblas_dgemm_batched(HblasColMajor, HblasTrans, HblasTrans, M, N_, K, alpha,
+                                        Ap.data(), K, Bp.data(), N_, beta, Cp.data(), M, batch));
+    // C out of order, which falls back to one gemm per matrix.
+    L3_BATCHED_TEST(dgemm_batched_scattered, b, (b * 5) % batch,
+                    cblas_dgemm(CblasColMajor, CblasNoTrans, CblasTrans, M, N_, K, alpha, Ap[b], M, Bp[b], N_, beta, Cp[b], M),
+                    hblas_dgemm_batched(HblasColMajor, HblasNoTrans, HblasTrans, M, N_, K, alpha,
+                                        Ap.data(), M, Bp.data(), N_, beta, Cp.data(), M, batch));
 };
 
 int main(int argc, char *argv[]) {
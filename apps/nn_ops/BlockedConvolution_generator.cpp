@@ -0,0 +1,169 @@
+// This generator implements direct convolution of tensors stored in a blocked
+// layout, and schedules for CPU and HVX.
+//
+// The pipeline implements the same operations as Convolution. The difference
+// is the layout: the depth dimensions of the input, filter and output are
+// split into blocks of block_size channels, and the channels of a block are
+// stored innermost (this is often called the NCHWc layout). Each block of the
+// output is then a whole vector, computed by multiplying a broadcast input
+// value by a vector of filter coefficients, without any im2col step or
+// reorganization of the data.
+
+// Input dimension: {block_size, input_width, input_height,
+// ceil(input_depth / block_size), input_batches}
+// Filter dimension: {block_size, filter_depth(=input_depth), filter_width,
+// filter_height, ceil(filter_batches / block_size)}
+// Output dimension: {block_size, output_width, output_height,
+// ceil(filter_batches / block_size), input_batches}
+// The output width and height are the same as Convolution.
+
+#include "common.h"
+#include <Halide.h>
+
+using Halide::Expr;
+using Halide::Func;
+using Halide::Generator;
+using Halide::GeneratorParam;
+using Halide::RDom;
+using Halide::TailStrategy;
+using Halide::Var;
+using Halide::BoundaryConditions::constant_exterior;
+using Halide::ConciseCasts::i16;
+using Halide::ConciseCasts::u16_sat;
+using Halide::ConciseCasts::u8_sat;
+
+class BlockedConvolution : public Generator<BlockedConvolution> {
+public:
+    // The number of channels in each block of the depth dimension.
+    GeneratorParam<int> block_size_{"block_size", 16};
+
+    // The number of output pixels computed at once along x. The accumulators
+    // for these pixels are kept in registers.
+    GeneratorParam<int> register_block_{"register_block", 4};
+
+    // Unsigned 8-bit input tensor, indexed by depth_in_block, input_x, input_y,
+    // depth_block, input_batch.
+    Input<Buffer<uint8_t>> input_{"input", 5};
+
+    // A 5D array of 8-bit filter coefficients indexed by output_depth_in_block,
+    // filter_depth, filter_x, filter_y, output_depth_block.
+    Input<Buffer<uint8_t>> filter_{"filter", 5};
+
+    // A 1D array of 32-bit biases, indexed by output depth.
+    Input<Buffer<int32_t>> bias_{"bias", 1};
+
+    // Offsets and multipliers for the input, filter, and output.
+    Input<int16_t> input_offset_{"input_offset", 0, -255, 0};
+    Input<int16_t> filter_offset_{"filter_offset", 0, -255, 0};
+
+    // Only the first input_depth_ channels of the input are used.
+    Input<int> input_depth_{"input_depth"};
+
+    // See Convolution for the meaning of these.
+    Input<int> stride_{"stride"};
+    Input<int> pad_width_{"pad_width"};
+    Input<int> pad_height_{"pad_height"};
+    Input<uint8_t> byte_zero_{"byte_zero"};
+
+    // Parameters for pointwise operations on the output.
+    Input<int> output_multiplier_{"output_multiplier"};
+    Input<int> output_shift_{"output_shift"};
+    Input<int> output_offset_{"output_offset", 0, 0, 255};
+    Input<uint8_t> output_min_{"output_min"};
+    Input<uint8_t> output_max_{"output_max"};
+
+    Output<Buffer<uint8_t>> output_{"output", 5};
+
+    void generate() {
+        // The algorithm.
+        const int block_size = block_size_;
+
+        // Some free variables, where x and y represent the spatial dimensions,
+        // and depth_block and depth the block and the channel within it.
+        Var x("x"), y("y"), depth("depth"), depth_block("depth_block"), batch("batch");
+
+        // For the input, add the offset and upcast to 16-bit.
+        Func input_with_offset("input_with_offset");
+        input_with_offset(depth, x, y, depth_block, batch) =
+            i16(input_(depth, x, y, depth_block, batch)) + input_offset_;
+
+        // Add a zero boundary condition to x and y dimensions of the input.
+        Func input_with_offset_bounded =
+            constant_exterior(input_with_offset, i16(byte_zero_),
+                              {{Expr(), Expr()},
+                               {0, input_.dim(1).extent()},
+                               {0, input_.dim(2).extent()},
+                               {Expr(), Expr()},
+                               {Expr(), Expr()}});
+
+        // For the filter, add the offset and upcast to 16-bit.
+        Func filter_with_offset("filter_with_offset");
+        filter_with_offset(depth, x, y, depth_block, batch) =
+            i16(filter_(depth, x, y, depth_block, batch)) + filter_offset_;
+
+        // Do the convolution in 32-bit. The reduction is over the unblocked
+        // input depth, which is innermost so that consecutive iterations read
+        // consecutive input values.
+        Func convolved("convolved");
+        RDom r(0, input_depth_, 0, filter_.dim(2).extent(), 0, filter_.dim(3).extent());
+        convolved(depth, x, y, depth_block, batch) +=
+            cast<int32_t>(filter_with_offset(depth, r.x, r.y, r.z, depth_block)) *
+            cast<int32_t>(input_with_offset_bounded(
+                r.x % block_size,
+                x * stride_ + r.y - pad_width_,
+                y * stride_ + r.z - pad_height_,
+                r.x / block_size,
+                batch));
+
+        Func scaled_plus_offset("scaled_plus_offset");
+        scaled_plus_offset(depth, x, y, depth_block, batch) =
+            multiply_quantized_multiplier(
+                convolved(depth, x, y, depth_block, batch) +
+                    bias_(depth_block * block_size + depth),
+                output_multiplier_, output_shift_) +
+            output_offset_;
+
+        // Saturate and narrow the output.
+        output_(depth, x, y, depth_block, batch) =
+            min(output_max_,
+                max(output_min_,
+                    u8_sat(u16_sat(scaled_plus_offset(depth, x, y, depth_block, batch)))));
+
+        // The schedule.
+        input_.dim(0).set_bounds(0, block_size);
+        filter_.dim(0).set_bounds(0, block_size);
+        output_.dim(0).set_bounds(0, block_size);
+
+        const bool use_hexagon =
+            get_target().features_any_of({Target::HVX_64, Target::HVX_128});
+
+        // Specifying .hexagon() on a Func will generate an RPC to run this stage
+        // on Hexagon. If Hexagon is the host (that is, the architecture is
+        // Hexagon), we have to omit the .hexagon() directive as we are already
+        // running on Hexagon.
+        if (use_hexagon && get_target().arch != Target::Hexagon) {
+            output_.hexagon();
+        }
+
+        // Each block of the output is computed as a vector, and
+        // register_block_ pixels of output along x at once.
+        Var xo("xo"), xi("xi");
+        output_.bound(depth, 0, block_size)
+            .vectorize(depth)
+            .split(x, xo, xi, register_block_, TailStrategy::GuardWithIf)
+            .unroll(xi)
+            .parallel(y);
+
+        convolved.compute_at(output_, xo)
+            .bound(depth, 0, block_size)
+            .bound_extent(x, register_block_)
+            .vectorize(depth)
+            .unroll(x);
+        convolved.update()
+            .reorder(depth, x, r.x, r.y, r.z)
+            .vectorize(depth)
+            .unroll(x);
+    }
+};
+
+HALIDE_REGISTER_GENERATOR(BlockedConvolution, BlockedConvolution)
@@ -3,19 +3,52 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <cctype>
 #include <cmath>
+#include <functional>
 #include <limits>
+#include <string>
+#include <vector>
 
 #include "halide_benchmark.h"
 
+#include "BlockedConvolution.h"
 #include "Convolution.h"
+#include "WinogradConvolution.h"
+#include "WinogradFilterTransform.h"
 #include "common_reference.h"
 
 #include "HalideBuffer.h"
 
+// The number of channels in each block of the BlockedConvolution layout. This
+// must match the block_size the generator is built with.
+const int kBlockSize = 16;
+
+// Hexagon's device_malloc implementation will also set the host
+// pointer if it is null, giving a zero copy buffer.
+template<typename T>
+void allocate_tensor(Halide::Runtime::Buffer<T> &tensor) {
+#ifdef HALIDE_RUNTIME_HEXAGON
+    tensor.device_malloc(halide_hexagon_device_interface());
+#else
+    tensor.allocate();
+#endif
+}
+
 int main(int argc, char **argv) {
-    if (argc < 5) {
-        printf("Usage: %s C W H N [stride pad_width pad_height filter_width filter_height output_min output_max]\n", argv[0]);
+    // The algorithm to benchmark is an optional first argument. 'auto'
+    // benchmarks every algorithm that supports the layer shape and reports
+    // the fastest one.
+    std::string algorithm = "direct";
+    if (argc > 1 && !isdigit(argv[1][0])) {
+        algorithm = argv[1];
+        argc--;
+        argv++;
+    }
+
+    if (argc < 5 || (algorithm != "direct" && algorithm != "winograd" &&
+                     algorithm != "blocked" && algorithm != "auto")) {
+        printf("Usage: %s [direct|winograd|blocked|auto] C W H N [stride pad_width pad_height filter_width filter_height output_min output_max]\n", argv[0]);
         return 0;
     }
 
@@ -69,8 +102,6 @@ int main(int argc, char **argv) {
     if (argc > 20) output_min = atoi(argv[18]);
     if (argc > 21) output_max = atoi(argv[19]);
 
-    // Hexagon's device_malloc implementation will also set the host
-    // pointer if it is null, giving a zero copy buffer.
     Halide::Runtime::Buffer<uint8_t> input_tensor(nullptr, C, W, H, N);
     Halide::Runtime::Buffer<uint8_t> filter_tensor(nullptr,
                                                    input_depth, filter_width, filter_height, output_depth);
@@ -82,17 +113,10 @@ int main(int argc, char **argv) {
     Halide::Runtime::Buffer<uint8_t> output_tensor(nullptr,
                                                    output_depth, output_width, output_height, N);
 
-#ifdef HALIDE_RUNTIME_HEXAGON
-    input_tensor.device_malloc(halide_hexagon_device_interface());
-    filter_tensor.device_malloc(halide_hexagon_device_interface());
-    bias_tensor.device_malloc(halide_hexagon_device_interface());
-    output_tensor.device_malloc(halide_hexagon_device_interface());
-#else
-    input_tensor.allocate();
-    filter_tensor.allocate();
-    bias_tensor.allocate();
-    output_tensor.allocate();
-#endif
+    allocate_tensor(input_tensor);
+    allocate_tensor(filter_tensor);
+    allocate_tensor(bias_tensor);
+    allocate_tensor(output_tensor);
 
     input_tensor.for_each_value([](uint8_t &x) {
         x = static_cast<uint8_t>(rand());
@@ -113,33 +137,18 @@ int main(int argc, char **argv) {
     halide_hexagon_power_hvx_on(nullptr);
 #endif
 
-    printf("Running pipeline...\n");
-    double time = Halide::Tools::benchmark([&]() {
-        int result = Convolution(input_tensor, filter_tensor, bias_tensor,
-                                 input_offset, filter_offset, input_depth,
-                                 stride, pad_width, pad_height, byte_zero,
-                                 output_multiplier, output_shift, output_offset,
-                                 output_min, output_max, output_tensor);
-        if (result != 0) {
-            printf("pipeline failed! %d\n", result);
-        }
-    });
-
-    printf("Done, time: %g s\n", time);
-
-#ifdef HALIDE_RUNTIME_HEXAGON
-    // We're done with HVX, power it off, and reset the performance mode
-    // to default to save power.
-    halide_hexagon_power_hvx_off(nullptr);
-    halide_hexagon_set_performance_mode(nullptr, halide_hexagon_power_default);
-#endif
-
-    // Copy the output back to the host. If the buffer is zero-copy (as
-    // it should be on a real device), this will be a no-op.
-    output_tensor.copy_to_host();
+    // Winograd's algorithm only handles 3x3 filters with a stride of 1, and
+    // deeper inputs overflow its 32-bit accumulators.
+    const bool winograd_supported =
+        filter_width == 3 && filter_height == 3 && stride == 1 && input_depth <= 512;
+    if (algorithm == "winograd" && !winograd_supported) {
+        printf("Winograd convolution needs a 3x3 filter, a stride of 1, and an input depth of at most 512\n");
+        return 0;
+    }
 
-    // Validate that the algorithm did what we expect.
-    output_tensor.for_each_element([&](int c, int x, int y, int b) {
+    // Compute the expected output.
+    Halide::Runtime::Buffer<uint8_t> reference_tensor(output_depth, output_width, output_height, N);
+    reference_tensor.for_each_element([&](int c, int x, int y, int b) {
         int32_t output = bias_tensor(c);
 
         for (int filter_y = 0; filter_y < filter_height; filter_y++) {
@@ -165,12 +174,153 @@ int main(int argc, char **argv) {
         output += output_offset;
         output = std::max(output, (int32_t)output_min);
         output = std::min(output, (int32_t)output_max);
-        if (output != output_tensor(c, x, y, b)) {
-            printf("Mismatch at %d %d: %d != %d\n", x, y, output, output_tensor(c, x, y, b));
-            abort();
-        }
+        reference_tensor(c, x, y, b) = output;
     });
 
+    // The blocked layout rounds the depths up to a multiple of the block
+    // size. The extra channels are never used in the result.
+    const int input_blocks = (C + kBlockSize - 1) / kBlockSize;
+    const int output_blocks = (output_depth + kBlockSize - 1) / kBlockSize;
+    Halide::Runtime::Buffer<uint8_t> blocked_input_tensor(nullptr, kBlockSize, W, H, input_blocks, N);
+    Halide::Runtime::Buffer<uint8_t> blocked_filter_tensor(nullptr,
+                                                           kBlockSize, input_depth, filter_width, filter_height, output_blocks);
+    Halide::Runtime::Buffer<int32_t> blocked_bias_tensor(nullptr, output_blocks * kBlockSize);
+    Halide::Runtime::Buffer<uint8_t> blocked_output_tensor(nullptr,
+                                                           kBlockSize, output_width, output_height, output_blocks, N);
+
+    // The filter is transformed once, ahead of time, for Winograd's algorithm.
+    Halide::Runtime::Buffer<int16_t> winograd_filter_tensor(nullptr, output_depth, input_depth, 4, 4);
+
+    // Each algorithm, and whether it applies to this layer shape. The
+    // pipelines write the result to output_tensor, in the unblocked layout.
+    // Only the call to the pipeline is timed.
+    struct Algorithm {
+        const char *name;
+        bool supported;
+        std::function<int()> prepare;
+        std::function<int()> run;
+        std::function<void()> finish;
+    };
+
+    auto run_direct = [&]() {
+        return Convolution(input_tensor, filter_tensor, bias_tensor,
+                           input_offset, filter_offset, input_depth,
+                           stride, pad_width, pad_height, byte_zero,
+                           output_multiplier, output_shift, output_offset,
+                           output_min, output_max, output_tensor);
+    };
+
+    auto prepare_winograd = [&]() {
+        allocate_tensor(winograd_filter_tensor);
+        return WinogradFilterTransform(filter_tensor, filter_offset, winograd_filter_tensor);
+    };
+    auto run_winograd = [&]() {
+        return WinogradConvolution(input_tensor, winograd_filter_tensor, bias_tensor,
+                                   input_offset, input_depth,
+                                   pad_width, pad_height, byte_zero,
+                                   output_multiplier, output_shift, output_offset,
+                                   output_min, output_max, output_tensor);
+    };
+
+    auto prepare_blocked = [&]() {
+        allocate_tensor(blocked_input_tensor);
+        allocate_tensor(blocked_filter_tensor);
+        allocate_tensor(blocked_bias_tensor);
+        allocate_tensor(blocked_output_tensor);
+        blocked_input_tensor.for_each_element([&](int c, int x, int y, int c_block, int b) {
+            int index_c = c_block * kBlockSize + c;
+            blocked_input_tensor(c, x, y, c_block, b) =
+                index_c < C ? input_tensor(index_c, x, y, b) : 0;
+        });
+        blocked_filter_tensor.for_each_element([&](int c, int index_c, int x, int y, int c_block) {
+            int output_c = c_block * kBlockSize + c;
+            blocked_filter_tensor(c, index_c, x, y, c_block) =
+                output_c < output_depth ? filter_tensor(index_c, x, y, output_c) : 0;
+        });
+        blocked_bias_tensor.for_each_element([&](int c) {
+            blocked_bias_tensor(c) = c < output_depth ? bias_tensor(c) : 0;
+        });
+        return 0;
+    };
+    auto run_blocked = [&]() {
+        return BlockedConvolution(blocked_input_tensor, blocked_filter_tensor, blocked_bias_tensor,
+                                  input_offset, filter_offset, input_depth,
+                                  stride, pad_width, pad_height, byte_zero,
+                                  output_multiplier, output_shift, output_offset,
+                                  output_min, output_max, blocked_output_tensor);
+    };
+    auto finish_blocked = [&]() {
+        blocked_output_tensor.copy_to_host();
+        output_tensor.for_each_element([&](int c, int x, int y, int b) {
+            output_tensor(c, x, y, b) =
+                blocked_output_tensor(c % kBlockSize, x, y, c / kBlockSize, b);
+        });
+    };
+
+    std::vector<Algorithm> algorithms = {
+        {"direct", true, nullptr, run_direct, nullptr},
+        {"winograd", winograd_supported, prepare_winograd, run_winograd, nullptr},
+        {"blocked", true, prepare_blocked, run_blocked, finish_blocked},
+    };
+
+    const char *fastest = nullptr;
+    double fastest_time = std::numeric_limits<double>::infinity();
+    for (const Algorithm &a : algorithms) {
+        if (!a.supported || (algorithm != "auto" && algorithm != a.name)) {
+            continue;
+        }
+
+        if (a.prepare) {
+            int result = a.prepare();
+            if (result != 0) {
+                printf("%s: preparing the pipeline failed! %d\n", a.name, result);
+                abort();
+            }
+        }
+
+        printf("Running %s pipeline...\n", a.name);
+        double time = Halide::Tools::benchmark([&]() {
+            int result = a.run();
+            if (result != 0) {
+                printf("pipeline failed! %d\n", result);
+            }
+        });
+
+        printf("Done, time: %g s\n", time);
+        if (time < fastest_time) {
+            fastest = a.name;
+            fastest_time = time;
+        }
+
+        // Copy the output back to the host. If the buffer is zero-copy (as
+        // it should be on a real device), this will be a no-op.
+        output_tensor.copy_to_host();
+        if (a.finish) {
+            a.finish();
+        }
+
+        // Validate that the algorithm did what we expect.
+        output_tensor.for_each_element([&](int c, int x, int y, int b) {
+            if (reference_tensor(c, x, y, b) != output_tensor(c, x, y, b)) {
+                printf("%s: mismatch at %d %d: %d != %d\n", a.name, x, y,
+                       reference_tensor(c, x, y, b), output_tensor(c, x, y, b));
+                abort();
+            }
+        });
+    }
+
+#ifdef HALIDE_RUNTIME_HEXAGON
+    // We're done with HVX, power it off, and reset the performance mode
+    // to default to save power.
+    halide_hexagon_power_hvx_off(nullptr);
+    halide_hexagon_set_performance_mode(nullptr, halide_hexagon_power_default);
+#endif
+
+    if (algorithm == "auto") {
+        printf("Fastest algorithm for %dx%dx%dx%d with a %dx%d filter: %s\n",
+               C, W, H, N, filter_width, filter_height, fastest);
+    }
+
     printf("Success!\n");
     return 0;
 }
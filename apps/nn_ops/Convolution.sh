@@ -1,5 +1,5 @@
 CONVOLUTION=$1
-# Columns are: schedule C W H N filter_width, filter_height, output_depth,
+# Columns are: [algorithm] C W H N filter_width, filter_height, output_depth,
 # input_offset, filter_offset, input_depth, stride, pad_width, pad_height,
 # byte_zero, output_multiplier, output_shift, output_offset, output_min,
 # output_max
@@ -10,3 +10,9 @@ $CONVOLUTION 8 17 17 1 3 3 8 -128 -128 8 2 1 1 0
 $CONVOLUTION 8 17 17 1 3 3 16 -128 -128 8 1 1 1 0
 $CONVOLUTION 8 17 17 1 3 3 16 -128 -140 8 1 1 1 0
 $CONVOLUTION 12 17 17 1 3 3 16 -128 -140 12 1 1 1 0
+
+# Compare all of the algorithms that apply to each layer shape. Winograd
+# convolution only applies to 3x3 stride 1 layers.
+$CONVOLUTION auto 32 28 28 1 3 3 32 -128 -128 32 1 1 1 0
+$CONVOLUTION auto 64 14 14 1 3 3 64 -128 -140 64 1 1 1 0
+$CONVOLUTION auto 12 17 17 1 3 3 16 -128 -140 12 2 1 1 0
@@ -0,0 +1,289 @@
+// These generators implement 3x3, stride 1 convolution using Winograd's
+// minimal filtering algorithm F(2x2, 3x3), and schedules for CPU and HVX.
+//
+// Each 2x2 tile of the output is computed from a 4x4 tile of the input as
+// Y = A^T [sum over input depth of (G g G^T) * (B^T d B)] A, where g is the
+// 3x3 filter and d is the input tile. This needs 16 multiplies per output
+// tile and input channel, instead of the 36 of a direct convolution.
+//
+// The filter transform G g G^T doesn't depend on the input, so it is done
+// ahead of time by WinogradFilterTransform. WinogradConvolution then
+// implements the following operations:
+// (1) an input offset is added to the 8-bit input
+// (2) each 4x4 tile of the input is transformed by B^T d B
+// (3) the transformed input and filter are multiplied and summed over the
+// input depth
+// (4) the products are transformed back to 2x2 tiles of output by A^T m A
+// (5) convolution result is right-shifted and multiplied by a multiplier
+// (6) an output offset is added to the quantized convolution result
+// (7) the output is saturated and narrowed to 8-bit
+//
+// G has entries of 1/2. To keep everything in exact integer arithmetic, the
+// filter transform uses 2G instead, and the result of (4) is divided by 4.
+// Larger tiles such as F(4x4, 3x3) need much larger scale factors, which
+// overflow the 32-bit accumulators for realistic depths, so they are not
+// implemented. With 8-bit data, the input depth must be at most 512 to avoid
+// overflow.
+
+// Filter dimension: {filter_depth, 3, 3, filter_batches}
+// Transformed filter dimension: {filter_batches, filter_depth, 4, 4}
+// Input and output dimensions are the same as Convolution, with a stride of 1.
+
+#include "common.h"
+#include <Halide.h>
+
+using Halide::Expr;
+using Halide::Func;
+using Halide::Generator;
+using Halide::RDom;
+using Halide::TailStrategy;
+using Halide::Var;
+using Halide::BoundaryConditions::constant_exterior;
+using Halide::ConciseCasts::i16;
+using Halide::ConciseCasts::i32;
+using Halide::ConciseCasts::u16_sat;
+using Halide::ConciseCasts::u8_sat;
+
+namespace {
+
+// The rows of 2G, applied to a column of 3 filter coefficients.
+std::vector<Expr> filter_transform(Expr g0, Expr g1, Expr g2) {
+    return {2 * g0, g0 + g1 + g2, g0 - g1 + g2, 2 * g2};
+}
+
+// The rows of B^T, applied to a column of 4 input values.
+std::vector<Expr> input_transform(Expr d0, Expr d1, Expr d2, Expr d3) {
+    return {d0 - d2, d1 + d2, d2 - d1, d1 - d3};
+}
+
+// The rows of A^T, applied to a column of 4 products.
+std::vector<Expr> output_transform(Expr m0, Expr m1, Expr m2, Expr m3) {
+    return {m0 + m1 + m2, m1 - m2 - m3};
+}
+
+int vector_size_u8(const Halide::Target &target) {
+    if (target.has_feature(Halide::Target::HVX_64)) {
+        return 64;
+    } else if (target.has_feature(Halide::Target::HVX_128)) {
+        return 128;
+    }
+    return target.natural_vector_size<uint8_t>();
+}
+
+}  // namespace
+
+class WinogradFilterTransform : public Generator<WinogradFilterTransform> {
+public:
+    // A 4D array of 8-bit filter coefficients indexed by filter_depth, filter_x,
+    // filter_y, filter_batch (aka. output_depth). The filter must be 3x3.
+    Input<Buffer<uint8_t>> filter_{"filter", 4};
+
+    Input<int16_t> filter_offset_{"filter_offset", 0, -255, 0};
+
+    // The transformed filter, indexed by output_depth, filter_depth and the
+    // two dimensions of the 4x4 transform. The output depth is innermost, so
+    // that WinogradConvolution can vectorize across it.
+    Output<Buffer<int16_t>> output_{"output", 4};
+
+    void generate() {
+        Var depth("depth"), filter_depth("filter_depth"), u("u"), v("v"), x("x"), y("y");
+
+        filter_.dim(1).set_bounds(0, 3).dim(2).set_bounds(0, 3);
+
+        Func filter_with_offset("filter_with_offset");
+        filter_with_offset(filter_depth, x, y, depth) =
+            i16(filter_(filter_depth, x, y, depth)) + filter_offset_;
+
+        // Transform the columns, then the rows.
+        Func transformed_x("transformed_x");
+        transformed_x(filter_depth, u, y, depth) =
+            mux(u, filter_transform(filter_with_offset(filter_depth, 0, y, depth),
+                                    filter_with_offset(filter_depth, 1, y, depth),
+                                    filter_with_offset(filter_depth, 2, y, depth)));
+
+        output_(depth, filter_depth, u, v) =
+            mux(v, filter_transform(transformed_x(filter_depth, u, 0, depth),
+                                    transformed_x(filter_depth, u, 1, depth),
+                                    transformed_x(filter_depth, u, 2, depth)));
+
+        // This runs once per filter, so the schedule only needs to make the
+        // muxes disappear.
+        output_.bound(u, 0, 4)
+            .bound(v, 0, 4)
+            .reorder(depth, u, v, filter_depth)
+            .unroll(u)
+            .unroll(v);
+    }
+};
+
+class WinogradConvolution : public Generator<WinogradConvolution> {
+public:
+    // Unsigned 8-bit input tensor, indexed by input_depth, input_x, input_y,
+    // input_batch.
+    Input<Buffer<uint8_t>> input_{"input", 4};
+
+    // The filter, as transformed by WinogradFilterTransform. The filter offset
+    // has already been applied.
+    Input<Buffer<int16_t>> filter_{"filter", 4};
+
+    // A 1D array of 32-bit biases. The bias should be added to the depth
+    // dimension of the output (i.e., # filter batches).
+    Input<Buffer<int32_t>> bias_{"bias", 1};
+
+    // Offset for the input.
+    Input<int16_t> input_offset_{"input_offset", 0, -255, 0};
+
+    // For each x, y, batch, only the first input_depth_ elements can be non-zero.
+    // This value should be <= input_.dim(0).extent()
+    Input<int> input_depth_{"input_depth"};
+
+    Input<int> pad_width_{"pad_width"};
+    Input<int> pad_height_{"pad_height"};
+    // byte_zero_ denotes the value padded at the input tensor boundary (in the x
+    // and y dimensions).
+    Input<uint8_t> byte_zero_{"byte_zero"};
+
+    // Parameters for pointwise operations on the output.
+    Input<int> output_multiplier_{"output_multiplier"};
+    Input<int> output_shift_{"output_shift"};
+    Input<int> output_offset_{"output_offset", 0, 0, 255};
+    Input<uint8_t> output_min_{"output_min"};
+    Input<uint8_t> output_max_{"output_max"};
+
+    Output<Buffer<uint8_t>> output_{"output", 4};
+
+    void generate() {
+        // The algorithm.
+
+        // Some free variables, where x and y represent the spatial dimensions,
+        // and tile_x, tile_y the 2x2 tiles of the output.
+        Var x("x"), y("y"), depth("depth"), batch("batch");
+        Var tile_x("tile_x"), tile_y("tile_y"), u("u"), v("v");
+
+        // For the input, add the offset and upcast to 16-bit.
+        Func input_with_offset("input_with_offset");
+        input_with_offset(depth, x, y, batch) =
+            i16(input_(depth, x, y, batch)) + input_offset_;
+
+        // Add a zero boundary condition to x and y dimensions of the input.
+        Func input_with_offset_bounded =
+            constant_exterior(input_with_offset, i16(byte_zero_),
+                              {{Expr(), Expr()},
+                               {0, input_.dim(1).extent()},
+                               {0, input_.dim(2).extent()},
+                               {Expr(), Expr()}});
+
+        // The input tile for each 2x2 tile of the output, shifted spatially
+        // by -[pad_width, pad_height]. The tiles overlap by 2.
+        auto input_tile = [&](Expr depth, Expr i, Expr j, Expr batch) {
+            return input_with_offset_bounded(depth,
+                                             tile_x * 2 + i - pad_width_,
+                                             tile_y * 2 + j - pad_height_,
+                                             batch);
+        };
+
+        // Transform the input tiles, first the columns, then the rows.
+        Func transformed_input("transformed_input");
+        std::vector<Expr> transformed_columns;
+        for (int j = 0; j < 4; j++) {
+            transformed_columns.push_back(
+                mux(u, input_transform(input_tile(depth, 0, j, batch),
+                                       input_tile(depth, 1, j, batch),
+                                       input_tile(depth, 2, j, batch),
+                                       input_tile(depth, 3, j, batch))));
+        }
+        transformed_input(depth, tile_x, tile_y, u, v, batch) =
+            mux(v, input_transform(transformed_columns[0], transformed_columns[1],
+                                   transformed_columns[2], transformed_columns[3]));
+
+        // Multiply by the transformed filter and sum over the input depth.
+        Func products("products");
+        RDom r(0, input_depth_);
+        products(depth, tile_x, tile_y, u, v, batch) +=
+            i32(filter_(depth, r, u, v)) *
+            i32(transformed_input(r, tile_x, tile_y, u, v, batch));
+
+        // Transform the products back to tiles of the output.
+        Expr x_in_tile = x % 2, y_in_tile = y % 2;
+        std::vector<Expr> products_x;
+        for (int j = 0; j < 4; j++) {
+            auto m = [&](int i) {
+                return products(depth, x / 2, y / 2, i, j, batch);
+            };
+            products_x.push_back(mux(x_in_tile, output_transform(m(0), m(1), m(2), m(3))));
+        }
+        // The transformed filter is scaled by 4, and the division is exact.
+        Func convolved("convolved");
+        convolved(depth, x, y, batch) =
+            mux(y_in_tile, output_transform(products_x[0], products_x[1],
+                                            products_x[2], products_x[3])) >> 2;
+
+        Func scaled_plus_offset("scaled_plus_offset");
+        scaled_plus_offset(depth, x, y, batch) =
+            multiply_quantized_multiplier(
+                convolved(depth, x, y, batch) + bias_(depth), output_multiplier_,
+                output_shift_) +
+            output_offset_;
+
+        // Saturate and narrow the output.
+        output_(depth, x, y, batch) =
+            min(output_max_,
+                max(output_min_,
+                    u8_sat(u16_sat(scaled_plus_offset(depth, x, y, batch)))));
+
+        // The schedule.
+        filter_.dim(2).set_bounds(0, 4).dim(3).set_bounds(0, 4);
+        // The position within a tile must be known at compile time.
+        output_.dim(1).set_min(0).dim(2).set_min(0);
+
+        const bool use_hexagon =
+            get_target().features_any_of({Target::HVX_64, Target::HVX_128});
+
+        // Specifying .hexagon() on a Func will generate an RPC to run this stage
+        // on Hexagon. If Hexagon is the host (that is, the architecture is
+        // Hexagon), we have to omit the .hexagon() directive as we are already
+        // running on Hexagon.
+        if (use_hexagon && get_target().arch != Target::Hexagon) {
+            output_.hexagon();
+        }
+
+        const int vector_size = vector_size_u8(get_target());
+
+        // We only perform vectorization when the depth >= vector size.
+        Expr can_vectorize_across_depth =
+            filter_.dim(0).extent() >= vector_size;
+        Expr can_vectorize_across_input_depth =
+            input_depth_ >= vector_size / 2;
+
+        // Compute a row of 2x2 output tiles at a time. The position within
+        // each tile is unrolled, so the output transform simplifies away.
+        Var xo("xo"), yo("yo"), xi("xi"), yi("yi");
+        output_.tile(x, y, xo, yo, xi, yi, 2, 2, TailStrategy::GuardWithIf)
+            .reorder(depth, xi, yi, xo, yo, batch)
+            .unroll(xi)
+            .unroll(yi)
+            .parallel(yo)
+            .specialize(can_vectorize_across_depth)
+            .vectorize(depth, vector_size);
+
+        products.compute_at(output_, yo)
+            .specialize(can_vectorize_across_depth)
+            .vectorize(depth, vector_size);
+        products.update()
+            .reorder(depth, r, u, v, tile_x)
+            .specialize(can_vectorize_across_depth)
+            .vectorize(depth, vector_size);
+
+        transformed_input.compute_at(output_, yo)
+            .bound(u, 0, 4)
+            .bound(v, 0, 4)
+            .reorder(depth, u, v, tile_x)
+            .unroll(u)
+            .unroll(v)
+            .specialize(can_vectorize_across_input_depth)
+            .vectorize(depth, vector_size / 2);
+    }
+};
+
+HALIDE_REGISTER_GENERATOR(WinogradFilterTransform, WinogradFilterTransform)
+HALIDE_REGISTER_GENERATOR(WinogradConvolution, WinogradConvolution)
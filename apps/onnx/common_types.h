@@ -4,6 +4,8 @@
 #include "Halide.h"
 #include "onnx_converter.h"
 
+class ActivationArena;
+
 struct HalideModel {
     std::shared_ptr<Model> model;
     std::shared_ptr<Halide::Pipeline> rep;
@@ -11,6 +13,8 @@ struct HalideModel {
     std::unordered_map<std::string, int> input_types;
     std::vector<std::string> output_names;
     std::vector<int> output_types;
+    // Set by DefaultSchedule: serves the activation buffers of the model.
+    std::shared_ptr<ActivationArena> arena;
 };
 
 #endif
@@ -43,10 +43,13 @@ class HalideBackend(BackendBase):
 
         prepared = halide_model.Model()
         prepared.BuildFromOnnxModel(model)
-        # Optimize the schedule of nontrivial models to make sure they
-        # complete in a reasonable amount of time
-        if len(model.graph.node) > 10:
+        # Schedule nontrivial models to make sure they complete in a
+        # reasonable amount of time. Fusing ops is much faster to compile
+        # than searching for a schedule with the autoscheduler.
+        if kwargs.get('autoschedule', False):
             prepared.OptimizeSchedule()
+        elif len(model.graph.node) > 10:
+            prepared.DefaultSchedule()
         return prepared
 
     @classmethod
@@ -7,12 +7,153 @@
 #include "denormal_disabler.h"
 #include "onnx_converter.h"
 #include <fstream>
+#include <mutex>
 #include <random>
+#include <sstream>
 #include <sys/time.h>
 #include <unordered_set>
 
 namespace py = pybind11;
 
+// Serves the intermediate buffers of a model from the activation buffers
+// planned by the converter, so that running the model repeatedly doesn't
+// go back to the system allocator for every intermediate tensor.
+//
+// The allocator is only told the size of each allocation, so an
+// allocation is matched to the first planned tensor that hasn't been
+// allocated yet in the current run and whose size, with or without the
+// padding Halide adds to heap allocations, is the size requested. It gets
+// the activation buffer the plan assigned to that tensor. Allocations that match no
+// tensor, or whose buffer is still in use (e.g. because the pipeline
+// doesn't release tensors in the planned order), come from the system
+// allocator instead.
+class ActivationArena {
+public:
+    explicit ActivationArena(const Model &model) {
+        for (int64_t size : model.activation_buffers) {
+            slots_.push_back(Slot{nullptr, (size_t)size, false});
+        }
+        for (const auto &it : model.schedule) {
+            const TensorSchedule &ts = it.second;
+            if (ts.buffer >= 0) {
+                planned_.push_back(Planned{ts.produced_at, (size_t)ts.bytes,
+                                           (size_t)ts.allocation_bytes, ts.buffer, false});
+            }
+        }
+        std::sort(planned_.begin(), planned_.end(),
+                  [](const Planned &a, const Planned &b) {
+                      return a.produced_at < b.produced_at;
+                  });
+    }
+
+    ~ActivationArena() {
+        for (const Slot &slot : slots_) {
+            free(slot.ptr);
+        }
+    }
+
+    // Only one run at a time can use the arena. Returns false if another
+    // thread is already running the model.
+    bool begin_run() {
+        if (!run_mutex_.try_lock()) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (Planned &p : planned_) {
+            p.allocated = false;
+        }
+        return true;
+    }
+
+    void end_run() {
+        run_mutex_.unlock();
+    }
+
+    void *allocate(size_t size) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (Planned &p : planned_) {
+            if (p.allocated || size < p.bytes || size > p.allocation_bytes) {
+                continue;
+            }
+            Slot &slot = slots_[p.buffer];
+            if (slot.in_use) {
+                break;
+            }
+            if (!slot.ptr) {
+                slot.ptr = aligned_malloc(slot.capacity);
+                if (!slot.ptr) {
+                    return nullptr;
+                }
+            }
+            p.allocated = true;
+            slot.in_use = true;
+            stats_.hits++;
+            return slot.ptr;
+        }
+        stats_.fallbacks++;
+        return aligned_malloc(size);
+    }
+
+    void release(void *ptr) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (Slot &slot : slots_) {
+            if (slot.ptr == ptr) {
+                slot.in_use = false;
+                return;
+            }
+        }
+        free(ptr);
+    }
+
+    // How many allocations were served from the activation buffers, and
+    // how many fell through to the system allocator, over all runs.
+    struct Stats {
+        int64_t hits = 0;
+        int64_t fallbacks = 0;
+    };
+
+    Stats stats() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    // The arena used by the run in progress on this thread. The buffers
+    // of root tensors are allocated and freed by the thread calling
+    // realize; allocations made by the thread pool use the system
+    // allocator.
+    static thread_local ActivationArena *active;
+
+private:
+    struct Slot {
+        void *ptr;
+        size_t capacity;
+        bool in_use;
+    };
+
+    struct Planned {
+        int produced_at;
+        size_t bytes;
+        size_t allocation_bytes;
+        int buffer;
+        bool allocated;
+    };
+
+    static void *aligned_malloc(size_t size) {
+        void *ptr = nullptr;
+        if (posix_memalign(&ptr, 128, size) != 0) {
+            return nullptr;
+        }
+        return ptr;
+    }
+
+    std::mutex mutex_, run_mutex_;
+    std::vector<Slot> slots_;
+    std::vector<Planned> planned_;
+    Stats stats_;
+};
+
+thread_local ActivationArena *ActivationArena::active = nullptr;
+
 namespace {
 
 HalideModel convert_onnx_model(
@@ -62,6 +203,41 @@ HalideModel convert_onnx_model(
     return result;
 }
 
+void *arena_malloc(void *user_context, size_t size) {
+    if (ActivationArena::active) {
+        return ActivationArena::active->allocate(size);
+    }
+    void *ptr = nullptr;
+    return posix_memalign(&ptr, 128, size) == 0 ? ptr : nullptr;
+}
+
+void arena_free(void *user_context, void *ptr) {
+    if (ActivationArena::active) {
+        ActivationArena::active->release(ptr);
+    } else {
+        free(ptr);
+    }
+}
+
+// Makes the arena of a model active for the duration of a run.
+class ScopedArena {
+public:
+    explicit ScopedArena(const HalideModel &pipeline) {
+        if (ActivationArena::active) {
+            throw std::runtime_error("A model can't be run while this thread is running another one");
+        }
+        if (pipeline.arena && pipeline.arena->begin_run()) {
+            ActivationArena::active = pipeline.arena.get();
+        }
+    }
+    ~ScopedArena() {
+        if (ActivationArena::active) {
+            ActivationArena::active->end_run();
+            ActivationArena::active = nullptr;
+        }
+    }
+};
+
 std::string auto_schedule(const HalideModel &pipeline) {
     // Generate a schedule for the pipeline.
     Halide::Target tgt = Halide::get_host_target();
@@ -69,6 +245,55 @@ std::string auto_schedule(const HalideModel &pipeline) {
     return schedule.schedule_source;
 }
 
+std::string default_schedule(HalideModel &pipeline) {
+    // Fuse and schedule the model using the plan made by the converter,
+    // and serve its intermediates from the planned activation buffers.
+    Halide::Target tgt = Halide::get_host_target();
+    schedule_model(*pipeline.model, tgt);
+    pipeline.arena = std::make_shared<ActivationArena>(*pipeline.model);
+    pipeline.rep->set_custom_allocator(&arena_malloc, &arena_free);
+
+    // Describe the decisions made, one materialized tensor per line.
+    std::map<int, std::string> lines;
+    int64_t total_bytes = 0;
+    for (const auto &it : pipeline.model->schedule) {
+        const TensorSchedule &ts = it.second;
+        if (ts.placement != TensorSchedule::Root) {
+            continue;
+        }
+        std::ostringstream line;
+        line << it.first;
+        for (const auto &member : pipeline.model->schedule) {
+            if (member.second.group == it.first) {
+                line << " <- " << member.first;
+            }
+        }
+        if (ts.layout == TensorSchedule::NCHW) {
+            line << " [NCHW]";
+        } else if (ts.layout == TensorSchedule::NHWC) {
+            line << " [NHWC]";
+        }
+        if (ts.buffer >= 0) {
+            line << " buffer " << ts.buffer;
+            total_bytes += ts.allocation_bytes;
+        }
+        lines[ts.produced_at] += line.str() + "\n";
+    }
+    int64_t planned_bytes = 0;
+    for (int64_t size : pipeline.model->activation_buffers) {
+        planned_bytes += size;
+    }
+
+    std::ostringstream result;
+    for (const auto &it : lines) {
+        result << it.second;
+    }
+    result << pipeline.model->activation_buffers.size()
+           << " activation buffers, " << planned_bytes << " bytes ("
+           << total_bytes << " bytes without reuse)\n";
+    return result.str();
+}
+
 template<typename T>
 struct Distribution {
     typedef typename std::conditional<
@@ -353,7 +578,10 @@ std::vector<py::array> run(
         tgt.set_feature(Halide::Target::CUDA, true);
     }
 
-    pipeline.rep->realize(real, tgt);
+    {
+        ScopedArena scoped_arena(pipeline);
+        pipeline.rep->realize(real, tgt);
+    }
 
     std::vector<py::array> results;
 
@@ -469,7 +697,10 @@ double benchmark(
     if (device == "CUDA") {
         tgt.set_feature(Halide::Target::CUDA, true);
     }
-    pipeline.rep->realize(real, tgt);
+    {
+        ScopedArena scoped_arena(pipeline);
+        pipeline.rep->realize(real, tgt);
+    }
 
     // Now benchmark by computing the value of the outputs num_iter times
     struct timespec start;
@@ -479,6 +710,7 @@ double benchmark(
         // Increment the coefficients store in the cache evictor: this ensures that
         // all the data left in caches from the previous iteration is flushed out.
         cache_evictor.flush_caches();
+        ScopedArena scoped_arena(pipeline);
         pipeline.rep->realize(real, tgt);
     }
     clock_gettime(CLOCK_REALTIME, &end);
@@ -527,6 +759,14 @@ void compile(
         std::string("/tmp/") + lib_name + ".h", inputs, func_name, tgt);
 }
 
+std::map<std::string, int64_t> activation_arena_stats(const HalideModel &pipeline) {
+    if (!pipeline.arena) {
+        throw std::invalid_argument("The model has no activation arena: call DefaultSchedule first");
+    }
+    ActivationArena::Stats stats = pipeline.arena->stats();
+    return {{"hits", stats.hits}, {"fallbacks", stats.fallbacks}};
+}
+
 void print_loop_nest(const HalideModel &pipeline) {
     pipeline.rep->print_loop_nest();
 }
@@ -560,9 +800,17 @@ PYBIND11_MODULE(model_cpp, m) {
         "AutoSchedule",
         &auto_schedule,
         "A function to automatic schedule HalideModel.");
+    m.def(
+        "DefaultSchedule",
+        &default_schedule,
+        "Schedule HalideModel by fusing elementwise ops and reusing activation buffers, without searching.");
     m.def("Run", &run, "A function to JIT compile and run HalideModel.");
     m.def("Benchmark", &benchmark, "A function to benchmark the model");
     m.def("Compile", &compile, "Compile the pipeline");
+    m.def(
+        "ActivationArenaStats",
+        &activation_arena_stats,
+        "Count the allocations served from the activation buffers, and those that fell through to the system allocator");
     m.def(
         "PrintLoopNest",
         &print_loop_nest,
@@ -29,6 +29,11 @@ class Model():
             raise Exception("model not initialized, call BuildFromOnnxModel first")
         return model_cpp.AutoSchedule(self.pipeline)
 
+    def DefaultSchedule(self):
+        if not self.pipeline:
+            raise Exception("model not initialized, call BuildFromOnnxModel first")
+        return model_cpp.DefaultSchedule(self.pipeline)
+
     def run(self, inputs, device=''):
         if not self.pipeline:
             raise Exception("model not initialized, call BuildFromOnnxModel first")
@@ -39,6 +44,11 @@ class Model():
             raise Exception("model not initialized, call BuildFromOnnxModel first")
         return model_cpp.Benchmark(self.pipeline, num_iters, device)
 
+    def ActivationArenaStats(self):
+        if not self.pipeline:
+            raise Exception("model not initialized, call BuildFromOnnxModel first")
+        return model_cpp.ActivationArenaStats(self.pipeline)
+
     def Compile(self, func_name, lib_name):
         if not self.pipeline:
             raise Exception("model not initialized, call BuildFromOnnxModel first")
@@ -117,3 +117,45 @@ class ModelTest(unittest.TestCase):
         outputs = model.run([input_data])
         self.assertEqual(6, outputs[0])
         self.assertAlmostEqual(3.14, outputs[1])
+
+    def test_default_schedule(self):
+        X = helper.make_tensor_value_info('X', TensorProto.FLOAT, [64, 128])
+        Z = helper.make_tensor_value_info('Z', TensorProto.FLOAT, [64, 4])
+
+        w1 = np.random.rand(128, 256).astype(np.float32) - 0.5
+        w2 = np.random.rand(256, 4).astype(np.float32) - 0.5
+        nodes = [
+            helper.make_node('MatMul', ['X', 'W1'], ['M1']),
+            helper.make_node('Relu', ['M1'], ['R1']),
+            helper.make_node('MatMul', ['R1', 'W2'], ['M2']),
+            helper.make_node('Tanh', ['M2'], ['Z']),
+        ]
+        graph_def = helper.make_graph(nodes,
+            "mlp",
+            [X],
+            [Z],
+            initializer=[
+                helper.make_tensor('W1', TensorProto.FLOAT, w1.shape, w1.flatten()),
+                helper.make_tensor('W2', TensorProto.FLOAT, w2.shape, w2.flatten())])
+        onnx_model = helper.make_model(graph_def,
+                                       producer_name='onnx-example')
+        model = Model()
+        model.BuildFromOnnxModel(onnx_model)
+        schedule = model.DefaultSchedule()
+        # Each relu or tanh is fused into the matmul that produces its input.
+        # R1 is too big for the stack, so it gets an activation buffer.
+        self.assertIn('R1 <- M1 buffer 0', schedule)
+        self.assertIn('Z <- M2', schedule)
+        self.assertIn('1 activation buffers', schedule)
+
+        input_data = np.random.rand(64, 128).astype(np.float32)
+        outputs = model.run([input_data])
+        expected = np.tanh(np.maximum(input_data.dot(w1), 0).dot(w2))
+        np.testing.assert_allclose(expected, outputs[0], rtol=1e-4, atol=1e-4)
+
+        # Every heap allocation of every run came from the planned
+        # activation buffer.
+        model.Benchmark(num_iters=2)
+        stats = model.ActivationArenaStats()
+        self.assertGreater(stats['hits'], 0)
+        self.assertEqual(0, stats['fallbacks'])
@@ -1,6 +1,8 @@
 #include "onnx_converter.h"
+#include <algorithm>
 #include <climits>
 #include <exception>
+#include <map>
 #include <math.h>
 #include <unordered_set>
 
@@ -4635,6 +4637,230 @@ std::vector<Halide::Expr> finalize_type_info(
     return result;
 }
 
+// Ops that are applied independently to each element of their (broadcast)
+// inputs. Chains of these are fused into the op producing their input.
+static bool is_elementwise_op(const std::string &op_type) {
+    static const std::unordered_set<std::string> ops = {
+        "Abs", "Acos", "Acosh", "Add", "And", "Asin", "Asinh", "Atan", "Atanh",
+        "BatchNormalization", "Cast", "Ceil", "Clip", "Cos", "Cosh", "Div",
+        "Elu", "Equal", "Erf", "Exp", "Floor", "Greater", "Identity", "IsInf",
+        "IsNaN", "LeakyRelu", "Less", "Log", "Max", "Mean", "Min", "Mul", "Neg",
+        "Not", "Or", "PRelu", "Pow", "Reciprocal", "Relu", "Scale", "Selu",
+        "Shrink", "Sigmoid", "Sign", "Sin", "Sinh", "Softplus", "Softsign",
+        "Sqrt", "Sub", "Sum", "Tan", "Tanh", "ThresholdedRelu", "Where", "Xor"};
+    return ops.find(op_type) != ops.end();
+}
+
+// Ops that do enough work per output element that their result is worth
+// materializing, and that elementwise consumers can be fused into.
+static bool is_anchor_op(const std::string &op_type) {
+    return op_type == "Conv" || op_type == "Gemm" || op_type == "MatMul" ||
+           op_type == "Softmax" || op_type == "LogSoftmax" || op_type == "LRN" ||
+           op_type == "RNN" || op_type == "LSTM" || op_type == "GRU" ||
+           op_type.find("Reduce") == 0 ||
+           (op_type.length() >= 6 &&
+            op_type.find("Pool") == op_type.length() - 4);
+}
+
+// Returns -1 if the size of the tensor isn't known at compile time.
+static int64_t tensor_size_in_bytes(const Tensor &t) {
+    if (t.type == onnx::TensorProto::UNDEFINED) {
+        return -1;
+    }
+    int64_t size = get_halide_type(t).bytes();
+    for (const Halide::Expr &dim : t.shape) {
+        const int64_t *extent =
+            Halide::Internal::as_const_int(Halide::Internal::simplify(dim));
+        if (!extent) {
+            return -1;
+        }
+        size *= *extent;
+    }
+    return size;
+}
+
+// Halide puts constant-sized allocations no larger than this on the stack
+// (see can_allocation_fit_on_stack), and pads heap allocations with one
+// element (see CodeGen_Posix::allocation_padding).
+static constexpr int64_t kMaxStackAllocationBytes = 16 * 1024;
+
+static int64_t tensor_allocation_bytes(const Tensor &t, int64_t bytes) {
+    if (bytes <= kMaxStackAllocationBytes) {
+        return 0;
+    }
+    return bytes + get_halide_type(t).bytes();
+}
+
+// Decide which tensors to fuse and which to materialize, and assign the
+// materialized intermediates to activation buffers that are reused once
+// the tensor occupying them is dead.
+static void plan_model_schedule(const onnx::GraphProto &graph, Model &model) {
+    std::unordered_map<std::string, std::vector<int>> consumers;
+    for (int i = 0; i < graph.node_size(); ++i) {
+        for (const std::string &input_name : graph.node(i).input()) {
+            std::vector<int> &c = consumers[input_name];
+            if (!input_name.empty() && (c.empty() || c.back() != i)) {
+                c.push_back(i);
+            }
+        }
+    }
+    std::unordered_set<std::string> graph_outputs;
+    for (const auto &output : graph.output()) {
+        graph_outputs.insert(output.name());
+    }
+
+    // A fusion group is an optional anchor op followed by a chain of
+    // elementwise ops, each of which is the only consumer of the previous
+    // one. Only the last tensor of the chain is materialized.
+    struct FusionGroup {
+        std::vector<std::string> members;
+        bool has_anchor;
+    };
+    std::vector<FusionGroup> groups;
+    std::unordered_map<std::string, int> group_ending_with;
+
+    for (int i = 0; i < graph.node_size(); ++i) {
+        const onnx::NodeProto &node = graph.node(i);
+        for (const std::string &output_name : node.output()) {
+            if (output_name.empty() ||
+                model.tensors.find(output_name) == model.tensors.end()) {
+                continue;
+            }
+            TensorSchedule &ts = model.schedule[output_name];
+            ts.produced_at = i;
+            ts.bytes = tensor_size_in_bytes(model.tensors.at(output_name));
+            ts.allocation_bytes = tensor_allocation_bytes(model.tensors.at(output_name), ts.bytes);
+            if (graph_outputs.count(output_name)) {
+                ts.placement = TensorSchedule::Root;
+            }
+        }
+        if (node.output_size() != 1 ||
+            model.schedule.find(node.output(0)) == model.schedule.end()) {
+            if (is_anchor_op(node.op_type())) {
+                for (const std::string &output_name : node.output()) {
+                    auto it = model.schedule.find(output_name);
+                    if (it != model.schedule.end()) {
+                        it->second.placement = TensorSchedule::Root;
+                    }
+                }
+            }
+            continue;
+        }
+
+        const std::string &output_name = node.output(0);
+        if (is_anchor_op(node.op_type())) {
+            group_ending_with[output_name] = groups.size();
+            groups.push_back(FusionGroup{{output_name}, true});
+        } else if (is_elementwise_op(node.op_type())) {
+            int group = -1;
+            for (const std::string &input_name : node.input()) {
+                auto it = group_ending_with.find(input_name);
+                if (it == group_ending_with.end() ||
+                    consumers[input_name].size() != 1 ||
+                    graph_outputs.count(input_name) ||
+                    model.tensors.at(input_name).shape.size() !=
+                        model.tensors.at(output_name).shape.size()) {
+                    continue;
+                }
+                group = it->second;
+                group_ending_with.erase(it);
+                break;
+            }
+            if (group < 0) {
+                group = groups.size();
+                groups.push_back(FusionGroup{{}, false});
+            }
+            groups[group].members.push_back(output_name);
+            group_ending_with[output_name] = group;
+        }
+    }
+
+    for (const FusionGroup &group : groups) {
+        const std::string &last = group.members.back();
+        // A chain of cheap ops with a single consumer is simply recomputed
+        // by that consumer.
+        if (!group.has_anchor && consumers[last].size() <= 1 &&
+            !graph_outputs.count(last)) {
+            continue;
+        }
+        model.schedule.at(last).placement = TensorSchedule::Root;
+        for (size_t i = 0; i + 1 < group.members.size(); ++i) {
+            TensorSchedule &ts = model.schedule.at(group.members[i]);
+            ts.placement = (i == 0 && group.has_anchor) ? TensorSchedule::Fused : TensorSchedule::Inline;
+            ts.group = last;
+        }
+    }
+
+    // A materialized tensor is read wherever its consumers are computed:
+    // where their node runs if they are materialized too, or wherever they
+    // are used in turn if they are fused or inlined.
+    for (int i = graph.node_size() - 1; i >= 0; --i) {
+        for (const std::string &output_name : graph.node(i).output()) {
+            auto it = model.schedule.find(output_name);
+            if (it == model.schedule.end()) {
+                continue;
+            }
+            int last_use = i;
+            for (int c : consumers[output_name]) {
+                last_use = std::max(last_use, c);
+                for (const std::string &consumer_output : graph.node(c).output()) {
+                    auto consumer = model.schedule.find(consumer_output);
+                    if (consumer != model.schedule.end() &&
+                        consumer->second.placement != TensorSchedule::Root) {
+                        last_use = std::max(last_use, consumer->second.last_used_at);
+                    }
+                }
+            }
+            it->second.last_used_at = last_use;
+        }
+    }
+
+    // Assign the materialized intermediates to buffers in the order they
+    // are produced. Reuse the smallest dead buffer that is big enough, or
+    // failing that grow the largest dead one.
+    std::vector<std::pair<int, std::string>> planned;
+    for (const auto &it : model.schedule) {
+        const TensorSchedule &ts = it.second;
+        if (ts.placement == TensorSchedule::Root && ts.allocation_bytes > 0 &&
+            !graph_outputs.count(it.first)) {
+            planned.emplace_back(ts.produced_at, it.first);
+        }
+    }
+    std::sort(planned.begin(), planned.end());
+
+    std::vector<int> busy_until;
+    for (const auto &p : planned) {
+        TensorSchedule &ts = model.schedule.at(p.second);
+        int best = -1;
+        for (size_t b = 0; b < busy_until.size(); ++b) {
+            if (busy_until[b] >= ts.produced_at) {
+                continue;
+            }
+            if (best < 0) {
+                best = (int)b;
+                continue;
+            }
+            const int64_t size = model.activation_buffers[b];
+            const int64_t best_size = model.activation_buffers[best];
+            const bool fits = size >= ts.allocation_bytes;
+            const bool best_fits = best_size >= ts.allocation_bytes;
+            if ((fits && (!best_fits || size < best_size)) ||
+                (!fits && !best_fits && size > best_size)) {
+                best = (int)b;
+            }
+        }
+        if (best < 0) {
+            best = (int)busy_until.size();
+            busy_until.push_back(-1);
+            model.activation_buffers.push_back(0);
+        }
+        model.activation_buffers[best] =
+            std::max(model.activation_buffers[best], ts.allocation_bytes);
+        busy_until[best] = ts.last_used_at;
+        ts.buffer = best;
+    }
+}
+
 Model convert_model(
     const onnx::ModelProto &model,
     const std::unordered_map<std::string, int> &expected_dim_sizes,
@@ -4734,6 +4960,9 @@ Model convert_model(
         result.outputs[output.name()] = t_out;
     }
 
+    result.layout = layout;
+    plan_model_schedule(model.graph(), result);
+
     return result;
 }
 
@@ -4767,6 +4996,151 @@ Halide::Type get_halide_type(const Tensor &tensor) {
     throw std::domain_error("Unsupported or unknown target type");
 }
 
+// The dimensions of a materialized tensor, innermost first.
+static std::vector<Halide::Var> storage_order(
+    const std::vector<Halide::Var> &args,
+    IOLayout io_layout,
+    TensorSchedule::Layout layout) {
+    if (args.size() == 4 && layout == TensorSchedule::NHWC) {
+        return {args[1], args[3], args[2], args[0]};
+    }
+    std::vector<Halide::Var> order = args;
+    if (io_layout == NumPy) {
+        std::reverse(order.begin(), order.end());
+    }
+    return order;
+}
+
+// Vectorize the innermost dimension of the pure definition of f, and
+// optionally parallelize an outer one. Returns the loop at which fused
+// producers should be computed.
+static Halide::Var schedule_loops(
+    Halide::Func f,
+    const std::vector<Halide::Var> &order,
+    const Halide::Target &target,
+    bool parallel) {
+    if (order.empty()) {
+        return Halide::Var::outermost();
+    }
+    if (order.size() > 1) {
+        f.reorder(std::vector<Halide::VarOrRVar>(order.begin(), order.end()));
+    }
+    Halide::Type t = f.output_types()[0];
+    const int lanes = target.natural_vector_size(t.is_bool() ? Halide::UInt(8) : t);
+    if (lanes > 1) {
+        f.vectorize(order[0], lanes, Halide::TailStrategy::GuardWithIf);
+    }
+    if (order.size() == 1) {
+        return Halide::Var::outermost();
+    }
+    // Leave the batch dimension of images outermost.
+    Halide::Var outer = order[order.size() >= 3 ? order.size() - 2 : order.size() - 1];
+    if (parallel) {
+        f.parallel(outer);
+    }
+    return outer;
+}
+
+void schedule_model(Model &model, const Halide::Target &target) {
+    // Funcs for the inputs and constants of the model are left alone.
+    std::unordered_set<std::string> leaves;
+    for (const auto &it : model.tensors) {
+        if (model.schedule.find(it.first) == model.schedule.end() &&
+            it.second.rep.defined()) {
+            leaves.insert(it.second.rep.name());
+        }
+    }
+
+    // A Func can represent several tensors (e.g. Dropout passes its input
+    // through), so use the strongest placement of any of them.
+    struct FuncSchedule {
+        Halide::Func func;
+        std::string tensor;
+        bool is_output;
+    };
+    std::map<std::string, FuncSchedule> funcs;
+    auto add_func = [&](Halide::Func f, const std::string &tensor, bool is_output) {
+        if (!f.defined() || leaves.count(f.name())) {
+            return;
+        }
+        auto it = funcs.find(f.name());
+        if (it == funcs.end()) {
+            funcs[f.name()] = FuncSchedule{f, tensor, is_output};
+            return;
+        }
+        if (model.schedule.at(it->second.tensor).placement <
+            model.schedule.at(tensor).placement) {
+            it->second.tensor = tensor;
+        }
+        it->second.is_output = it->second.is_output || is_output;
+    };
+    for (const auto &it : model.schedule) {
+        const Halide::Func &f = model.tensors.at(it.first).rep;
+        auto output = model.outputs.find(it.first);
+        const bool is_output = output != model.outputs.end();
+        add_func(f, it.first, is_output && output->second.rep.name() == f.name());
+        if (is_output && output->second.rep.name() != f.name()) {
+            // A copy of an output that is also used by other nodes.
+            add_func(output->second.rep, it.first, true);
+        }
+    }
+
+    // Materialize the fusion group outputs, and remember where the rest of
+    // each group should be computed.
+    std::map<std::string, std::pair<Halide::Func, Halide::Var>> group_loops;
+    for (auto &it : funcs) {
+        Halide::Func f = it.second.func;
+        TensorSchedule &ts = model.schedule.at(it.second.tensor);
+        if (ts.placement != TensorSchedule::Root) {
+            continue;
+        }
+        if (!it.second.is_output && model.layout == NumPy && f.dimensions() == 4) {
+            // Vectorize across the width of the image when it's wide enough,
+            // and across the channels otherwise (e.g. for the small spatial
+            // extents deep in a network).
+            Halide::Type t = f.output_types()[0];
+            const int lanes = target.natural_vector_size(t.is_bool() ? Halide::UInt(8) : t);
+            const std::vector<Halide::Expr> &shape = model.tensors.at(it.second.tensor).shape;
+            ts.layout = TensorSchedule::NCHW;
+            if (shape.size() == 4) {
+                const int64_t *channels = Halide::Internal::as_const_int(Halide::Internal::simplify(shape[1]));
+                const int64_t *width = Halide::Internal::as_const_int(Halide::Internal::simplify(shape[3]));
+                if (channels && width && *width < lanes && *channels >= lanes) {
+                    ts.layout = TensorSchedule::NHWC;
+                }
+            }
+        }
+        std::vector<Halide::Var> order = storage_order(
+            f.args(), model.layout, it.second.is_output ? TensorSchedule::Default : ts.layout);
+        if (!it.second.is_output) {
+            f.compute_root();
+            if (order.size() > 1) {
+                f.reorder_storage(order);
+            }
+        }
+        Halide::Var outer = schedule_loops(f, order, target, true);
+        if (!group_loops.count(it.second.tensor) || !it.second.is_output) {
+            group_loops[it.second.tensor] = {f, outer};
+        }
+    }
+
+    for (auto &it : funcs) {
+        Halide::Func f = it.second.func;
+        const TensorSchedule &ts = model.schedule.at(it.second.tensor);
+        if (ts.placement != TensorSchedule::Fused || it.second.is_output) {
+            continue;
+        }
+        auto group = group_loops.find(ts.group);
+        if (group == group_loops.end()) {
+            f.compute_root();
+            continue;
+        }
+        const TensorSchedule &group_ts = model.schedule.at(ts.group);
+        f.compute_at(group->second.first, group->second.second);
+        schedule_loops(f, storage_order(f.args(), model.layout, group_ts.layout), target, false);
+    }
+}
+
 static int64_t infer_dim_from_inputs(
     Halide::Expr dim,
     const Halide::Region &replacements,
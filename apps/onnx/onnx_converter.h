@@ -24,6 +24,51 @@ Node convert_node(
     const onnx::NodeProto &node,
     const std::vector<Tensor> &inputs);
 
+// Layout of the inputs and outputs to the model.
+enum IOLayout {
+    Native = 0,
+    NumPy = 1,
+};
+
+// How schedule_model() computes a tensor produced by a node of the model.
+struct TensorSchedule {
+    enum Placement {
+        // Recomputed wherever it is used (e.g. data movement ops, and
+        // elementwise ops fused into their consumer).
+        Inline = 0,
+        // Computed per tile of the fusion group output named by 'group'
+        // (e.g. a convolution followed by a bias and a relu).
+        Fused = 1,
+        // Materialized in a buffer of its own.
+        Root = 2,
+    };
+    // Storage order of the materialized rank 4 activations. Default is
+    // the order used by the inputs and outputs of the model.
+    enum Layout {
+        Default = 0,
+        NCHW = 1,
+        NHWC = 2,
+    };
+
+    Placement placement = Inline;
+    Layout layout = Default;
+    std::string group;
+
+    // Index of the node computing the tensor, and of the last node whose
+    // computation reads it, in topological order.
+    int produced_at = -1;
+    int last_used_at = -1;
+
+    // The activation buffer assigned by the memory plan, or -1 if the
+    // tensor isn't an intermediate of known size that goes on the heap.
+    int buffer = -1;
+    int64_t bytes = 0;
+    // The size Halide asks halide_malloc for when it materializes the
+    // tensor, which is padded by one element, or 0 if the tensor is
+    // small enough that Halide puts it on the stack instead.
+    int64_t allocation_bytes = 0;
+};
+
 struct Model {
     std::unordered_map<std::string, Halide::ImageParam> inputs;
     std::unordered_map<std::string, Tensor> outputs;
@@ -31,17 +76,24 @@ struct Model {
     std::unordered_map<std::string, Tensor> tensors;
 
     std::vector<Halide::Expr> requirements;
-};
 
-// Layout of the inputs and outputs to the model.
-enum IOLayout {
-    Native = 0,
-    NumPy = 1,
+    IOLayout layout = Native;
+
+    // Fusion and memory plan for the tensors computed by the nodes of the
+    // model, and the sizes of the activation buffers they share.
+    std::unordered_map<std::string, TensorSchedule> schedule;
+    std::vector<int64_t> activation_buffers;
 };
+
 Model convert_model(const onnx::ModelProto &model, const std::unordered_map<std::string, int> &expected_dim_sizes, IOLayout layout);
 
 Halide::Type get_halide_type(const Tensor &tensor);
 
+// Schedule the model without searching: fuse elementwise ops into the op
+// producing their input, pick the storage layout of each materialized
+// activation, and vectorize and parallelize it for the target.
+void schedule_model(Model &model, const Halide::Target &target);
+
 void compute_output_shapes(
     const Model &model,
     const std::map<std::string, std::vector<int>> &input_shapes,
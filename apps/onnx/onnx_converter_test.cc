@@ -498,6 +498,101 @@ static void test_model() {
     EXPECT_EQ(7, output_shape(1));
 }
 
+// Four convolutions, each followed by a relu.
+static onnx::ModelProto make_conv_relu_model() {
+    onnx::ModelProto model;
+    onnx::ValueInfoProto *input_def = model.mutable_graph()->add_input();
+    input_def->set_name("x");
+    input_def->mutable_type()->mutable_tensor_type()->set_elem_type(
+        onnx::TensorProto_DataType_FLOAT);
+    for (int dim : {1, 4, 16, 16}) {
+        input_def->mutable_type()
+            ->mutable_tensor_type()
+            ->mutable_shape()
+            ->add_dim()
+            ->set_dim_value(dim);
+    }
+    model.mutable_graph()->add_output()->set_name("r4");
+
+    std::mt19937 rnd;
+    std::uniform_real_distribution<float> dis(-1.0, 1.0);
+    std::string input = "x";
+    for (int i = 1; i <= 4; ++i) {
+        const std::string id = std::to_string(i);
+        onnx::TensorProto *weights = model.mutable_graph()->add_initializer();
+        weights->set_name("w" + id);
+        weights->set_data_type(onnx::TensorProto_DataType_FLOAT);
+        for (int dim : {4, 4, 3, 3}) {
+            weights->add_dims(dim);
+        }
+        for (int j = 0; j < 4 * 4 * 3 * 3; ++j) {
+            weights->add_float_data(dis(rnd));
+        }
+
+        onnx::NodeProto *conv = model.mutable_graph()->add_node();
+        conv->set_name("conv" + id);
+        conv->set_op_type("Conv");
+        conv->add_input(input);
+        conv->add_input("w" + id);
+        conv->add_output("c" + id);
+
+        onnx::NodeProto *relu = model.mutable_graph()->add_node();
+        relu->set_name("relu" + id);
+        relu->set_op_type("Relu");
+        relu->add_input("c" + id);
+        relu->add_output("r" + id);
+        input = "r" + id;
+    }
+    return model;
+}
+
+static void test_fusion_and_memory_plan() {
+    onnx::ModelProto model = make_conv_relu_model();
+    std::unordered_map<std::string, int> dummy;
+    Model reference = convert_model(model, dummy, IOLayout::NumPy);
+    Model converted = convert_model(model, dummy, IOLayout::NumPy);
+
+    // Each relu is fused with the convolution producing its input.
+    for (int i = 1; i <= 4; ++i) {
+        const std::string id = std::to_string(i);
+        EXPECT_EQ(TensorSchedule::Fused, converted.schedule.at("c" + id).placement);
+        EXPECT_EQ("r" + id, converted.schedule.at("c" + id).group);
+        EXPECT_EQ(TensorSchedule::Root, converted.schedule.at("r" + id).placement);
+    }
+    // r1 and r2 are both needed to compute r2, but r3 can reuse r1's buffer.
+    // The model output isn't an intermediate, so it gets no buffer.
+    EXPECT_EQ(2, converted.activation_buffers.size());
+    EXPECT_EQ(0, converted.schedule.at("r1").buffer);
+    EXPECT_EQ(1, converted.schedule.at("r2").buffer);
+    EXPECT_EQ(0, converted.schedule.at("r3").buffer);
+    EXPECT_EQ(-1, converted.schedule.at("r4").buffer);
+    EXPECT_EQ(4 * 14 * 14 * 4, converted.activation_buffers[0]);
+
+    schedule_model(converted, Halide::get_jit_target_from_environment());
+
+    // The schedule must not change the results. The model inputs and
+    // outputs are in numpy order, i.e. with the last dimension innermost.
+    const std::vector<int> numpy_order = {3, 2, 1, 0};
+    Halide::Buffer<float> input_values(16, 16, 4, 1);
+    std::uniform_real_distribution<float> dis(-1.0, 1.0);
+    std::mt19937 rnd;
+    input_values.for_each_value([&](float &f) { f = dis(rnd); });
+    input_values.transpose(numpy_order);
+    reference.inputs.at("x").set(input_values);
+    converted.inputs.at("x").set(input_values);
+
+    Halide::Buffer<float> expected(8, 8, 4, 1);
+    expected.transpose(numpy_order);
+    reference.outputs.at("r4").rep.realize(expected);
+    Halide::Buffer<float> actual(8, 8, 4, 1);
+    actual.transpose(numpy_order);
+    converted.outputs.at("r4").rep.realize(actual);
+
+    actual.for_each_element([&](const int *pos) {
+        EXPECT_NEAR(actual(pos), expected(pos), 1e-4f);
+    });
+}
+
 int main() {
     test_abs();
     test_activation_function();
@@ -511,6 +606,7 @@ int main() {
     test_concat();
     test_constant_fill();
     test_model();
+    test_fusion_and_memory_plan();
     printf("Success!\n");
     return 0;
 }
@@ -1,4 +1,5 @@
 import halide as hl
+import math
 
 def test_autodiff():
     x = hl.Var('x')
@@ -62,5 +63,27 @@ def test_autodiff():
     d_p_buf = d_p.realize()
     assert(abs(d_p_buf[()] - 45.0) < 1e-6)
 
+def test_autodiff_checkpointing():
+    x = hl.Var('x')
+    b = hl.Buffer(hl.Float(32), [4])
+    for i in range(4):
+        b[i] = float(i)
+    f, g = hl.Func('f'), hl.Func('g')
+    f[x] = hl.sin(b[x])
+    r = hl.RDom([(0, 4)])
+    g[()] = 0.0
+    g[()] += f[r.x] * f[r.x]
+
+    # With no memory for f, the adjoints recompute it.
+    checkpoint = hl.CheckpointOptions()
+    checkpoint.memory_budget = 0
+    d = hl.propagate_adjoints(g, checkpoint)
+
+    # d g / d b = 2 * sin(b) * cos(b)
+    d_b_buf = d[b].realize(4)
+    for i in range(4):
+        assert(abs(d_b_buf[i] - math.sin(2.0 * i)) < 1e-5)
+
 if __name__ == "__main__":
     test_autodiff()
+    test_autodiff_checkpointing()
@@ -258,6 +258,99 @@ def test_buffer_to_str():
     b = hl.Buffer(hl.Int(32), [128, 256])
     assert str(b) == '<halide.Buffer of type int32 shape:[[0,128,1],[0,256,128]]>'
 
+def test_dlpack():
+    b = hl.Buffer(hl.Int(16), [10, 20])
+    b.fill(0)
+    b.crop(0, 2, 6)
+
+    # A round trip through DLPack should share storage and preserve strides.
+    b2 = hl.Buffer.from_dlpack(b)
+    assert b2.type() == hl.Int(16)
+    assert b2.dimensions() == 2
+    assert b2.dim(0).extent() == 6 and b2.dim(0).stride() == 1
+    assert b2.dim(1).extent() == 20 and b2.dim(1).stride() == 10
+    b2[3, 4] = 42
+    assert b[5, 4] == 42
+    del b
+    gc.collect()
+    assert b2[3, 4] == 42
+
+    # A capsule may only be consumed once.
+    capsule = b2.__dlpack__()
+    hl.Buffer.from_dlpack(capsule)
+    try:
+        hl.Buffer.from_dlpack(capsule)
+    except ValueError as e:
+        assert 'DLPack' in str(e)
+    else:
+        assert False, 'Did not see expected exception!'
+
+    assert b2.__dlpack_device__() == (1, 0)
+
+    if hasattr(np, 'from_dlpack'):
+        a = np.arange(24, dtype=np.float32).reshape(4, 6)[:, ::2]
+        b3 = hl.Buffer.from_dlpack(a)
+        assert b3.dim(0).extent() == 4 and b3.dim(0).stride() == 6
+        assert b3.dim(1).extent() == 3 and b3.dim(1).stride() == 2
+        assert b3[2, 1] == a[2, 1]
+        a2 = np.from_dlpack(b3)
+        assert np.shares_memory(a, a2)
+        assert a2[3, 2] == a[3, 2]
+
+        # Copies of the Buffer keep the array's storage alive by themselves.
+        expected = float(a[2, 1])
+        b4 = hl.Buffer(b3)
+        del a, a2, b3
+        gc.collect()
+        assert b4[2, 1] == expected
+
+def test_array_interface():
+    class Wrapper:
+        pass
+
+    b = hl.Buffer(hl.UInt(8), [8, 5])
+    b.fill(7)
+    w = Wrapper()
+    w.__array_interface__ = b.__array_interface__
+    assert w.__array_interface__['typestr'] == '|u1'
+    assert w.__array_interface__['strides'] == (1, 8)
+
+    # numpy should wrap the Buffer's storage rather than copying it.
+    a = np.asarray(w)
+    assert a.shape == (8, 5)
+    a[3, 2] = 9
+    assert b[3, 2] == 9
+
+    b2 = hl.Buffer(hl.Float(32), [4, 3])
+    w.__array_interface__ = b2.__array_interface__
+    assert np.asarray(w).dtype == np.float32
+
+def test_make_aligned():
+    b = hl.Buffer.make_aligned(hl.Float(32), [17, 5, 3], alignment=64)
+    assert b.dim(0).extent() == 17 and b.dim(0).stride() == 1
+    assert b.dim(1).stride() == 32
+    assert b.dim(2).stride() == 32 * 5
+    for y in range(5):
+        for c in range(3):
+            assert (b.__array_interface__['data'][0] + 4 * (y * 32 + c * 32 * 5)) % 64 == 0
+    try:
+        hl.Buffer.make_aligned(hl.Float(32), [17, 5], alignment=48)
+    except ValueError as e:
+        assert 'power of two' in str(e)
+    else:
+        assert False, 'Did not see expected exception!'
+
+def test_misaligned_strides():
+    a = np.zeros(16, dtype=np.uint8)
+    # A view of int16s at odd byte strides can't be expressed as a Buffer<>.
+    bad = np.lib.stride_tricks.as_strided(a.view(np.int16), shape=(5,), strides=(3,))
+    try:
+        hl.Buffer(bad)
+    except ValueError as e:
+        assert 'multiple of the element size' in str(e)
+    else:
+        assert False, 'Did not see expected exception!'
+
 if __name__ == "__main__":
     test_make_interleaved()
     test_interleaved_ndarray()
@@ -271,3 +364,7 @@ if __name__ == "__main__":
     test_reorder()
     test_overflow()
     test_buffer_to_str()
+    test_dlpack()
+    test_array_interface()
+    test_make_aligned()
+    test_misaligned_strides()
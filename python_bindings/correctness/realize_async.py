@@ -0,0 +1,61 @@
+import halide as hl
+import threading
+
+def make_pipeline(k):
+    x, y = hl.Var('x'), hl.Var('y')
+    f = hl.Func('f')
+    f[x, y] = x + y * 10 + k
+    f.parallel(y)
+    return f
+
+def check(b, k):
+    for y in range(b.height()):
+        for x in range(b.width()):
+            assert b[x, y] == x + y * 10 + k
+
+def test_realize_async():
+    # Several realizations in flight at once, each of a different Func.
+    funcs = [make_pipeline(k) for k in range(4)]
+    futures = [f.realize_async(16, 8) for f in funcs]
+    for k, fut in enumerate(futures):
+        check(fut.result(), k)
+
+    # Pipelines, and realizing into an existing buffer.
+    p = hl.Pipeline(make_pipeline(5))
+    buf = hl.Buffer(hl.Int(32), [16, 8])
+    assert p.realize_async(buf).result() is None
+    check(buf, 5)
+
+def test_realize_async_error():
+    x = hl.Var('x')
+    f = hl.Func('f')
+    f[x] = hl.u16(x)
+    # Deliberate type-mismatch error
+    buf = hl.Buffer(hl.UInt(8), [2])
+    try:
+        f.realize_async(buf).result()
+    except RuntimeError as e:
+        assert 'Output buffer f has type uint16 but type of the buffer passed in is uint8' in str(e)
+    else:
+        assert False, 'Did not see expected exception!'
+
+def test_realize_releases_gil():
+    # Realize from several Python threads at once. This would deadlock or
+    # crash if the GIL were mishandled.
+    results = [None] * 4
+    def work(k):
+        f = make_pipeline(k)
+        f.compile_jit()
+        results[k] = f.realize(16, 8)
+    threads = [threading.Thread(target=work, args=(k,)) for k in range(4)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    for k in range(4):
+        check(results[k], k)
+
+if __name__ == "__main__":
+    test_realize_async()
+    test_realize_async_error()
+    test_realize_releases_gil()
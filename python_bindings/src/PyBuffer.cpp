@@ -1,5 +1,6 @@
 #include "PyBuffer.h"
 
+#include <memory>
 #include <utility>
 
 #include "PyFunc.h"
@@ -230,6 +231,233 @@ py::object buffer_setitem_operator(Buffer<> &buf, const std::vector<int> &pos, c
     return py::object();
 }
 
+// The subset of the DLPack ABI (https://github.com/dmlc/dlpack) that we
+// need, declared here to match dlpack.h rather than adding a dependency.
+enum {
+    kDLCPU = 1,
+    kDLCUDAHost = 3,
+};
+
+enum {
+    kDLInt = 0,
+    kDLUInt = 1,
+    kDLFloat = 2,
+    kDLBfloat = 4,
+    kDLBool = 6,
+};
+
+struct DLDevice {
+    int32_t device_type;
+    int32_t device_id;
+};
+
+struct DLDataType {
+    uint8_t code;
+    uint8_t bits;
+    uint16_t lanes;
+};
+
+struct DLTensor {
+    void *data;
+    DLDevice device;
+    int32_t ndim;
+    DLDataType dtype;
+    int64_t *shape;
+    int64_t *strides;
+    uint64_t byte_offset;
+};
+
+struct DLManagedTensor {
+    DLTensor dl_tensor;
+    void *manager_ctx;
+    void (*deleter)(DLManagedTensor *self);
+};
+
+Type dlpack_to_type(const DLDataType &t) {
+    if (t.lanes != 1) {
+        throw py::value_error("Vector DLPack types are not supported.");
+    }
+    switch (t.code) {
+    case kDLInt:
+        return Int(t.bits);
+    case kDLUInt:
+        return UInt(t.bits);
+    case kDLFloat:
+        return Float(t.bits);
+    case kDLBfloat:
+        return BFloat(t.bits);
+    case kDLBool:
+        if (t.bits == 8) {
+            return Bool();
+        }
+        break;
+    }
+    throw py::value_error("Unsupported DLPack type.");
+    return Type();
+}
+
+DLDataType type_to_dlpack(const Type &t) {
+    if (t.is_bool()) {
+        return {kDLBool, 8, 1};
+    }
+    if (t.is_int()) {
+        return {kDLInt, (uint8_t)t.bits(), 1};
+    }
+    if (t.is_uint()) {
+        return {kDLUInt, (uint8_t)t.bits(), 1};
+    }
+    if (t.is_bfloat()) {
+        return {kDLBfloat, (uint8_t)t.bits(), 1};
+    }
+    if (t.is_float()) {
+        return {kDLFloat, (uint8_t)t.bits(), 1};
+    }
+    throw py::value_error("Unsupported Buffer<> type.");
+    return DLDataType();
+}
+
+// What a DLManagedTensor exported from a Buffer<> points to. Holding a
+// reference to the Buffer<> keeps its storage alive until the consumer
+// is done with it.
+struct DLPackExport {
+    Buffer<> buffer;
+    std::vector<int64_t> shape, strides;
+    DLManagedTensor tensor;
+
+    static void deleter(DLManagedTensor *self) {
+        delete (DLPackExport *)self->manager_ctx;
+    }
+};
+
+// Called when a capsule returned by __dlpack__ is collected. If nobody
+// consumed the tensor (by renaming the capsule), we must free it.
+void dlpack_capsule_destructor(PyObject *capsule) {
+    if (PyCapsule_IsValid(capsule, "dltensor")) {
+        DLManagedTensor *t = (DLManagedTensor *)PyCapsule_GetPointer(capsule, "dltensor");
+        if (t->deleter) {
+            t->deleter(t);
+        }
+    }
+}
+
+py::capsule buffer_to_dlpack(const Buffer<> &b) {
+    if (b.data() == nullptr) {
+        throw py::value_error("Cannot export a Buffer<> with null host ptr to DLPack.");
+    }
+    if (b.device_dirty()) {
+        throw py::value_error("Cannot export a Buffer<> with a dirty device allocation to DLPack; call copy_to_host() first.");
+    }
+
+    DLPackExport *ex = new DLPackExport;
+    ex->buffer = b;
+    for (int i = 0; i < b.dimensions(); i++) {
+        ex->shape.push_back(b.raw_buffer()->dim[i].extent);
+        ex->strides.push_back(b.raw_buffer()->dim[i].stride);
+    }
+    DLTensor &t = ex->tensor.dl_tensor;
+    t.data = b.data();
+    t.device = {kDLCPU, 0};
+    t.ndim = b.dimensions();
+    t.dtype = type_to_dlpack(b.type());
+    t.shape = ex->shape.data();
+    t.strides = ex->strides.data();
+    t.byte_offset = 0;
+    ex->tensor.manager_ctx = ex;
+    ex->tensor.deleter = &DLPackExport::deleter;
+
+    PyObject *capsule = PyCapsule_New(&ex->tensor, "dltensor", &dlpack_capsule_destructor);
+    if (!capsule) {
+        delete ex;
+        throw py::error_already_set();
+    }
+    return py::reinterpret_steal<py::capsule>(capsule);
+}
+
+// The numpy __array_interface__ type string for a Halide type.
+std::string type_to_typestr(const Type &t) {
+    char kind;
+    if (t.is_bool()) {
+        kind = 'b';
+    } else if (t.is_int()) {
+        kind = 'i';
+    } else if (t.is_uint()) {
+        kind = 'u';
+    } else if (t.is_float() && !t.is_bfloat()) {
+        kind = 'f';
+    } else {
+        throw py::value_error("Buffer<> type has no numpy equivalent.");
+    }
+    const int bytes = t.bytes();
+    const uint16_t one = 1;
+    const bool little_endian = *(const uint8_t *)&one == 1;
+    const char order = bytes == 1 ? '|' : (little_endian ? '<' : '>');
+    return std::string(1, order) + kind + std::to_string(bytes);
+}
+
+py::dict buffer_array_interface(const Buffer<> &b) {
+    if (b.data() == nullptr) {
+        throw py::value_error("Cannot convert a Buffer<> with null host ptr to a Python buffer.");
+    }
+    const int bytes = b.type().bytes();
+    py::list shape, strides;
+    for (int i = 0; i < b.dimensions(); i++) {
+        shape.append(b.raw_buffer()->dim[i].extent);
+        strides.append((int64_t)b.raw_buffer()->dim[i].stride * bytes);
+    }
+    py::dict d;
+    d["version"] = 3;
+    d["shape"] = py::tuple(shape);
+    d["strides"] = py::tuple(strides);
+    d["typestr"] = type_to_typestr(b.type());
+    d["data"] = py::make_tuple((uintptr_t)b.data(), false);
+    return d;
+}
+
+// Make a dense Buffer<> in which every row (and every plane, etc.) starts
+// at a multiple of alignment bytes, by padding the strides.
+Buffer<> make_aligned_buffer(Type type, const std::vector<int> &sizes, int alignment, const std::string &name) {
+    // Buffer<>::allocate aligns the base to 128 bytes, so we can't promise more.
+    if (alignment < type.bytes() || alignment > 128 || (alignment & (alignment - 1)) != 0) {
+        throw py::value_error("alignment must be a power of two between the element size and 128.");
+    }
+    const int lanes = alignment / type.bytes();
+    std::vector<halide_dimension_t> dims;
+    int64_t stride = 1;
+    for (size_t i = 0; i < sizes.size(); i++) {
+        if (stride > INT_MAX) {
+            throw py::value_error("Buffer is too large.");
+        }
+        dims.emplace_back(0, sizes[i], (int32_t)stride);
+        stride *= sizes[i];
+        if (i == 0) {
+            stride = (stride + lanes - 1) / lanes * lanes;
+        }
+    }
+    Buffer<> b(type, nullptr, (int)dims.size(), dims.data(), name);
+    b.allocate(nullptr, nullptr);
+    return b;
+}
+
+std::vector<halide_dimension_t> dlpack_dim_vec(const DLTensor &t) {
+    std::vector<halide_dimension_t> dims;
+    dims.reserve(t.ndim);
+    // Null strides mean a compact row-major layout, i.e. the last
+    // dimension is innermost.
+    std::vector<int64_t> strides(t.ndim);
+    int64_t stride = 1;
+    for (int i = t.ndim - 1; i >= 0; i--) {
+        strides[i] = t.strides ? t.strides[i] : stride;
+        stride *= t.shape[i];
+    }
+    for (int i = 0; i < t.ndim; i++) {
+        if (INT_MAX < t.shape[i] || INT_MAX < strides[i] || INT_MIN > strides[i]) {
+            throw py::value_error("Out of range arguments to dlpack_dim_vec.");
+        }
+        dims.emplace_back(0, (int32_t)t.shape[i], (int32_t)strides[i]);
+    }
+    return dims;
+}
+
 // Use an alias class so that if we are created via a py::buffer, we can
 // keep the py::buffer_info class alive for the life of the Buffer<>,
 // ensuring the data isn't collected out from under us.
@@ -244,6 +472,9 @@ class PyBuffer : public Buffer<> {
             if (INT_MAX < info.shape[i] || INT_MAX < (info.strides[i] / t.bytes())) {
                 throw py::value_error("Out of range arguments to make_dim_vec.");
             }
+            if (info.strides[i] % t.bytes() != 0) {
+                throw py::value_error("Buffer strides must be a multiple of the element size.");
+            }
             dims.emplace_back(0, (int32_t)info.shape[i], (int32_t)(info.strides[i] / t.bytes()));
         }
         return dims;
@@ -286,10 +517,74 @@ public:
         this->set_host_dirty();
     }
 
+    // Point at the data of a DLPack tensor, without taking ownership of
+    // it (see buffer_from_dlpack).
+    PyBuffer(DLManagedTensor *t, const std::string &name)
+        : Buffer<>(
+              dlpack_to_type(t->dl_tensor.dtype),
+              (uint8_t *)t->dl_tensor.data + t->dl_tensor.byte_offset,
+              (int)t->dl_tensor.ndim,
+              dlpack_dim_vec(t->dl_tensor).data(),
+              name),
+          info() {
+        // As for py::buffer, assume the data is meant to be read.
+        this->set_host_dirty();
+    }
+
     ~PyBuffer() override {
     }
 };
 
+// The AllocationHeader of a Buffer<> that points at the data of a DLPack
+// tensor. The tensor's deleter is called when the last Buffer<> sharing
+// the data goes away, including copies made on the C++ side.
+struct DLPackAllocation {
+    Halide::Runtime::AllocationHeader header;
+    DLManagedTensor *tensor;
+
+    static void deallocate(void *ptr) {
+        DLPackAllocation *a = (DLPackAllocation *)ptr;
+        if (a->tensor->deleter) {
+            // The deleter may release Python objects.
+            py::gil_scoped_acquire acquire;
+            a->tensor->deleter(a->tensor);
+        }
+        free(a);
+    }
+};
+
+// Make a Buffer<> that shares storage with any object supporting the DLPack
+// protocol (i.e. with a __dlpack__ method), or with a DLPack capsule.
+py::object buffer_from_dlpack(const py::object &obj, const std::string &name) {
+    py::object capsule = obj;
+    if (py::hasattr(obj, "__dlpack__")) {
+        capsule = obj.attr("__dlpack__")();
+    }
+    if (!PyCapsule_IsValid(capsule.ptr(), "dltensor")) {
+        throw py::value_error("Expected an object supporting DLPack, or an unconsumed DLPack capsule.");
+    }
+    DLManagedTensor *t = (DLManagedTensor *)PyCapsule_GetPointer(capsule.ptr(), "dltensor");
+    const int32_t device = t->dl_tensor.device.device_type;
+    if (device != kDLCPU && device != kDLCUDAHost) {
+        throw py::value_error("Only DLPack tensors in host memory are supported.");
+    }
+    // Make the Buffer<> before consuming the capsule, so that the
+    // producer still frees the tensor if we throw.
+    std::unique_ptr<PyBuffer> b(new PyBuffer(t, name));
+    DLPackAllocation *a = (DLPackAllocation *)malloc(sizeof(DLPackAllocation));
+    if (!a) {
+        throw std::bad_alloc();
+    }
+    new (&a->header) Halide::Runtime::AllocationHeader(DLPackAllocation::deallocate);
+    a->tensor = t;
+    // The Buffer<> and its copies own the tensor from here on.
+    b->adopt_host_allocation(b->data(), &a->header);
+    PyCapsule_SetName(capsule.ptr(), "used_dltensor");
+    py::object result = py::cast((Buffer<> *)b.get(), py::return_value_policy::take_ownership);
+    b.release();
+    return result;
+}
+
 }  // namespace
 
 void define_buffer(py::module &m) {
@@ -360,6 +655,24 @@ void define_buffer(py::module &m) {
                     return Buffer<>::make_with_shape_of(buffer, nullptr, nullptr, name);
                 },
                 py::arg("src"), py::arg("name") = "")
+            .def_static(
+                "make_aligned", [](Type type, const std::vector<int> &sizes, int alignment, const std::string &name) -> Buffer<> {
+                    return make_aligned_buffer(type, sizes, alignment, name);
+                },
+                py::arg("type"), py::arg("sizes"), py::arg("alignment") = 64, py::arg("name") = "")
+
+            // Zero-copy interop with anything that speaks DLPack (PyTorch, JAX, NumPy >= 1.22, ...).
+            // As with the buffer protocol, dimension i of the tensor is dimension i of the Buffer<>.
+            .def_static("from_dlpack", &buffer_from_dlpack, py::arg("tensor"), py::arg("name") = "")
+            .def(
+                "__dlpack__", [](const Buffer<> &b, const py::object &) -> py::capsule {
+                    return buffer_to_dlpack(b);
+                },
+                py::arg("stream") = py::none())
+            .def("__dlpack_device__", [](const Buffer<> &) -> py::tuple {
+                return py::make_tuple((int)kDLCPU, 0);
+            })
+            .def_property_readonly("__array_interface__", &buffer_array_interface)
 
             .def("set_name", &Buffer<>::set_name)
             .def("name", &Buffer<>::name)
@@ -25,12 +25,19 @@ void define_derivative(py::module &m) {
                 return d(std::get<0>(args), std::get<1>(args));
             });
 
+    py::class_<CheckpointOptions>(m, "CheckpointOptions")
+        .def(py::init<>())
+        .def_readwrite("memory_budget", &CheckpointOptions::memory_budget);
+
     m.def("propagate_adjoints",
-          (Derivative(*)(const Func &, const Func &, const Region &)) & propagate_adjoints);
+          (Derivative(*)(const Func &, const Func &, const Region &, const CheckpointOptions &)) & propagate_adjoints,
+          py::arg("output"), py::arg("adjoint"), py::arg("output_bounds"), py::arg("checkpoint") = CheckpointOptions());
     m.def("propagate_adjoints",
-          (Derivative(*)(const Func &, const Buffer<float> &)) & propagate_adjoints);
+          (Derivative(*)(const Func &, const Buffer<float> &, const CheckpointOptions &)) & propagate_adjoints,
+          py::arg("output"), py::arg("adjoint"), py::arg("checkpoint") = CheckpointOptions());
     m.def("propagate_adjoints",
-          (Derivative(*)(const Func &)) & propagate_adjoints);
+          (Derivative(*)(const Func &, const CheckpointOptions &)) & propagate_adjoints,
+          py::arg("output"), py::arg("checkpoint") = CheckpointOptions());
 }
 
 }  // namespace PythonBindings
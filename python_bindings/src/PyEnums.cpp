@@ -144,6 +144,12 @@ void define_enums(py::module &m) {
         .value("SVE", Target::Feature::SVE)
         .value("SVE2", Target::Feature::SVE2)
         .value("ARMDotProd", Target::Feature::ARMDotProd)
+        .value("LoopCarry", Target::Feature::LoopCarry)
+        .value("SpecializeOnEstimates", Target::Feature::SpecializeOnEstimates)
+        .value("ParallelBatch", Target::Feature::ParallelBatch)
+        .value("LazyJIT", Target::Feature::LazyJIT)
+        .value("TieredJIT", Target::Feature::TieredJIT)
+        .value("PoolParallelAllocations", Target::Feature::PoolParallelAllocations)
         .value("FeatureEnd", Target::Feature::FeatureEnd);
 
     py::enum_<halide_type_code_t>(m, "TypeCode")
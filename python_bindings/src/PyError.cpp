@@ -10,12 +10,16 @@ void halide_python_error(void *, const char *msg) {
 }
 
 void halide_python_print(void *, const char *msg) {
+    // Pipelines run with the GIL released, possibly on Halide's own threads.
+    py::gil_scoped_acquire acquire;
     py::print(msg, py::arg("end") = "");
 }
 
 class HalidePythonCompileTimeErrorReporter : public CompileTimeErrorReporter {
 public:
     void warning(const char *msg) override {
+        // Compilation may run with the GIL released.
+        py::gil_scoped_acquire acquire;
         py::print(msg, py::arg("end") = "");
     }
 
@@ -6,6 +6,7 @@
 #include "PyExpr.h"
 #include "PyFuncRef.h"
 #include "PyLoopLevel.h"
+#include "PyPipeline.h"
 #include "PyScheduleMethods.h"
 #include "PyStage.h"
 #include "PyTuple.h"
@@ -117,6 +118,7 @@ void define_func(py::module &m) {
             .def(
                 "realize",
                 [](Func &f, Buffer<> buffer, const Target &target) -> void {
+                    py::gil_scoped_release release;
                     f.realize(buffer, target);
                 },
                 py::arg("dst"), py::arg("target") = Target())
@@ -125,6 +127,7 @@ void define_func(py::module &m) {
             .def(
                 "realize",
                 [](Func &f, std::vector<Buffer<>> buffers, const Target &t) -> void {
+                    py::gil_scoped_release release;
                     f.realize(Realization(buffers), t);
                 },
                 py::arg("dst"), py::arg("target") = Target())
@@ -132,7 +135,7 @@ void define_func(py::module &m) {
             .def(
                 "realize",
                 [](Func &f, const std::vector<int32_t> &sizes, const Target &target) -> py::object {
-                    return realization_to_object(f.realize(sizes, target));
+                    return realization_to_object(call_without_gil([&]() { return f.realize(sizes, target); }));
                 },
                 py::arg("sizes") = std::vector<int32_t>{}, py::arg("target") = Target())
 
@@ -140,7 +143,7 @@ void define_func(py::module &m) {
             .def(
                 "realize",
                 [](Func &f, int x_size, const Target &target) -> py::object {
-                    return realization_to_object(f.realize(x_size, target));
+                    return realization_to_object(call_without_gil([&]() { return f.realize(x_size, target); }));
                 },
                 py::arg("x_size"), py::arg("target") = Target())
 
@@ -148,7 +151,7 @@ void define_func(py::module &m) {
             .def(
                 "realize",
                 [](Func &f, int x_size, int y_size, const Target &target) -> py::object {
-                    return realization_to_object(f.realize(x_size, y_size, target));
+                    return realization_to_object(call_without_gil([&]() { return f.realize(x_size, y_size, target); }));
                 },
                 py::arg("x_size"), py::arg("y_size"), py::arg("target") = Target())
 
@@ -156,7 +159,7 @@ void define_func(py::module &m) {
             .def(
                 "realize",
                 [](Func &f, int x_size, int y_size, int z_size, const Target &target) -> py::object {
-                    return realization_to_object(f.realize(x_size, y_size, z_size, target));
+                    return realization_to_object(call_without_gil([&]() { return f.realize(x_size, y_size, z_size, target); }));
                 },
                 py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("target") = Target())
 
@@ -164,10 +167,16 @@ void define_func(py::module &m) {
             .def(
                 "realize",
                 [](Func &f, int x_size, int y_size, int z_size, int w_size, const Target &target) -> py::object {
-                    return realization_to_object(f.realize(x_size, y_size, z_size, w_size, target));
+                    return realization_to_object(call_without_gil([&]() { return f.realize(x_size, y_size, z_size, w_size, target); }));
                 },
                 py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("w_size"), py::arg("target") = Target())
 
+            // Takes the same arguments as realize(), and returns a concurrent.futures.Future
+            // for its result. Don't realize the same Func from more than one thread at once.
+            .def("realize_async", [](py::object f, py::args args, py::kwargs kwargs) -> py::object {
+                return realize_async(f, args, kwargs);
+            })
+
             .def("defined", &Func::defined)
             .def("name", &Func::name)
             .def("dimensions", &Func::dimensions)
@@ -231,7 +240,8 @@ void define_func(py::module &m) {
             // TODO: useless until Module is defined.
             .def("compile_to_module", &Func::compile_to_module, py::arg("arguments"), py::arg("fn_name") = "", py::arg("target") = get_target_from_environment())
 
-            .def("compile_jit", &Func::compile_jit, py::arg("target") = get_jit_target_from_environment())
+            .def("compile_jit", &Func::compile_jit, py::arg("target") = get_jit_target_from_environment(),
+                 py::call_guard<py::gil_scoped_release>())
 
             .def("has_update_definition", &Func::has_update_definition)
             .def("num_update_definitions", &Func::num_update_definitions)
@@ -272,18 +282,21 @@ void define_func(py::module &m) {
 
             .def(
                 "infer_input_bounds", [](Func &f, int x_size, int y_size, int z_size, int w_size, const Target &target) -> void {
+                    py::gil_scoped_release release;
                     f.infer_input_bounds(x_size, y_size, z_size, w_size, target);
                 },
                 py::arg("x_size") = 0, py::arg("y_size") = 0, py::arg("z_size") = 0, py::arg("w_size") = 0, py::arg("target") = get_jit_target_from_environment())
 
             .def(
                 "infer_input_bounds", [](Func &f, Buffer<> buffer, const Target &target) -> void {
+                    py::gil_scoped_release release;
                     f.infer_input_bounds(buffer, target);
                 },
                 py::arg("dst"), py::arg("target") = get_jit_target_from_environment())
 
             .def(
                 "infer_input_bounds", [](Func &f, std::vector<Buffer<>> buffer, const Target &target) -> void {
+                    py::gil_scoped_release release;
                     f.infer_input_bounds(Realization(buffer));
                 },
                 py::arg("dst"), py::arg("target") = get_jit_target_from_environment())
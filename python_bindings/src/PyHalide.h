@@ -34,6 +34,15 @@ std::vector<T> args_to_vector(const py::args &args, size_t start_offset = 0, siz
 
 Expr double_to_expr_check(double v);
 
+/** Call fn with the GIL released, so that other Python threads can
+ * run while Halide compiles or runs a pipeline. fn must not touch any
+ * Python objects. */
+template<typename Fn>
+auto call_without_gil(Fn &&fn) -> decltype(fn()) {
+    py::gil_scoped_release release;
+    return fn();
+}
+
 }  // namespace PythonBindings
 }  // namespace Halide
 
@@ -1,5 +1,7 @@
 #include "PyPipeline.h"
 
+#include <utility>
+
 #include "PyTuple.h"
 
 namespace Halide {
@@ -19,6 +21,22 @@ py::object realization_to_object(const Realization &r) {
 
 }  // namespace
 
+py::object realize_async(const py::object &obj, const py::args &args, const py::kwargs &kwargs) {
+    // All async realizations share one pool of Python threads. realize()
+    // releases the GIL while Halide runs, so they overlap with each other
+    // and with the caller. The pool is deliberately never destroyed, as
+    // that would happen after the interpreter has shut down.
+    static py::object *executor = nullptr;
+    if (!executor) {
+        py::object e = py::module::import("concurrent.futures").attr("ThreadPoolExecutor")();
+        // Importing may have let another thread in to create one first.
+        if (!executor) {
+            executor = new py::object(std::move(e));
+        }
+    }
+    return executor->attr("submit")(obj.attr("realize"), *args, **kwargs);
+}
+
 void define_pipeline(py::module &m) {
 
     // Deliberately not supported, because they don't seem to make sense for Python:
@@ -88,10 +106,12 @@ void define_pipeline(py::module &m) {
             .def("compile_to_module", &Pipeline::compile_to_module,
                  py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment(), py::arg("linkage") = LinkageType::ExternalPlusMetadata)
 
-            .def("compile_jit", &Pipeline::compile_jit, py::arg("target") = get_jit_target_from_environment())
+            .def("compile_jit", &Pipeline::compile_jit, py::arg("target") = get_jit_target_from_environment(),
+                 py::call_guard<py::gil_scoped_release>())
 
             .def(
                 "realize", [](Pipeline &p, Buffer<> buffer, const Target &target) -> void {
+                    py::gil_scoped_release release;
                     p.realize(Realization(buffer), target);
                 },
                 py::arg("dst"), py::arg("target") = Target())
@@ -99,57 +119,67 @@ void define_pipeline(py::module &m) {
             // This will actually allow a list-of-buffers as well as a tuple-of-buffers, but that's OK.
             .def(
                 "realize", [](Pipeline &p, std::vector<Buffer<>> buffers, const Target &t) -> void {
+                    py::gil_scoped_release release;
                     p.realize(Realization(buffers), t);
                 },
                 py::arg("dst"), py::arg("target") = Target())
 
             .def(
                 "realize", [](Pipeline &p, std::vector<int32_t> sizes, const Target &target) -> py::object {
-                    return realization_to_object(p.realize(sizes, target));
+                    return realization_to_object(call_without_gil([&]() { return p.realize(sizes, target); }));
                 },
                 py::arg("sizes") = std::vector<int32_t>{}, py::arg("target") = Target())
 
             // TODO: deprecate in favor of std::vector<int32_t> size version?
             .def(
                 "realize", [](Pipeline &p, int x_size, const Target &target) -> py::object {
-                    return realization_to_object(p.realize(x_size, target));
+                    return realization_to_object(call_without_gil([&]() { return p.realize(x_size, target); }));
                 },
                 py::arg("x_size"), py::arg("target") = Target())
 
             // TODO: deprecate in favor of std::vector<int32_t> size version?
             .def(
                 "realize", [](Pipeline &p, int x_size, int y_size, const Target &target) -> py::object {
-                    return realization_to_object(p.realize(x_size, y_size, target));
+                    return realization_to_object(call_without_gil([&]() { return p.realize(x_size, y_size, target); }));
                 },
                 py::arg("x_size"), py::arg("y_size"), py::arg("target") = Target())
 
             // TODO: deprecate in favor of std::vector<int32_t> size version?
             .def(
                 "realize", [](Pipeline &p, int x_size, int y_size, int z_size, const Target &target) -> py::object {
-                    return realization_to_object(p.realize(x_size, y_size, z_size, target));
+                    return realization_to_object(call_without_gil([&]() { return p.realize(x_size, y_size, z_size, target); }));
                 },
                 py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("target") = Target())
 
             // TODO: deprecate in favor of std::vector<int32_t> size version?
             .def(
                 "realize", [](Pipeline &p, int x_size, int y_size, int z_size, int w_size, const Target &target) -> py::object {
-                    return realization_to_object(p.realize(x_size, y_size, z_size, w_size, target));
+                    return realization_to_object(call_without_gil([&]() { return p.realize(x_size, y_size, z_size, w_size, target); }));
                 },
                 py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("w_size"), py::arg("target") = Target())
 
+            // Takes the same arguments as realize(), and returns a concurrent.futures.Future
+            // for its result. Don't realize the same Pipeline from more than one thread at once.
+            .def("realize_async", [](py::object p, py::args args, py::kwargs kwargs) -> py::object {
+                return realize_async(p, args, kwargs);
+            })
+
             .def(
                 "infer_input_bounds", [](Pipeline &p, int x_size, int y_size, int z_size, int w_size, const Target &target) -> void {
+                    py::gil_scoped_release release;
                     p.infer_input_bounds(x_size, y_size, z_size, w_size, target);
                 },
                 py::arg("x_size") = 0, py::arg("y_size") = 0, py::arg("z_size") = 0, py::arg("w_size") = 0, py::arg("target") = get_jit_target_from_environment())
 
             .def(
                 "infer_input_bounds", [](Pipeline &p, Buffer<> buffer, const Target &target) -> void {
+                    py::gil_scoped_release release;
                     p.infer_input_bounds(Realization(buffer), target);
                 },
                 py::arg("dst"), py::arg("target") = get_jit_target_from_environment())
             .def(
                 "infer_input_bounds", [](Pipeline &p, std::vector<Buffer<>> buffers, const Target &target) -> void {
+                    py::gil_scoped_release release;
                     p.infer_input_bounds(Realization(buffers));
                 },
                 py::arg("dst"), py::arg("target") = get_jit_target_from_environment())
@@ -8,6 +8,10 @@ namespace PythonBindings {
 
 void define_pipeline(py::module &m);
 
+/** Call obj.realize(*args, **kwargs) on a background thread and return
+ * a concurrent.futures.Future for the result. */
+py::object realize_async(const py::object &obj, const py::args &args, const py::kwargs &kwargs);
+
 }  // namespace PythonBindings
 }  // namespace Halide
 
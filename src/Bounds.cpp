@@ -1774,12 +1774,85 @@ private:
     }
 };
 
+// Memoizes bounds_of_expr_in_scope for a single FuncValueBounds. The
+// bounds of an Expr depend only on the Expr and on the intervals in
+// scope of the variables it uses, so results are keyed on those, and
+// stay valid as the scope changes. Repeated subexpressions, such as
+// the arguments of inlined calls, are then only bounded once.
+class BoundsCache {
+    struct Entry {
+        bool const_bound;
+        vector<bool> in_scope;
+        vector<Interval> var_bounds;
+        Interval result;
+    };
+
+    struct Entries {
+        vector<string> vars;
+        vector<Entry> entries;
+    };
+
+    map<Expr, Entries, IRDeepCompare> cache;
+    const FuncValueBounds &func_bounds;
+
+    static bool same_scope(const Entry &a, const Entry &b) {
+        if (a.const_bound != b.const_bound || a.in_scope != b.in_scope) {
+            return false;
+        }
+        for (size_t i = 0; i < a.var_bounds.size(); i++) {
+            if (!equal(a.var_bounds[i].min, b.var_bounds[i].min) ||
+                !equal(a.var_bounds[i].max, b.var_bounds[i].max)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+public:
+    BoundsCache(const FuncValueBounds &fb)
+        : func_bounds(fb) {
+    }
+
+    Interval bounds_of(const Expr &e, const Scope<Interval> &scope, bool const_bound = false) {
+        if (e.as<Variable>() || is_const(e)) {
+            // Cheaper to compute than to look up.
+            return bounds_of_expr_in_scope(e, scope, func_bounds, const_bound);
+        }
+
+        auto it = cache.find(e);
+        if (it == cache.end()) {
+            CollectVars collect("");
+            e.accept(&collect);
+            it = cache.emplace(e, Entries()).first;
+            it->second.vars.assign(collect.vars.begin(), collect.vars.end());
+        }
+        Entries &entries = it->second;
+
+        Entry key;
+        key.const_bound = const_bound;
+        for (const string &v : entries.vars) {
+            bool in_scope = scope.contains(v);
+            key.in_scope.push_back(in_scope);
+            key.var_bounds.push_back(in_scope ? scope.get(v) : Interval());
+        }
+        for (const Entry &entry : entries.entries) {
+            if (same_scope(entry, key)) {
+                return entry.result;
+            }
+        }
+
+        key.result = bounds_of_expr_in_scope(e, scope, func_bounds, const_bound);
+        entries.entries.push_back(key);
+        return key.result;
+    }
+};
+
 // Compute the box produced by a statement
 class BoxesTouched : public IRGraphVisitor {
 
 public:
     BoxesTouched(bool calls, bool provides, string fn, const Scope<Interval> *s, const FuncValueBounds &fb)
-        : func(std::move(fn)), consider_calls(calls), consider_provides(provides), func_bounds(fb) {
+        : func(std::move(fn)), consider_calls(calls), consider_provides(provides), func_bounds(fb), bounds_cache(fb) {
         scope.set_containing_scope(s);
     }
 
@@ -1809,6 +1882,7 @@ private:
     bool consider_calls, consider_provides;
     Scope<Interval> scope;
     const FuncValueBounds &func_bounds;
+    BoundsCache bounds_cache;
     // Scope containing the current value definition of let stmts.
     Scope<Expr> let_stmts;
     // Keep track of variable renaming. Map variable name to instantiation number
@@ -1840,8 +1914,8 @@ private:
                     b.resize(mins_struct->args.size());
                     b.used = const_true();
                     for (size_t i = 0; i < mins_struct->args.size(); i++) {
-                        Interval min_interval = bounds_of_expr_in_scope(mins_struct->args[i], scope, func_bounds);
-                        Interval max_interval = bounds_of_expr_in_scope(mins_struct->args[i] + extents_struct->args[i] - 1, scope, func_bounds);
+                        Interval min_interval = bounds_cache.bounds_of(mins_struct->args[i], scope);
+                        Interval max_interval = bounds_cache.bounds_of(mins_struct->args[i] + extents_struct->args[i] - 1, scope);
                         b[i] = Interval(min_interval.min, max_interval.max);
                     }
                     return true;
@@ -1853,8 +1927,8 @@ private:
                 if (dim != nullptr && box_from_extended_crop(call_expr->args[0], b)) {
                     internal_assert(dim->value >= 0 && dim->value < (int64_t)b.size())
                         << "box_from_extended_crop setting bounds for out of range dim.\n";
-                    Interval min_interval = bounds_of_expr_in_scope(call_expr->args[2], scope, func_bounds);
-                    Interval max_interval = bounds_of_expr_in_scope(call_expr->args[2] + call_expr->args[3] - 1, scope, func_bounds);
+                    Interval min_interval = bounds_cache.bounds_of(call_expr->args[2], scope);
+                    Interval max_interval = bounds_cache.bounds_of(call_expr->args[2] + call_expr->args[3] - 1, scope);
                     b[dim->value] = Interval(min_interval.min, max_interval.max);
                     return true;
                 }
@@ -1899,7 +1973,7 @@ private:
                     Box b(op->args.size());
                     b.used = const_true();
                     for (size_t i = 0; i < op->args.size(); i++) {
-                        b[i] = bounds_of_expr_in_scope(op->args[i], scope, func_bounds);
+                        b[i] = bounds_cache.bounds_of(op->args[i], scope);
                     }
                     merge_boxes(boxes[op->name], b);
                 }
@@ -2049,7 +2123,7 @@ private:
 
             op->value.accept(this);
 
-            f.value_bounds = bounds_of_expr_in_scope(op->value, scope, func_bounds);
+            f.value_bounds = bounds_cache.bounds_of(op->value, scope);
 
             bool fixed = f.value_bounds.min.same_as(f.value_bounds.max);
             f.value_bounds.min = simplify(f.value_bounds.min);
@@ -2241,7 +2315,7 @@ private:
                                                       expr_uses_var(box[i].max, l.min_name)))) {
                         internal_assert(let_stmts.contains(l.var));
                         const Expr &val = let_stmts.get(l.var);
-                        v_bound = bounds_of_expr_in_scope(val, scope, func_bounds);
+                        v_bound = bounds_cache.bounds_of(val, scope);
                         bool fixed = v_bound.min.same_as(v_bound.max);
                         v_bound.min = simplify(v_bound.min);
                         v_bound.max = fixed ? v_bound.min : simplify(v_bound.max);
@@ -2389,7 +2463,7 @@ private:
                         likely_i.max = likely_if_innermost(i.max);
                     }
 
-                    Interval bi = bounds_of_expr_in_scope(rhs, scope, func_bounds);
+                    Interval bi = bounds_cache.bounds_of(rhs, scope);
                     if (bi.has_upper_bound() && i.has_upper_bound()) {
                         if (lt) {
                             i.max = min(likely_i.max, bi.max - 1);
@@ -2477,14 +2551,14 @@ private:
         if (scope.contains(op->name + ".loop_min")) {
             min_val = scope.get(op->name + ".loop_min").min;
         } else {
-            min_val = bounds_of_expr_in_scope(op->min, scope, func_bounds).min;
+            min_val = bounds_cache.bounds_of(op->min, scope).min;
         }
 
         if (scope.contains(op->name + ".loop_max")) {
             max_val = scope.get(op->name + ".loop_max").max;
         } else {
-            max_val = bounds_of_expr_in_scope(op->extent, scope, func_bounds).max;
-            max_val += bounds_of_expr_in_scope(op->min, scope, func_bounds).max;
+            max_val = bounds_cache.bounds_of(op->extent, scope).max;
+            max_val += bounds_cache.bounds_of(op->min, scope).max;
             max_val -= 1;
         }
 
@@ -2501,7 +2575,7 @@ private:
             if (op->name == func || func.empty()) {
                 Box b(op->args.size());
                 for (size_t i = 0; i < op->args.size(); i++) {
-                    b[i] = bounds_of_expr_in_scope(op->args[i], scope, func_bounds);
+                    b[i] = bounds_cache.bounds_of(op->args[i], scope);
                 }
                 merge_boxes(boxes[op->name], b);
             }
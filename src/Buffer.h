@@ -485,6 +485,18 @@ public:
         return *this;
     }
 
+    template<typename Fn, typename... Args>
+    Buffer<T> &for_each_value(Runtime::BufferExecutionPolicy policy, Fn &&f, Args... other_buffers) {
+        get()->for_each_value(policy, std::forward<Fn>(f), (*std::forward<Args>(other_buffers).get())...);
+        return *this;
+    }
+
+    template<typename Fn, typename... Args>
+    const Buffer<T> &for_each_value(Runtime::BufferExecutionPolicy policy, Fn &&f, Args... other_buffers) const {
+        get()->for_each_value(policy, std::forward<Fn>(f), (*std::forward<Args>(other_buffers).get())...);
+        return *this;
+    }
+
     template<typename Fn>
     Buffer<T> &for_each_element(Fn &&f) {
         get()->for_each_element(std::forward<Fn>(f));
@@ -532,8 +544,9 @@ public:
     }
 
     template<typename T2>
-    void copy_from(const Buffer<T2> &other) {
-        contents->buf.copy_from(*other.get());
+    void copy_from(const Buffer<T2> &other,
+                   Runtime::BufferExecutionPolicy policy = Runtime::BufferExecutionPolicy::Sequential) {
+        contents->buf.copy_from(*other.get(), policy);
     }
 
     template<typename... Args>
@@ -905,6 +905,261 @@ private:
 
         const char *native_vector_decl = R"INLINE_CODE(
 #if __has_attribute(ext_vector_type) || __has_attribute(vector_size)
+
+// Operations that the vector extensions don't provide directly. By
+// default these are done lane by lane; the common types are
+// specialized below to use SIMD intrinsics when the compiler targets
+// an instruction set that has them. Define
+// HALIDE_CPP_NO_SIMD_INTRINSICS to always use the lane by lane code.
+template <typename ElementType, size_t Lanes>
+struct NativeVectorOps {
+    template <typename NativeVectorType>
+    static NativeVectorType max(const NativeVectorType &a, const NativeVectorType &b) {
+        NativeVectorType r;
+        for (size_t i = 0; i < Lanes; i++) {
+            r[i] = ::halide_cpp_max<ElementType>(a[i], b[i]);
+        }
+        return r;
+    }
+
+    template <typename NativeVectorType>
+    static NativeVectorType min(const NativeVectorType &a, const NativeVectorType &b) {
+        NativeVectorType r;
+        for (size_t i = 0; i < Lanes; i++) {
+            r[i] = ::halide_cpp_min<ElementType>(a[i], b[i]);
+        }
+        return r;
+    }
+};
+
+// Vector types of the same size can be converted to and from each
+// other with a cast, which reinterprets the bits.
+#define HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(ElementType, Lanes, IntrinsicType, min_intrinsic, max_intrinsic) \
+template <>                                                                                                \
+struct NativeVectorOps<ElementType, Lanes> {                                                               \
+    template <typename NativeVectorType>                                                                   \
+    static NativeVectorType max(const NativeVectorType &a, const NativeVectorType &b) {                    \
+        return (NativeVectorType)max_intrinsic((IntrinsicType)a, (IntrinsicType)b);                        \
+    }                                                                                                      \
+    template <typename NativeVectorType>                                                                   \
+    static NativeVectorType min(const NativeVectorType &a, const NativeVectorType &b) {                    \
+        return (NativeVectorType)min_intrinsic((IntrinsicType)a, (IntrinsicType)b);                        \
+    }                                                                                                      \
+};
+
+#if !HALIDE_CPP_NO_SIMD_INTRINSICS
+#if defined(__SSE2__)
+#include <immintrin.h>
+// Note that the float and double versions match halide_cpp_min and
+// halide_cpp_max exactly, including for NaNs: they return the second
+// argument unless the comparison is true.
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(uint8_t, 16, __m128i, _mm_min_epu8, _mm_max_epu8)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(int16_t, 8, __m128i, _mm_min_epi16, _mm_max_epi16)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(float, 4, __m128, _mm_min_ps, _mm_max_ps)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(double, 2, __m128d, _mm_min_pd, _mm_max_pd)
+#endif
+#if defined(__SSE4_1__)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(int8_t, 16, __m128i, _mm_min_epi8, _mm_max_epi8)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(uint16_t, 8, __m128i, _mm_min_epu16, _mm_max_epu16)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(int32_t, 4, __m128i, _mm_min_epi32, _mm_max_epi32)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(uint32_t, 4, __m128i, _mm_min_epu32, _mm_max_epu32)
+#endif
+#if defined(__AVX__)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(float, 8, __m256, _mm256_min_ps, _mm256_max_ps)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(double, 4, __m256d, _mm256_min_pd, _mm256_max_pd)
+#endif
+#if defined(__AVX2__)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(uint8_t, 32, __m256i, _mm256_min_epu8, _mm256_max_epu8)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(int8_t, 32, __m256i, _mm256_min_epi8, _mm256_max_epi8)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(uint16_t, 16, __m256i, _mm256_min_epu16, _mm256_max_epu16)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(int16_t, 16, __m256i, _mm256_min_epi16, _mm256_max_epi16)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(uint32_t, 8, __m256i, _mm256_min_epu32, _mm256_max_epu32)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(int32_t, 8, __m256i, _mm256_min_epi32, _mm256_max_epi32)
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+// The NEON float min and max return NaN if either argument is NaN,
+// unlike halide_cpp_min and halide_cpp_max, so only integer types
+// are done this way.
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(uint8_t, 8, uint8x8_t, vmin_u8, vmax_u8)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(int8_t, 8, int8x8_t, vmin_s8, vmax_s8)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(uint16_t, 4, uint16x4_t, vmin_u16, vmax_u16)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(int16_t, 4, int16x4_t, vmin_s16, vmax_s16)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(uint32_t, 2, uint32x2_t, vmin_u32, vmax_u32)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(int32_t, 2, int32x2_t, vmin_s32, vmax_s32)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(uint8_t, 16, uint8x16_t, vminq_u8, vmaxq_u8)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(int8_t, 16, int8x16_t, vminq_s8, vmaxq_s8)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(uint16_t, 8, uint16x8_t, vminq_u16, vmaxq_u16)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(int16_t, 8, int16x8_t, vminq_s16, vmaxq_s16)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(uint32_t, 4, uint32x4_t, vminq_u32, vmaxq_u32)
+HALIDE_CPP_NATIVE_VECTOR_MIN_MAX(int32_t, 4, int32x4_t, vminq_s32, vmaxq_s32)
+#endif
+#endif  // !HALIDE_CPP_NO_SIMD_INTRINSICS
+
+#undef HALIDE_CPP_NATIVE_VECTOR_MIN_MAX
+
+// Arithmetic and comparisons map directly onto the vector extensions.
+// Comparisons give a vector of signed integers as wide as the
+// elements, with all bits set in the lanes where they're true, but our
+// masks are vectors of uint8_t, so comparisons and select need to
+// narrow and widen masks. By default this is done lane by lane; it's a
+// cast for 8-bit elements, and the common wider cases are specialized
+// below.
+template <size_t ElementBytes, size_t Lanes>
+struct NativeVectorMaskOps {
+    template <typename MaskVectorType, typename CompareVectorType>
+    static MaskVectorType narrow_mask(const CompareVectorType &c) {
+        MaskVectorType r;
+        for (size_t i = 0; i < Lanes; i++) {
+            r[i] = c[i] ? 0xff : 0x00;
+        }
+        return r;
+    }
+
+    template <typename CompareVectorType, typename MaskVectorType>
+    static CompareVectorType widen_mask(const MaskVectorType &m) {
+        CompareVectorType r;
+        for (size_t i = 0; i < Lanes; i++) {
+            r[i] = m[i] ? -1 : 0;
+        }
+        return r;
+    }
+};
+
+template <size_t Lanes>
+struct NativeVectorMaskOps<1, Lanes> {
+    template <typename MaskVectorType, typename CompareVectorType>
+    static MaskVectorType narrow_mask(const CompareVectorType &c) {
+        return (MaskVectorType)c;
+    }
+
+    // Masks made by && and || have 1 rather than 0xff in their true
+    // lanes, so compare with zero rather than just casting.
+    template <typename CompareVectorType, typename MaskVectorType>
+    static CompareVectorType widen_mask(const MaskVectorType &m) {
+        return (CompareVectorType)(m != (MaskVectorType){});
+    }
+};
+
+#if !HALIDE_CPP_NO_SIMD_INTRINSICS
+#if defined(__SSE2__)
+inline __m128i halide_cpp_nonzero_lanes_epi8(__m128i m) {
+    return _mm_andnot_si128(_mm_cmpeq_epi8(m, _mm_setzero_si128()), _mm_set1_epi8(-1));
+}
+
+template <>
+struct NativeVectorMaskOps<2, 8> {
+    template <typename MaskVectorType, typename CompareVectorType>
+    static MaskVectorType narrow_mask(const CompareVectorType &c) {
+        MaskVectorType r;
+        _mm_storel_epi64((__m128i *)&r, _mm_packs_epi16((__m128i)c, (__m128i)c));
+        return r;
+    }
+
+    template <typename CompareVectorType, typename MaskVectorType>
+    static CompareVectorType widen_mask(const MaskVectorType &m) {
+        __m128i m8 = halide_cpp_nonzero_lanes_epi8(_mm_loadl_epi64((const __m128i *)&m));
+        return (CompareVectorType)_mm_unpacklo_epi8(m8, m8);
+    }
+};
+
+template <>
+struct NativeVectorMaskOps<4, 4> {
+    template <typename MaskVectorType, typename CompareVectorType>
+    static MaskVectorType narrow_mask(const CompareVectorType &c) {
+        __m128i c16 = _mm_packs_epi32((__m128i)c, (__m128i)c);
+        int32_t bits = _mm_cvtsi128_si32(_mm_packs_epi16(c16, c16));
+        MaskVectorType r;
+        memcpy(&r, &bits, sizeof(bits));
+        return r;
+    }
+
+    template <typename CompareVectorType, typename MaskVectorType>
+    static CompareVectorType widen_mask(const MaskVectorType &m) {
+        int32_t bits;
+        memcpy(&bits, &m, sizeof(bits));
+        __m128i m8 = halide_cpp_nonzero_lanes_epi8(_mm_cvtsi32_si128(bits));
+        __m128i m16 = _mm_unpacklo_epi8(m8, m8);
+        return (CompareVectorType)_mm_unpacklo_epi16(m16, m16);
+    }
+};
+#endif
+#if defined(__AVX2__)
+template <>
+struct NativeVectorMaskOps<2, 16> {
+    template <typename MaskVectorType, typename CompareVectorType>
+    static MaskVectorType narrow_mask(const CompareVectorType &c) {
+        __m256i c256 = (__m256i)c;
+        MaskVectorType r;
+        _mm_storeu_si128((__m128i *)&r, _mm_packs_epi16(_mm256_castsi256_si128(c256),
+                                                        _mm256_extracti128_si256(c256, 1)));
+        return r;
+    }
+
+    template <typename CompareVectorType, typename MaskVectorType>
+    static CompareVectorType widen_mask(const MaskVectorType &m) {
+        __m128i m8 = halide_cpp_nonzero_lanes_epi8(_mm_loadu_si128((const __m128i *)&m));
+        return (CompareVectorType)_mm256_cvtepi8_epi16(m8);
+    }
+};
+
+template <>
+struct NativeVectorMaskOps<4, 8> {
+    template <typename MaskVectorType, typename CompareVectorType>
+    static MaskVectorType narrow_mask(const CompareVectorType &c) {
+        __m256i c256 = (__m256i)c;
+        __m128i c16 = _mm_packs_epi32(_mm256_castsi256_si128(c256), _mm256_extracti128_si256(c256, 1));
+        MaskVectorType r;
+        _mm_storel_epi64((__m128i *)&r, _mm_packs_epi16(c16, c16));
+        return r;
+    }
+
+    template <typename CompareVectorType, typename MaskVectorType>
+    static CompareVectorType widen_mask(const MaskVectorType &m) {
+        __m128i m8 = halide_cpp_nonzero_lanes_epi8(_mm_loadl_epi64((const __m128i *)&m));
+        return (CompareVectorType)_mm256_cvtepi8_epi32(m8);
+    }
+};
+#endif
+#if defined(__ARM_NEON)
+template <>
+struct NativeVectorMaskOps<2, 8> {
+    template <typename MaskVectorType, typename CompareVectorType>
+    static MaskVectorType narrow_mask(const CompareVectorType &c) {
+        return (MaskVectorType)vmovn_u16((uint16x8_t)c);
+    }
+
+    template <typename CompareVectorType, typename MaskVectorType>
+    static CompareVectorType widen_mask(const MaskVectorType &m) {
+        uint8x8_t m8 = vtst_u8((uint8x8_t)m, (uint8x8_t)m);
+        return (CompareVectorType)vmovl_s8(vreinterpret_s8_u8(m8));
+    }
+};
+
+template <>
+struct NativeVectorMaskOps<4, 4> {
+    template <typename MaskVectorType, typename CompareVectorType>
+    static MaskVectorType narrow_mask(const CompareVectorType &c) {
+        uint16x4_t c16 = vmovn_u32((uint32x4_t)c);
+        uint32_t bits = vget_lane_u32(vreinterpret_u32_u8(vmovn_u16(vcombine_u16(c16, c16))), 0);
+        MaskVectorType r;
+        memcpy(&r, &bits, sizeof(bits));
+        return r;
+    }
+
+    template <typename CompareVectorType, typename MaskVectorType>
+    static CompareVectorType widen_mask(const MaskVectorType &m) {
+        uint32_t bits;
+        memcpy(&bits, &m, sizeof(bits));
+        uint8x8_t m8 = vreinterpret_u8_u32(vdup_n_u32(bits));
+        m8 = vtst_u8(m8, m8);
+        int16x8_t m16 = vmovl_s8(vreinterpret_s8_u8(m8));
+        return (CompareVectorType)vmovl_s16(vget_low_s16(m16));
+    }
+};
+#endif
+#endif  // !HALIDE_CPP_NO_SIMD_INTRINSICS
+
 template <typename ElementType_, size_t Lanes_>
 class NativeVector {
 public:
@@ -919,6 +1174,12 @@ public:
     typedef ElementType_ NativeVectorType __attribute__((vector_size(Lanes * sizeof(ElementType)), aligned(sizeof(ElementType))));
 #endif
 
+    // The type of the result of comparing two NativeVectorTypes.
+    typedef decltype(NativeVectorType() < NativeVectorType()) CompareVectorType;
+
+    // For loads and stores of whole vectors; it may alias the elements.
+    typedef NativeVectorType UnalignedVectorType __attribute__((may_alias));
+
     NativeVector &operator=(const Vec &src) {
         if (this != &src) {
             native_vector = src.native_vector;
@@ -948,9 +1209,15 @@ public:
         return r;
     }
 
-    // TODO: could this be improved by taking advantage of native operator support?
     static Vec load(const void *base, int32_t offset) {
         Vec r(empty);
+        if (sizeof(NativeVectorType) == sizeof(ElementType) * Lanes) {
+            // Load directly into the vector. Copying through memory with
+            // memcpy can stall on store forwarding, which costs more than
+            // the arithmetic done with the vector.
+            r.native_vector = *(const UnalignedVectorType *)((const ElementType*)base + offset);
+            return r;
+        }
         // Note: do not use sizeof(NativeVectorType) here; if it's an unusual type
         // (e.g. uint8x48, which could be produced by concat()), the actual implementation
         // might be larger (e.g. it might really be a uint8x64). Only copy the amount
@@ -969,8 +1236,11 @@ public:
         return r;
     }
 
-    // TODO: could this be improved by taking advantage of native operator support?
     void store(void *base, int32_t offset) const {
+        if (sizeof(NativeVectorType) == sizeof(ElementType) * Lanes) {
+            *(UnalignedVectorType *)((ElementType*)base + offset) = native_vector;
+            return;
+        }
         // Note: do not use sizeof(NativeVectorType) here; if it's an unusual type
         // (e.g. uint8x48, which could be produced by concat()), the actual implementation
         // might be larger (e.g. it might really be a uint8x64). Only copy the amount
@@ -1150,67 +1420,36 @@ public:
         return r;
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
     friend Mask operator<(const Vec &a, const Vec &b) {
-        Mask r;
-        for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = a[i] < b[i] ? 0xff : 0x00;
-        }
-        return r;
+        return to_mask(a.native_vector < b.native_vector);
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
     friend Mask operator<=(const Vec &a, const Vec &b) {
-        Mask r;
-        for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = a[i] <= b[i] ? 0xff : 0x00;
-        }
-        return r;
+        return to_mask(a.native_vector <= b.native_vector);
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
     friend Mask operator>(const Vec &a, const Vec &b) {
-        Mask r;
-        for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = a[i] > b[i] ? 0xff : 0x00;
-        }
-        return r;
+        return to_mask(a.native_vector > b.native_vector);
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
     friend Mask operator>=(const Vec &a, const Vec &b) {
-        Mask r;
-        for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = a[i] >= b[i] ? 0xff : 0x00;
-        }
-        return r;
+        return to_mask(a.native_vector >= b.native_vector);
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
     friend Mask operator==(const Vec &a, const Vec &b) {
-        Mask r;
-        for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = a[i] == b[i] ? 0xff : 0x00;
-        }
-        return r;
+        return to_mask(a.native_vector == b.native_vector);
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
     friend Mask operator!=(const Vec &a, const Vec &b) {
-        Mask r;
-        for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = a[i] != b[i] ? 0xff : 0x00;
-        }
-        return r;
+        return to_mask(a.native_vector != b.native_vector);
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
     static Vec select(const Mask &cond, const Vec &true_value, const Vec &false_value) {
-        Vec r(empty);
-        for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = cond[i] ? true_value[i] : false_value[i];
-        }
-        return r;
+        const CompareVectorType m =
+            NativeVectorMaskOps<sizeof(ElementType), Lanes>::template widen_mask<CompareVectorType>(cond.native_vector);
+        const CompareVectorType t = (CompareVectorType)true_value.native_vector;
+        const CompareVectorType f = (CompareVectorType)false_value.native_vector;
+        return Vec(from_native_vector, (NativeVectorType)((m & t) | (~m & f)));
     }
 
     template <typename OtherVec>
@@ -1233,22 +1472,12 @@ public:
 #endif
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
     static Vec max(const Vec &a, const Vec &b) {
-        Vec r(empty);
-        for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = ::halide_cpp_max(a[i], b[i]);
-        }
-        return r;
+        return Vec(from_native_vector, NativeVectorOps<ElementType, Lanes>::max(a.native_vector, b.native_vector));
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
     static Vec min(const Vec &a, const Vec &b) {
-        Vec r(empty);
-        for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = ::halide_cpp_min(a[i], b[i]);
-        }
-        return r;
+        return Vec(from_native_vector, NativeVectorOps<ElementType, Lanes>::min(a.native_vector, b.native_vector));
     }
 
 private:
@@ -1266,6 +1495,11 @@ private:
 
     NativeVectorType native_vector;
 
+    static Mask to_mask(const CompareVectorType &c) {
+        return Mask(Mask::from_native_vector,
+                    NativeVectorMaskOps<sizeof(ElementType), Lanes>::template narrow_mask<typename Mask::NativeVectorType>(c));
+    }
+
     // Leave vector uninitialized for cases where we overwrite every entry
     enum Empty { empty };
     inline NativeVector(Empty) {}
@@ -2597,7 +2831,14 @@ void CodeGen_C::visit(const For *op) {
     string id_min = print_expr(op->min);
     string id_extent = print_expr(op->extent);
 
-    if (op->for_type == ForType::Parallel) {
+    const bool parallel = op->for_type == ForType::Parallel;
+    string id_error;
+    if (parallel) {
+        // The body of an OpenMP parallel loop can't return from the
+        // function, so failures are collected here and returned after
+        // the loop.
+        id_error = unique_name('_');
+        stream << get_indent() << "int " << id_error << " = 0;\n";
         stream << get_indent() << "#pragma omp parallel for\n";
     } else {
         internal_assert(op->for_type == ForType::Serial)
@@ -2616,8 +2857,33 @@ void CodeGen_C::visit(const For *op) {
            << "++)\n";
 
     open_scope();
-    op->body.accept(this);
+    if (parallel) {
+        // Run the body in a lambda, so that asserts in it can return
+        // as usual.
+        string id_result = unique_name('_');
+        stream << get_indent() << "int " << id_result << " = [&]() -> int\n";
+        open_scope();
+        op->body.accept(this);
+        stream << get_indent() << "return 0;\n";
+        cache.clear();
+        indent--;
+        stream << get_indent() << "}();\n";
+        stream << get_indent() << "if (" << id_result << " != 0)\n";
+        open_scope();
+        stream << get_indent() << "#pragma omp critical\n";
+        stream << get_indent() << id_error << " = " << id_result << ";\n";
+        close_scope("");
+    } else {
+        op->body.accept(this);
+    }
     close_scope("for " + print_name(op->name));
+
+    if (parallel) {
+        stream << get_indent() << "if (" << id_error << " != 0)\n";
+        open_scope();
+        stream << get_indent() << "return " << id_error << ";\n";
+        close_scope("");
+    }
 }
 
 void CodeGen_C::visit(const Ramp *op) {
@@ -2661,7 +2927,8 @@ void CodeGen_C::visit(const Allocate *op) {
         alloc.type = op->type;
         allocations.push(op->name, alloc);
         heap_allocations.push(op->name);
-        stream << op_type << "*" << op_name << " = (" << print_expr(op->new_expr) << ");\n";
+        stream << get_indent() << op_type << "*" << op_name
+               << " = (" << op_type << "*)(" << print_expr(op->new_expr) << ");\n";
     } else {
         constant_size = op->constant_allocation_size();
         if (constant_size > 0) {
@@ -204,6 +204,8 @@ bool function_takes_user_context(const std::string &name) {
         "halide_memoization_cache_lookup",
         "halide_memoization_cache_store",
         "halide_memoization_cache_release",
+        "halide_scratch_pool_create",
+        "halide_scratch_pool_alloc",
         "halide_cuda_run",
         "halide_opencl_run",
         "halide_opengl_run",
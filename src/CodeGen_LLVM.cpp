@@ -1265,7 +1265,14 @@ void CodeGen_LLVM::optimize_module() {
     pb.crossRegisterProxies(lam, fam, cgam, mam);
     ModulePassManager mpm(debug_pass_manager);
 
-    PassBuilder::OptimizationLevel level = PassBuilder::OptimizationLevel::O3;
+    // The first, quick compilation of Target::TieredJIT only does
+    // cheap optimizations. The pipeline is then compiled again
+    // without it in the background. Ahead-of-time compiles have no
+    // second tier, so they ignore the feature.
+    const bool quick_tier = get_target().has_feature(Target::TieredJIT) &&
+                            get_target().has_feature(Target::JIT);
+    PassBuilder::OptimizationLevel level =
+        quick_tier ? PassBuilder::OptimizationLevel::O1 : PassBuilder::OptimizationLevel::O3;
 
     if (get_target().has_feature(Target::ASAN)) {
         pb.registerPipelineStartEPCallback([&](ModulePassManager &mpm) {
@@ -1,5 +1,6 @@
 #include <iostream>
 
+#include "CodeGen_Internal.h"
 #include "CodeGen_X86.h"
 #include "ConciseCasts.h"
 #include "Debug.h"
@@ -446,6 +447,90 @@ void CodeGen_X86::visit(const VectorReduce *op) {
     CodeGen_Posix::visit(op);
 }
 
+namespace {
+bool is_power_of_two(int x) {
+    return (x & (x - 1)) == 0;
+}
+}  // namespace
+
+bool CodeGen_X86::should_use_gather(const Type &t, const Expr &index) const {
+    if (!target.has_feature(Target::AVX2) ||
+        t.is_scalar() || t.is_handle() ||
+        index.as<Ramp>() || index.as<Broadcast>()) {
+        return false;
+    }
+    // Hardware gathers are only worth it for at least four lanes of
+    // 32 or 64 bits. Gathering narrower types would touch memory
+    // beyond each element. Before AVX-512, 64-bit gathers are slower
+    // than doing four scalar loads.
+    bool avx512 = native_vector_bits() == 512;
+    return ((t.bits() == 32 || (t.bits() == 64 && avx512)) &&
+            t.lanes() >= 4 &&
+            is_power_of_two(t.lanes()));
+}
+
+bool CodeGen_X86::should_use_scatter(const Type &t, const Expr &index) const {
+    // Scatters only exist in AVX-512.
+    if (native_vector_bits() != 512 ||
+        t.is_scalar() || t.is_handle() ||
+        index.as<Ramp>() || index.as<Broadcast>()) {
+        return false;
+    }
+    return ((t.bits() == 32 || t.bits() == 64) &&
+            t.lanes() >= 4 &&
+            is_power_of_two(t.lanes()));
+}
+
+Value *CodeGen_X86::codegen_lane_pointers(const string &buffer, const Type &t, const Expr &index) {
+    Value *base = codegen_buffer_pointer(buffer, t.element_of(), make_zero(Int(32)));
+    Value *idx = codegen(index);
+    // Sign-extend the indices to the pointer size. LLVM recognizes
+    // this and still uses 32-bit indices in the gather instruction.
+    llvm::DataLayout d(module.get());
+    if (d.getPointerSize() == 8) {
+        idx = builder->CreateIntCast(idx, get_vector_type(i64_t, t.lanes()), true);
+    }
+    return builder->CreateInBoundsGEP(base, idx);
+}
+
+void CodeGen_X86::visit(const Load *op) {
+    if (is_one(op->predicate) && should_use_gather(op->type, op->index)) {
+        Value *ptrs = codegen_lane_pointers(op->name, op->type, op->index);
+#if LLVM_VERSION >= 110
+        Instruction *load = builder->CreateMaskedGather(ptrs, llvm::Align(op->type.bytes()));
+#else
+        Instruction *load = builder->CreateMaskedGather(ptrs, op->type.bytes());
+#endif
+        add_tbaa_metadata(load, op->name, op->index);
+        value = load;
+        return;
+    }
+
+    CodeGen_Posix::visit(op);
+}
+
+void CodeGen_X86::visit(const Store *op) {
+    Type t = op->value.type();
+    if (is_one(op->predicate) &&
+        !emit_atomic_stores &&
+        !inside_atomic_mutex_node &&
+        should_use_scatter(t, op->index)) {
+        Value *val = codegen(op->value);
+        Value *ptrs = codegen_lane_pointers(op->name, t, op->index);
+        // Lanes that store to the same address are written in order,
+        // so the last one wins, as it would for scalar stores.
+#if LLVM_VERSION >= 110
+        Instruction *store = builder->CreateMaskedScatter(val, ptrs, llvm::Align(t.bytes()));
+#else
+        Instruction *store = builder->CreateMaskedScatter(val, ptrs, t.bytes());
+#endif
+        add_tbaa_metadata(store, op->name, op->index);
+        return;
+    }
+
+    CodeGen_Posix::visit(op);
+}
+
 string CodeGen_X86::mcpu() const {
     if (target.has_feature(Target::AVX512_Cannonlake)) return "cannonlake";
     if (target.has_feature(Target::AVX512_Skylake)) return "skylake-avx512";
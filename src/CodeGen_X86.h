@@ -49,7 +49,21 @@ protected:
     void visit(const Select *) override;
     void visit(const VectorReduce *) override;
     void visit(const Mul *) override;
+    void visit(const Load *) override;
+    void visit(const Store *) override;
     // @}
+
+    /** Whether a vector load (or store) of the given type with a
+     * non-ramp index should use a hardware gather (or scatter)
+     * instead of one scalar access per lane. */
+    // @{
+    bool should_use_gather(const Type &t, const Expr &index) const;
+    bool should_use_scatter(const Type &t, const Expr &index) const;
+    // @}
+
+    /** Compute a vector of pointers to the lanes of a gather or
+     * scatter. */
+    llvm::Value *codegen_lane_pointers(const std::string &buffer, const Type &t, const Expr &index);
 };
 
 }  // namespace Internal
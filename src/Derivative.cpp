@@ -1,4 +1,5 @@
 #include <cmath>
+#include <functional>
 #include <iostream>
 #include <set>
 
@@ -14,6 +15,7 @@
 #include "IREquality.h"
 #include "IRMutator.h"
 #include "IROperator.h"
+#include "Qualify.h"
 #include "RealizationOrder.h"
 #include "Simplify.h"
 #include "Solve.h"
@@ -38,13 +40,129 @@ bool is_float_extern(const string &op_name,
            op_name == (func_name + "_f64");
 };
 
+/** Count the distinct IR nodes in a set of expressions, as a rough
+ * measure of the cost of recomputing them.
+ */
+class CountNodes : public IRGraphVisitor {
+    using IRGraphVisitor::include;
+
+    set<const IRNode *> nodes;
+
+    void include(const Expr &e) override {
+        nodes.insert(e.get());
+        IRGraphVisitor::include(e);
+    }
+
+public:
+    size_t count() const {
+        return nodes.size();
+    }
+};
+
+/** Count the call sites of each Func in an expression. Unlike the
+ * nodes counted above, a shared subexpression counts once per use, as
+ * inlining expands each use separately.
+ */
+class CountCalls : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        if (op->call_type == Call::Halide) {
+            counts[op->name]++;
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    map<string, size_t> counts;
+};
+
+/** Does an expression give the same value wherever it is evaluated, so
+ * that it can be recomputed elsewhere? Calls to other Funcs are fine;
+ * calls with side effects, and random numbers (which are seeded by the
+ * pure variables of the enclosing Func), are not.
+ */
+class CanRecompute : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Call *op) override {
+        if (op->is_intrinsic(Call::random) ||
+            !(op->is_pure() || op->call_type == Call::Halide)) {
+            result = false;
+        } else {
+            IRGraphVisitor::visit(op);
+        }
+    }
+
+public:
+    bool result = true;
+};
+
+/** Does an expression load from a Func, a buffer, or anything else
+ * that is not known from its variables alone?
+ */
+class DependsOnData : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Call *op) override {
+        if (op->call_type == Call::Halide ||
+            op->call_type == Call::Image ||
+            !op->is_pure()) {
+            result = true;
+        } else {
+            IRGraphVisitor::visit(op);
+        }
+    }
+
+public:
+    bool result = false;
+};
+
+bool depends_on_data(const Expr &e) {
+    DependsOnData d;
+    e.accept(&d);
+    return d.result;
+}
+
+/** Replace calls to forward Funcs with their definitions, so that the
+ * adjoints recompute them rather than reading their stored values.
+ */
+class RecomputeCalls : public IRMutator {
+    using IRMutator::visit;
+
+    const map<string, Function> &recomputed;
+
+    Expr visit(const Call *op) override {
+        auto it = recomputed.find(op->name);
+        if (op->call_type != Call::Halide || it == recomputed.end()) {
+            return IRMutator::visit(op);
+        }
+        const Function &f = it->second;
+        const vector<string> &func_args = f.args();
+        internal_assert(op->args.size() == func_args.size());
+
+        Expr body = qualify(f.name() + ".", f.values()[op->value_index]);
+        for (size_t i = 0; i < func_args.size(); i++) {
+            body = Let::make(f.name() + "." + func_args[i], op->args[i], body);
+        }
+        // The definition (and the args) may call other recomputed Funcs.
+        return mutate(body);
+    }
+
+public:
+    RecomputeCalls(const map<string, Function> &recomputed)
+        : recomputed(recomputed) {
+    }
+};
+
 /** Compute derivatives through reverse accumulation
  */
 class ReverseAccumulationVisitor : public IRVisitor {
 public:
     void propagate_adjoints(const Func &output,
                             const Func &adjoint,
-                            const Region &output_bounds);
+                            const Region &output_bounds,
+                            const CheckpointOptions &checkpoint);
 
     map<FuncKey, Func> get_adjoint_funcs() const {
         return adjoint_funcs;
@@ -143,6 +261,11 @@ protected:
 private:
     void accumulate(const Expr &stub, Expr adjoint);
 
+    // Recompute forward functions inside the adjoints until the ones
+    // they read fit in the memory budget
+    void recompute_forward_funcs(const map<string, Function> &env,
+                                 const CheckpointOptions &checkpoint);
+
     void propagate_halide_function_call(
         Expr adjoint,
         const std::string &name,             // called function name
@@ -181,7 +304,8 @@ private:
 void ReverseAccumulationVisitor::propagate_adjoints(
     const Func &output,
     const Func &adjoint,
-    const Region &output_bounds) {
+    const Region &output_bounds,
+    const CheckpointOptions &checkpoint) {
     // Topologically sort the functions
     map<string, Function> env = find_transitive_calls(output.function());
     vector<string> order =
@@ -758,6 +882,239 @@ void ReverseAccumulationVisitor::propagate_adjoints(
             }
         }
     }
+
+    if (checkpoint.memory_budget >= 0) {
+        recompute_forward_funcs(env, checkpoint);
+    }
+}
+
+void ReverseAccumulationVisitor::recompute_forward_funcs(
+    const map<string, Function> &env,
+    const CheckpointOptions &checkpoint) {
+    const int64_t memory_budget = checkpoint.memory_budget;
+    // The size in bytes of each forward function, where it's known
+    map<string, int64_t> func_sizes;
+    for (const auto &it : env) {
+        auto bounds_it = func_bounds.find(it.first);
+        if (bounds_it == func_bounds.end()) {
+            continue;
+        }
+        int64_t size = 0;
+        for (const Type &t : it.second.output_types()) {
+            size += t.bytes();
+        }
+        const Box &bounds = bounds_it->second;
+        for (size_t d = 0; d < bounds.size(); d++) {
+            const int64_t *extent = as_const_int(simplify(bounds[d].max - bounds[d].min + 1));
+            if (extent == nullptr) {
+                size = -1;
+                break;
+            }
+            size *= std::max(*extent, (int64_t)0);
+        }
+        if (size >= 0) {
+            func_sizes[it.first] = size;
+        }
+    }
+
+    // The forward functions each function calls, the ones the adjoints
+    // call directly, and the ones it's legal and worthwhile to recompute.
+    // Functions with updates can't be recomputed inside the adjoints, and
+    // ones with unknown sizes don't count against the budget, so those
+    // are always kept.
+    map<string, vector<string>> callees;
+    for (const auto &it : env) {
+        for (const auto &call : find_direct_calls(it.second)) {
+            if (env.count(call.first)) {
+                callees[it.first].push_back(call.first);
+            }
+        }
+    }
+    set<string> adjoint_calls;
+    for (const auto &it : adjoint_funcs) {
+        for (const auto &call : find_direct_calls(it.second.function())) {
+            if (env.count(call.first)) {
+                adjoint_calls.insert(call.first);
+            }
+        }
+    }
+    // The nodes in each recomputable function's own definition, and
+    // how many times it calls each function.
+    map<string, size_t> own_nodes;
+    map<string, map<string, size_t>> call_counts;
+    for (const auto &it : env) {
+        const Function &f = it.second;
+        if (!f.can_be_inlined() || f.has_extern_definition() ||
+            !func_sizes.count(it.first)) {
+            continue;
+        }
+        CanRecompute can_recompute;
+        CountNodes count_nodes;
+        CountCalls count_calls;
+        for (const Expr &e : f.values()) {
+            e.accept(&can_recompute);
+            e.accept(&count_nodes);
+            e.accept(&count_calls);
+        }
+        if (can_recompute.result) {
+            own_nodes[it.first] = std::max(count_nodes.count(), (size_t)1);
+            call_counts[it.first] = std::move(count_calls.counts);
+        }
+    }
+
+    // The size of each recomputed function once the recomputed
+    // functions it calls are inlined into it, and so on down the
+    // chain. Each call site gets its own copy, so this grows
+    // exponentially along a chain of stencils; sizes are capped just
+    // past the limit to avoid overflow, as anything past it is
+    // rejected anyway.
+    const size_t max_inlined_nodes = (size_t)std::max(checkpoint.max_inlined_nodes, 1);
+    auto inlined_nodes = [&](const set<string> &recomputed) {
+        map<string, size_t> sizes;
+        // Recomputed functions have no updates, so they can't call
+        // themselves, and the calls between them form a DAG.
+        std::function<size_t(const string &)> size_of = [&](const string &name) {
+            auto it = sizes.find(name);
+            if (it != sizes.end()) {
+                return it->second;
+            }
+            size_t size = own_nodes.at(name);
+            for (const auto &call : call_counts.at(name)) {
+                if (recomputed.count(call.first) && size <= max_inlined_nodes) {
+                    // The inlined definition replaces the call node.
+                    size_t callee_size = size_of(call.first);
+                    size += call.second * (callee_size - 1);
+                }
+            }
+            size = std::min(size, max_inlined_nodes + 1);
+            sizes[name] = size;
+            return size;
+        };
+        for (const string &name : recomputed) {
+            size_of(name);
+        }
+        return sizes;
+    };
+    auto total_nodes = [](const map<string, size_t> &sizes) {
+        size_t total = 0;
+        for (const auto &it : sizes) {
+            total += it.second;
+        }
+        return total;
+    };
+
+    // The forward functions the gradient pipeline needs if the given
+    // ones are recomputed, and the memory they take. These are the
+    // ones the adjoints read, and all of their producers: recomputing
+    // a function only changes the adjoints, so it's still needed if a
+    // function the adjoints read calls it.
+    auto live_funcs = [&](const set<string> &recomputed) {
+        set<string> live, expanded;
+        vector<string> pending(adjoint_calls.begin(), adjoint_calls.end());
+        while (!pending.empty()) {
+            string name = pending.back();
+            pending.pop_back();
+            if (!recomputed.count(name)) {
+                live.insert(name);
+            } else if (expanded.insert(name).second) {
+                pending.insert(pending.end(), callees[name].begin(), callees[name].end());
+            }
+        }
+        vector<string> producers_of(live.begin(), live.end());
+        while (!producers_of.empty()) {
+            string name = producers_of.back();
+            producers_of.pop_back();
+            for (const string &callee : callees[name]) {
+                if (live.insert(callee).second) {
+                    producers_of.push_back(callee);
+                }
+            }
+        }
+        return live;
+    };
+    auto memory_used = [&](const set<string> &live) {
+        int64_t total = 0;
+        for (const string &name : live) {
+            auto it = func_sizes.find(name);
+            if (it != func_sizes.end()) {
+                total += it->second;
+            }
+        }
+        return total;
+    };
+
+    // Greedily recompute the function that saves the most memory per
+    // node recomputed, until the rest fit. Recomputing a function can
+    // save nothing at first (if a function the adjoints read still
+    // calls it), but become worthwhile once its consumers are
+    // recomputed too. Its cost is how much it grows the inlined
+    // definitions of all the recomputed functions, including the
+    // consumers it's inlined into, and it's skipped if any of those
+    // would get too large.
+    set<string> recomputed;
+    set<string> live = live_funcs(recomputed);
+    int64_t used = memory_used(live);
+    size_t recomputed_nodes = 0;
+    while (used > memory_budget) {
+        string best;
+        double best_score = -1;
+        set<string> best_live;
+        int64_t best_used = 0;
+        size_t best_nodes = 0;
+        for (const string &name : live) {
+            if (!own_nodes.count(name) || recomputed.count(name)) {
+                continue;
+            }
+            set<string> candidate = recomputed;
+            candidate.insert(name);
+            map<string, size_t> candidate_sizes = inlined_nodes(candidate);
+            bool too_large = false;
+            for (const auto &it : candidate_sizes) {
+                too_large |= it.second > max_inlined_nodes;
+            }
+            if (too_large) {
+                debug(2) << "Not recomputing " << name
+                         << ", as its inlined definition would be too large\n";
+                continue;
+            }
+            set<string> candidate_live = live_funcs(candidate);
+            int64_t candidate_used = memory_used(candidate_live);
+            if (candidate_used > used) {
+                continue;
+            }
+            size_t candidate_nodes = total_nodes(candidate_sizes);
+            size_t cost = candidate_nodes > recomputed_nodes ? candidate_nodes - recomputed_nodes : 1;
+            double score = (double)(used - candidate_used) / cost;
+            if (score > best_score) {
+                best = name;
+                best_score = score;
+                best_live = std::move(candidate_live);
+                best_used = candidate_used;
+                best_nodes = candidate_nodes;
+            }
+        }
+        if (best.empty()) {
+            break;
+        }
+        debug(1) << "Recomputing " << best << " in the adjoints\n";
+        recomputed.insert(best);
+        live = std::move(best_live);
+        used = best_used;
+        recomputed_nodes = best_nodes;
+    }
+    if (used > memory_budget) {
+        debug(1) << "The forward functions the adjoints need take " << used
+                 << " bytes, over the checkpointing budget of " << memory_budget << " bytes\n";
+    }
+
+    map<string, Function> recomputed_funcs;
+    for (const string &name : recomputed) {
+        recomputed_funcs.emplace(name, env.at(name));
+    }
+    RecomputeCalls recompute_calls(recomputed_funcs);
+    for (auto &it : adjoint_funcs) {
+        it.second.function().mutate(&recompute_calls);
+    }
 }
 
 void ReverseAccumulationVisitor::accumulate(const Expr &stub, Expr adjoint) {
@@ -1500,6 +1857,39 @@ void ReverseAccumulationVisitor::propagate_halide_function_call(
         }
     }
 
+    // Scattering through data-dependent indices, such as the slicing of a
+    // bilateral grid or a histogram with a few bins, makes an update like
+    //  f'(h(r.x)) += g'(r.x)
+    // which can only run in parallel with atomics. If the dimension of f
+    // is small, we instead gather into every element of it:
+    //  f'(u) += select(h(r.x) == u, g'(r.x), 0)
+    // This does extent times the work, but u is now a pure variable, so the
+    // update parallelizes and vectorizes over it, and the reduction over r
+    // is associative and can be factored.
+    const int64_t max_gather_extent = 16;
+    auto target_bounds_it = func_bounds.find(name);
+    if (target_bounds_it != func_bounds.end()) {
+        const Box &target_bounds = target_bounds_it->second;
+        Expr hit;
+        for (int i = 0; i < (int)lhs.size(); i++) {
+            if (canonicalized[i] || is_const(lhs[i]) ||
+                !depends_on_data(lhs[i])) {
+                continue;
+            }
+            const int64_t *extent =
+                as_const_int(simplify(target_bounds[i].max - target_bounds[i].min + 1));
+            if (extent == nullptr || *extent > max_gather_extent) {
+                continue;
+            }
+            Expr cond = lhs[i] == new_args[i];
+            hit = hit.defined() ? (hit && cond) : cond;
+            lhs[i] = new_args[i];
+        }
+        if (hit.defined()) {
+            adjoint = select(hit, adjoint, make_zero(adjoint.type()));
+        }
+    }
+
     // Simplify expressions
     adjoint = simplify(common_subexpression_elimination(adjoint));
     for (int i = 0; i < (int)lhs.size(); i++) {
@@ -1949,31 +2339,34 @@ Func Derivative::operator()(const Param<> &param) const {
 
 Derivative propagate_adjoints(const Func &output,
                               const Func &adjoint,
-                              const Region &output_bounds) {
+                              const Region &output_bounds,
+                              const CheckpointOptions &checkpoint) {
     user_assert(output.dimensions() == adjoint.dimensions())
         << "output dimensions and adjoint dimensions must match\n";
     user_assert((int)output_bounds.size() == adjoint.dimensions())
         << "output_bounds and adjoint dimensions must match\n";
 
     Internal::ReverseAccumulationVisitor visitor;
-    visitor.propagate_adjoints(output, adjoint, output_bounds);
+    visitor.propagate_adjoints(output, adjoint, output_bounds, checkpoint);
     // Since the return value of get_adjoint_funcs() is a temporary,
     // we should *not* use std::move.
     return Derivative{visitor.get_adjoint_funcs()};
 }
 
 Derivative propagate_adjoints(const Func &output,
-                              const Buffer<float> &adjoint) {
+                              const Buffer<float> &adjoint,
+                              const CheckpointOptions &checkpoint) {
     user_assert(output.dimensions() == adjoint.dimensions());
     Region bounds;
     for (int dim = 0; dim < adjoint.dimensions(); dim++) {
         bounds.emplace_back(adjoint.min(dim), adjoint.min(dim) + adjoint.extent(dim) - 1);
     }
     Func adjoint_func = BoundaryConditions::constant_exterior(adjoint, 0.f);
-    return propagate_adjoints(output, adjoint_func, bounds);
+    return propagate_adjoints(output, adjoint_func, bounds, checkpoint);
 }
 
-Derivative propagate_adjoints(const Func &output) {
+Derivative propagate_adjoints(const Func &output,
+                              const CheckpointOptions &checkpoint) {
     Func adjoint("adjoint");
     adjoint(output.args()) = Internal::make_one(output.value().type());
     Region output_bounds;
@@ -1981,7 +2374,7 @@ Derivative propagate_adjoints(const Func &output) {
     for (int i = 0; i < output.dimensions(); i++) {
         output_bounds.push_back({0, 0});
     }
-    return propagate_adjoints(output, adjoint, output_bounds);
+    return propagate_adjoints(output, adjoint, output_bounds, checkpoint);
 }
 
 }  // namespace Halide
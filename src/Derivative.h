@@ -41,6 +41,39 @@ private:
     const std::map<FuncKey, Func> adjoints;
 };
 
+/**
+ *  Options for checkpointing: trading memory for recomputation in the
+ *  adjoints. By default, the adjoints read the values of every forward
+ *  Func they depend on, so all of those must be kept alive for the
+ *  backward pass. Given a memory budget, propagate_adjoints instead
+ *  recomputes forward Funcs inside the adjoints (by inlining their
+ *  definitions), choosing which greedily, until the forward Funcs the
+ *  adjoints still read, together with the Funcs those are computed
+ *  from, fit in the budget. Recomputing a Func whose producers are
+ *  recomputed too inlines those as well, so the cost of each choice is
+ *  the size of the fully inlined definition, which grows quickly along
+ *  a chain of stencils; a Func is never recomputed if that would take
+ *  more than max_inlined_nodes. A recomputed Func still needs storage if a
+ *  Func the adjoints read calls it. The budget is in terms of the
+ *  bounds of each Func, so it doesn't account for the schedule: an
+ *  inlined forward Func takes less, and the gradient pipeline's own
+ *  intermediates aren't counted. Funcs with update definitions,
+ *  extern Funcs, Funcs with side effects or random numbers, and Funcs
+ *  whose bounds aren't known at compile time are never recomputed, and
+ *  the latter don't count against the budget.
+ */
+struct CheckpointOptions {
+    /** The most memory, in bytes, that the forward Funcs needed by
+     *  the adjoints should take. Negative means no limit, so nothing
+     *  is recomputed. */
+    int64_t memory_budget = -1;
+
+    /** The largest expression, in IR nodes, that recomputing a Func
+     *  may inline into the adjoints, counting the recomputed Funcs it
+     *  calls. */
+    int max_inlined_nodes = 1024;
+};
+
 /**
  *  Given a Func and a corresponding adjoint, (back)propagate the
  *  adjoint to all dependent Funcs, buffers, and parameters.
@@ -51,7 +84,8 @@ private:
  */
 Derivative propagate_adjoints(const Func &output,
                               const Func &adjoint,
-                              const Region &output_bounds);
+                              const Region &output_bounds,
+                              const CheckpointOptions &checkpoint = CheckpointOptions());
 /**
  *  Given a Func and a corresponding adjoint buffer, (back)propagate the
  *  adjoint to all dependent Funcs, buffers, and parameters.
@@ -60,7 +94,8 @@ Derivative propagate_adjoints(const Func &output,
  *  the Derivative.
  */
 Derivative propagate_adjoints(const Func &output,
-                              const Buffer<float> &adjoint);
+                              const Buffer<float> &adjoint,
+                              const CheckpointOptions &checkpoint = CheckpointOptions());
 /**
  *  Given a scalar Func with size 1, (back)propagate the gradient
  *  to all dependent Funcs, buffers, and parameters.
@@ -68,7 +103,8 @@ Derivative propagate_adjoints(const Func &output,
  *  each update of that Func, it generates a derivative Func stored in
  *  the Derivative.
  */
-Derivative propagate_adjoints(const Func &output);
+Derivative propagate_adjoints(const Func &output,
+                              const CheckpointOptions &checkpoint = CheckpointOptions());
 
 }  // namespace Halide
 
@@ -1,9 +1,242 @@
 #include "Expr.h"
 #include "IROperator.h"  // for lossless_cast()
+#include "Util.h"
+
+#include <mutex>
+#include <vector>
 
 namespace Halide {
 namespace Internal {
 
+namespace {
+
+// IR nodes are recycled through free lists of blocks of each size,
+// kept per thread so that the common case needs no locking. New blocks
+// are carved out of large slabs, so nodes made together are close
+// together in memory. Slabs are never returned to the system, because
+// a block may be freed by a different thread from the one that
+// allocated it. Instead, free blocks move to a shared pool in batches
+// when a thread holds too many, and all of them move when it exits.
+// Threads refill from the shared pool one batch at a time, so the
+// shared lock is only ever held for a constant amount of work.
+
+// Memory checkers need to see each node allocated and freed, so don't
+// pool nodes in sanitizer builds. Valgrind is detected at runtime below.
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(memory_sanitizer) || __has_feature(thread_sanitizer)
+#define HALIDE_NO_IR_NODE_POOL 1
+#endif
+#endif
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define HALIDE_NO_IR_NODE_POOL 1
+#endif
+
+constexpr size_t node_granularity = 16;
+constexpr size_t max_pooled_node_size = 256;
+constexpr int num_size_classes = max_pooled_node_size / node_granularity;
+constexpr size_t slab_size = 64 * 1024;
+constexpr size_t max_local_blocks = 4096;
+constexpr size_t transfer_batch_blocks = max_local_blocks / 2;
+
+struct FreeBlock {
+    FreeBlock *next;
+};
+
+struct FreeList {
+    FreeBlock *head = nullptr;
+    FreeBlock *tail = nullptr;
+    size_t count = 0;
+
+    void push(void *ptr) {
+        FreeBlock *b = (FreeBlock *)ptr;
+        b->next = head;
+        head = b;
+        if (!tail) {
+            tail = b;
+        }
+        count++;
+    }
+
+    void *pop() {
+        FreeBlock *b = head;
+        head = b->next;
+        if (!head) {
+            tail = nullptr;
+        }
+        count--;
+        return b;
+    }
+
+    // Move all the blocks of this list to the front of another one.
+    void move_to(FreeList &other) {
+        if (!head) {
+            return;
+        }
+        tail->next = other.head;
+        if (!other.tail) {
+            other.tail = tail;
+        }
+        other.head = head;
+        other.count += count;
+        head = tail = nullptr;
+        count = 0;
+    }
+
+    // Remove up to n blocks from the front of this list, and return
+    // them as a list of their own.
+    FreeList split_front(size_t n) {
+        FreeList result;
+        if (n >= count) {
+            std::swap(result, *this);
+            return result;
+        }
+        FreeBlock *last = head;
+        for (size_t i = 1; i < n; i++) {
+            last = last->next;
+        }
+        result.head = head;
+        result.tail = last;
+        result.count = n;
+        head = last->next;
+        last->next = nullptr;
+        count -= n;
+        return result;
+    }
+};
+
+struct SharedPool {
+    std::mutex mutex;
+    // Batches of free blocks, given up by threads that held too many
+    // or that exited.
+    std::vector<FreeList> batches[num_size_classes];
+    // Blocks freed one at a time, by threads whose pools are gone.
+    FreeList loose[num_size_classes];
+};
+
+SharedPool &shared_pool() {
+    // Leaked, so that nodes can still be freed during static destruction.
+    static SharedPool *pool = new SharedPool;
+    return *pool;
+}
+
+// Take one batch of free blocks of a size class from the shared pool, if
+// there are any. Must be called with the shared pool's mutex held.
+FreeList take_shared_batch(SharedPool &shared, int size_class) {
+    FreeList result;
+    std::vector<FreeList> &batches = shared.batches[size_class];
+    if (!batches.empty()) {
+        result = batches.back();
+        batches.pop_back();
+    } else {
+        std::swap(result, shared.loose[size_class]);
+    }
+    return result;
+}
+
+void carve_slab(FreeList &list, int size_class) {
+    size_t block_size = (size_class + 1) * node_granularity;
+    char *slab = (char *)::operator new(slab_size);
+    for (size_t offset = 0; offset + block_size <= slab_size; offset += block_size) {
+        list.push(slab + offset);
+    }
+}
+
+struct LocalPool {
+    FreeList lists[num_size_classes];
+    ~LocalPool();
+};
+
+thread_local LocalPool local_pool;
+// Nodes can be freed by other thread_local destructors after this
+// thread's pool is gone, so we keep track of that in a variable with
+// no destructor.
+thread_local bool local_pool_destroyed = false;
+
+LocalPool::~LocalPool() {
+    SharedPool &shared = shared_pool();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    for (int c = 0; c < num_size_classes; c++) {
+        if (lists[c].head) {
+            shared.batches[c].push_back(lists[c]);
+            lists[c] = FreeList();
+        }
+    }
+    local_pool_destroyed = true;
+}
+
+bool running_under_valgrind() {
+    // Valgrind preloads its own libraries into the process it runs.
+    std::string preload = get_env_variable("LD_PRELOAD");
+    return preload.find("vgpreload") != std::string::npos;
+}
+
+bool use_node_pool() {
+#ifdef HALIDE_NO_IR_NODE_POOL
+    return false;
+#else
+    static const bool use = get_env_variable("HL_IR_NODE_POOL") != "0" && !running_under_valgrind();
+    return use;
+#endif
+}
+
+}  // namespace
+
+void *IRNode::operator new(size_t size) {
+    if (size > max_pooled_node_size || !use_node_pool()) {
+        return ::operator new(size);
+    }
+    int size_class = (int)((size - 1) / node_granularity);
+    if (local_pool_destroyed) {
+        SharedPool &shared = shared_pool();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        FreeList &list = shared.loose[size_class];
+        if (!list.head) {
+            list = take_shared_batch(shared, size_class);
+        }
+        if (!list.head) {
+            carve_slab(list, size_class);
+        }
+        return list.pop();
+    }
+    FreeList &list = local_pool.lists[size_class];
+    if (!list.head) {
+        SharedPool &shared = shared_pool();
+        {
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            list = take_shared_batch(shared, size_class);
+        }
+        if (!list.head) {
+            carve_slab(list, size_class);
+        }
+    }
+    return list.pop();
+}
+
+void IRNode::operator delete(void *ptr, size_t size) {
+    if (size > max_pooled_node_size || !use_node_pool()) {
+        ::operator delete(ptr);
+        return;
+    }
+    int size_class = (int)((size - 1) / node_granularity);
+    SharedPool &shared = shared_pool();
+    if (local_pool_destroyed) {
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        shared.loose[size_class].push(ptr);
+        return;
+    }
+    FreeList &list = local_pool.lists[size_class];
+    list.push(ptr);
+    if (list.count > max_local_blocks) {
+        // Keep the most recently freed blocks, which are likely still
+        // in cache, and give up the rest. The list is split outside
+        // the lock.
+        FreeList batch = list.split_front(list.count - transfer_batch_blocks);
+        std::swap(batch, list);
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        shared.batches[size_class].push_back(batch);
+    }
+}
+
 const IntImm *IntImm::make(Type t, int64_t value) {
     internal_assert(t.is_int() && t.is_scalar())
         << "IntImm must be a scalar Int\n";
@@ -91,6 +91,15 @@ struct IRNode {
     }
     virtual ~IRNode() = default;
 
+    /** Lowering makes and frees huge numbers of small IR nodes, so
+     * they are allocated from per-thread free lists of blocks of each
+     * size rather than directly from the heap. Set the environment
+     * variable HL_IR_NODE_POOL=0, or define HALIDE_NO_IR_NODE_POOL
+     * when building Halide, to use the heap instead. Sanitizer builds
+     * and runs under valgrind always use the heap. */
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+
     /** These classes are all managed with intrusive reference
      * counting, so we also track a reference count. It's mutable
      * so that we can do reference counting even through const
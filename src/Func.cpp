@@ -2060,6 +2060,15 @@ Func &Func::async() {
     return *this;
 }
 
+Func &Func::async(int depth) {
+    user_assert(depth >= 0)
+        << "Can't schedule Func " << name() << " as async with negative depth " << depth << "\n";
+    invalidate_cache();
+    func.schedule().async() = true;
+    func.schedule().async_depth() = depth;
+    return *this;
+}
+
 Stage Func::specialize(const Expr &c) {
     invalidate_cache();
     return Stage(func, func.definition(), 0).specialize(c);
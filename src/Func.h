@@ -2196,6 +2196,17 @@ public:
      */
     Func &async();
 
+    /** Produce this Func asynchronously, and let the producer run up
+     * to depth iterations of the consumer's loop ahead of it. This
+     * only has an effect when the storage is hoisted outside of the
+     * compute level (see Func::store_at) and gets folded
+     * automatically: the fold factor is made large enough to hold
+     * depth + 1 iterations' worth of the footprint, so the folded
+     * storage acts as a ring of buffers. E.g. async(1) double-buffers
+     * the producer. Explicit fold factors set with
+     * Func::fold_storage take precedence. */
+    Func &async(int depth);
+
     /** Allocate storage for this function within f's loop over
      * var. Scheduling storage is optional, and can be used to
      * separate the loop level at which storage occurs from the loop
@@ -1277,6 +1277,7 @@ Call::ConstString Call::buffer_init = "_halide_buffer_init";
 Call::ConstString Call::buffer_init_from_buffer = "_halide_buffer_init_from_buffer";
 Call::ConstString Call::buffer_crop = "_halide_buffer_crop";
 Call::ConstString Call::buffer_set_bounds = "_halide_buffer_set_bounds";
+Call::ConstString Call::buffer_array_get = "_halide_buffer_array_get";
 Call::ConstString Call::trace = "halide_trace_helper";
 
 }  // namespace Internal
@@ -576,6 +576,7 @@ struct Call : public ExprNode<Call> {
         buffer_init_from_buffer,
         buffer_crop,
         buffer_set_bounds,
+        buffer_array_get,
         trace;
 
     // If it's a call to another halide function, this call node holds
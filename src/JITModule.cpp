@@ -1,7 +1,9 @@
+#include <atomic>
 #include <mutex>
 #include <set>
 #include <stdint.h>
 #include <string>
+#include <thread>
 
 #ifdef _WIN32
 #ifdef _MSC_VER
@@ -143,6 +145,9 @@ public:
     }
 
     ~JITModuleContents() {
+        if (optimizer.joinable()) {
+            optimizer.join();
+        }
         if (execution_engine != nullptr) {
             execution_engine->runStaticConstructorsDestructors(true);
             delete execution_engine;
@@ -153,9 +158,21 @@ public:
     llvm::LLVMContext context;
     ExecutionEngine *execution_engine;
     std::vector<JITModule> dependencies;
+#if LLVM_VERSION >= 110
+    // Used instead of the execution engine for modules compiled with
+    // Target::LazyJIT.
+    std::unique_ptr<llvm::orc::LLLazyJIT> lazy_jit;
+#endif
     JITModule::Symbol entrypoint;
     JITModule::Symbol argv_entrypoint;
 
+    // For Target::TieredJIT, the same pipeline compiled with full
+    // optimization by the optimizer thread. Calls go to it once
+    // optimized_ready is set.
+    std::unique_ptr<JITModule> optimized;
+    std::atomic<bool> optimized_ready{false};
+    std::thread optimizer;
+
     std::string name;
 };
 
@@ -241,6 +258,145 @@ public:
     }
 };
 
+// The number of functions compiled by the lazy JITs of all modules.
+std::atomic<uint64_t> lazily_compiled_functions{0};
+
+#if LLVM_VERSION >= 110
+// An IR transform that counts the functions each lazy JIT compiles. The
+// compile-on-demand layer hands each function down separately as it is
+// first called. The type of the second argument differs between LLVM
+// versions.
+struct CountLazilyCompiledFunctions {
+    template<typename Responsibility>
+    Expected<orc::ThreadSafeModule> operator()(orc::ThreadSafeModule tsm, Responsibility &) const {
+        tsm.withModuleDo([](llvm::Module &m) {
+            for (const llvm::Function &f : m) {
+                if (!f.isDeclaration()) {
+                    lazily_compiled_functions++;
+                }
+            }
+        });
+        return std::move(tsm);
+    }
+};
+
+// Compile a pipeline with ORC's lazy JIT. Only a stub is made for
+// each function up front, and the function itself is compiled the
+// first time it is called, so code paths that never run (such as
+// unused specializations of parallel loop bodies) are never
+// compiled. Returns false, leaving the module untouched, if there is
+// no lazy JIT for this target.
+bool compile_module_lazily(JITModuleContents *contents, std::unique_ptr<llvm::Module> &m,
+                           const string &function_name, const Target &target,
+                           const std::vector<JITModule> &dependencies) {
+    string mcpu;
+    string mattrs;
+    llvm::TargetOptions options;
+    get_target_options(*m, options, mcpu, mattrs);
+
+    orc::JITTargetMachineBuilder target_machine_builder{llvm::Triple(m->getTargetTriple())};
+    target_machine_builder.setCPU(mcpu);
+    target_machine_builder.addFeatures({mattrs});
+    target_machine_builder.setOptions(options);
+    target_machine_builder.setCodeGenOptLevel(target.has_feature(Target::TieredJIT) ? CodeGenOpt::Less : CodeGenOpt::Aggressive);
+
+    auto jit = orc::LLLazyJITBuilder()
+                   .setJITTargetMachineBuilder(std::move(target_machine_builder))
+                   .create();
+    if (!jit) {
+        debug(1) << "Can't JIT compile " << function_name << " lazily: "
+                 << llvm::toString(jit.takeError()) << "\n";
+        return false;
+    }
+
+    // Resolve symbols in the dependencies first, as
+    // HalideJITMemoryManager does, and then in the process.
+    orc::JITDylib &dylib = (*jit)->getMainJITDylib();
+    orc::MangleAndInterner mangle((*jit)->getExecutionSession(), (*jit)->getDataLayout());
+    orc::SymbolMap symbols;
+    for (const JITModule &dep : dependencies) {
+        for (const auto &e : dep.exports()) {
+            symbols.try_emplace(mangle(e.first),
+                                JITEvaluatedSymbol(pointerToJITTargetAddress(e.second.address),
+                                                   JITSymbolFlags::Exported));
+        }
+    }
+    llvm::Error error = dylib.define(orc::absoluteSymbols(std::move(symbols)));
+    internal_assert(!error) << llvm::toString(std::move(error)) << "\n";
+
+    auto generator = orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+        (*jit)->getDataLayout().getGlobalPrefix());
+    internal_assert(generator) << llvm::toString(generator.takeError()) << "\n";
+    dylib.addGenerator(std::move(*generator));
+
+    (*jit)->getIRTransformLayer().setTransform(CountLazilyCompiledFunctions());
+
+    // ORC must own the context of the modules it compiles, so move the
+    // module to a new context by way of bitcode.
+    string bitcode;
+    {
+        raw_string_ostream out(bitcode);
+        WriteBitcodeToFile(*m, out);
+    }
+    std::unique_ptr<LLVMContext> context(new LLVMContext);
+    auto module = parseBitcodeFile(MemoryBufferRef(bitcode, m->getModuleIdentifier()), *context);
+    internal_assert(module) << llvm::toString(module.takeError()) << "\n";
+    error = (*jit)->addLazyIRModule(orc::ThreadSafeModule(std::move(*module),
+                                                          orc::ThreadSafeContext(std::move(context))));
+    internal_assert(!error) << llvm::toString(std::move(error)) << "\n";
+    m.reset();
+
+    debug(1) << "JIT compiling " << function_name << " lazily\n";
+
+    auto get_stub = [&](const string &name) {
+        auto symbol = (*jit)->lookup(name);
+        internal_assert(symbol) << "Compiling " << name << " failed: "
+                                << llvm::toString(symbol.takeError()) << "\n";
+        return JITModule::Symbol((void *)symbol->getAddress());
+    };
+
+    contents->entrypoint = get_stub(function_name);
+    contents->argv_entrypoint = get_stub(function_name + "_argv");
+    contents->exports[function_name] = contents->entrypoint;
+    contents->exports[function_name + "_argv"] = contents->argv_entrypoint;
+    contents->lazy_jit = std::move(*jit);
+    contents->dependencies = dependencies;
+    contents->name = function_name;
+    return true;
+}
+#endif
+
+// A copy of a module, to be compiled for a different target.
+Module retarget_module(const Module &m, const Target &target) {
+    Module result(m.name(), target);
+    for (const auto &b : m.buffers()) {
+        result.append(b);
+    }
+    for (const auto &f : m.functions()) {
+        result.append(f);
+    }
+    for (const auto &s : m.submodules()) {
+        result.append(s);
+    }
+    for (const auto &e : m.external_code()) {
+        result.append(e);
+    }
+    for (const auto &n : m.get_metadata_name_map()) {
+        result.remap_metadata_name(n.first, n.second);
+    }
+    result.set_any_strict_float(m.any_strict_float());
+    return result;
+}
+
+// The module that calls to a JITModule should go to: the optimized
+// one for Target::TieredJIT once it is ready, and otherwise itself.
+const JITModuleContents *current_tier(const JITModuleContents *contents) {
+    if (contents->optimized_ready.load(std::memory_order_acquire)) {
+        return contents->optimized->jit_module.get();
+    }
+    return contents;
+}
+
 }  // namespace
 
 JITModule::JITModule() {
@@ -257,6 +413,28 @@ JITModule::JITModule(const Module &m, const LoweredFunc &fn,
     compile_module(std::move(llvm_module), fn.name, m.target(), deps_with_runtime);
     // If -time-passes is in HL_LLVM_ARGS, this will print llvm passes time statstics otherwise its no-op.
     llvm::reportAndResetTimings();
+
+    if (m.target().has_feature(Target::TieredJIT)) {
+        // Compile again with full optimization in the background. The
+        // thread is joined when this module is destroyed, so it can
+        // safely refer to it.
+        Module optimized_module = retarget_module(m, m.target().without_feature(Target::TieredJIT));
+        JITModuleContents *contents = jit_module.get();
+        contents->optimizer = std::thread([contents, optimized_module, fn, dependencies]() {
+#ifdef WITH_EXCEPTIONS
+            try {
+#endif
+                contents->optimized.reset(new JITModule(optimized_module, fn, dependencies));
+                contents->optimized_ready.store(true, std::memory_order_release);
+                debug(1) << "Switched " << fn.name << " to its optimized version\n";
+#ifdef WITH_EXCEPTIONS
+            } catch (std::exception &e) {
+                // Keep using the quickly compiled version.
+                debug(1) << "Optimizing " << fn.name << " failed: " << e.what() << "\n";
+            }
+#endif
+        });
+    }
 }
 
 void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &function_name, const Target &target,
@@ -266,6 +444,15 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     // Ensure that LLVM is initialized
     CodeGen_LLVM::initialize_llvm();
 
+#if LLVM_VERSION >= 110
+    if (target.has_feature(Target::LazyJIT) &&
+        !function_name.empty() &&
+        requested_exports.empty() &&
+        compile_module_lazily(jit_module.get(), m, function_name, target, dependencies)) {
+        return;
+    }
+#endif
+
     // Make the execution engine
     debug(2) << "Creating new execution engine\n";
     debug(2) << "Target triple: " << m->getTargetTriple() << "\n";
@@ -286,7 +473,7 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     HalideJITMemoryManager *memory_manager = new HalideJITMemoryManager(dependencies);
     engine_builder.setMCJITMemoryManager(std::unique_ptr<RTDyldMemoryManager>(memory_manager));
 
-    engine_builder.setOptLevel(CodeGenOpt::Aggressive);
+    engine_builder.setOptLevel(target.has_feature(Target::TieredJIT) ? CodeGenOpt::Less : CodeGenOpt::Aggressive);
     if (!mcpu.empty()) {
         engine_builder.setMCPU(mcpu);
     }
@@ -406,19 +593,27 @@ JITModule::Symbol JITModule::find_symbol_by_name(const std::string &name) const
 }
 
 void *JITModule::main_function() const {
-    return jit_module->entrypoint.address;
+    return current_tier(jit_module.get())->entrypoint.address;
 }
 
 JITModule::Symbol JITModule::entrypoint_symbol() const {
-    return jit_module->entrypoint;
+    return current_tier(jit_module.get())->entrypoint;
 }
 
 int (*JITModule::argv_function() const)(const void **) {
-    return (int (*)(const void **))jit_module->argv_entrypoint.address;
+    return (int (*)(const void **))current_tier(jit_module.get())->argv_entrypoint.address;
 }
 
 JITModule::Symbol JITModule::argv_entrypoint_symbol() const {
-    return jit_module->argv_entrypoint;
+    return current_tier(jit_module.get())->argv_entrypoint;
+}
+
+bool JITModule::optimized_tier_ready() const {
+    return jit_module->optimized_ready.load(std::memory_order_acquire);
+}
+
+uint64_t JITModule::num_lazily_compiled_functions() {
+    return lazily_compiled_functions;
 }
 
 static bool module_already_in_graph(const JITModuleContents *start, const JITModuleContents *target, std::set<const JITModuleContents *> &already_seen) {
@@ -471,6 +666,11 @@ void JITModule::reuse_device_allocations(bool b) const {
 }
 
 bool JITModule::compiled() const {
+#if LLVM_VERSION >= 110
+    if (jit_module->lazy_jit) {
+        return true;
+    }
+#endif
     return jit_module->execution_engine != nullptr;
 }
 
@@ -612,8 +812,6 @@ void adjust_module_ref_count(void *arg, int32_t count) {
     }
 }
 
-std::mutex shared_runtimes_mutex;
-
 // The Halide runtime is broken up into pieces so that state can be
 // shared across JIT compilations that do not use the same target
 // options. At present, the split is into a MainShared module that
@@ -643,6 +841,20 @@ enum RuntimeKind {
     MaxRuntimeKind
 };
 
+// Guards the table of shared runtimes and the handlers above, and is
+// only held to look up or replace them. Compiling a shared runtime
+// takes a long time, and compilations of pipelines that only need
+// runtimes that already exist shouldn't wait for it.
+std::mutex shared_runtimes_mutex;
+
+// Held while compiling the shared runtime of each kind, so that it is
+// only compiled once. This only matters the first time a runtime is
+// needed: once they all exist, pipelines compiled on different threads
+// just take shared_runtimes_mutex briefly in JITSharedRuntime::get.
+// When both are needed, this must be acquired before
+// shared_runtimes_mutex.
+std::mutex shared_runtime_creation_mutexes[MaxRuntimeKind];
+
 JITModule &shared_runtimes(RuntimeKind k) {
     // We're already guarded by the shared_runtimes_mutex
     static JITModule *m = nullptr;
@@ -655,184 +867,219 @@ JITModule &shared_runtimes(RuntimeKind k) {
     return m[k];
 }
 
-JITModule &make_module(llvm::Module *for_module, Target target,
-                       RuntimeKind runtime_kind, const std::vector<JITModule> &deps,
-                       bool create) {
-
-    JITModule &runtime = shared_runtimes(runtime_kind);
-    if (!runtime.compiled() && create) {
-        // Ensure that JIT feature is set on target as it must be in
-        // order for the right runtime components to be added.
-        target.set_feature(Target::JIT);
-        // msan doesn't work for jit modules
-        target.set_feature(Target::MSAN, false);
-
-        Target one_gpu(target);
-        one_gpu.set_feature(Target::Debug, false);
-        one_gpu.set_feature(Target::OpenCL, false);
-        one_gpu.set_feature(Target::Metal, false);
-        one_gpu.set_feature(Target::CUDA, false);
-        one_gpu.set_feature(Target::HVX_64, false);
-        one_gpu.set_feature(Target::HVX_128, false);
-        one_gpu.set_feature(Target::OpenGL, false);
-        one_gpu.set_feature(Target::OpenGLCompute, false);
-        one_gpu.set_feature(Target::D3D12Compute, false);
-        string module_name;
-        switch (runtime_kind) {
-        case OpenCLDebug:
-            one_gpu.set_feature(Target::Debug);
-            one_gpu.set_feature(Target::OpenCL);
-            module_name = "debug_opencl";
-            break;
-        case OpenCL:
-            one_gpu.set_feature(Target::OpenCL);
-            module_name += "opencl";
-            break;
-        case MetalDebug:
-            one_gpu.set_feature(Target::Debug);
-            one_gpu.set_feature(Target::Metal);
-            load_metal();
-            module_name = "debug_metal";
-            break;
-        case Metal:
-            one_gpu.set_feature(Target::Metal);
-            module_name += "metal";
-            load_metal();
-            break;
-        case CUDADebug:
-            one_gpu.set_feature(Target::Debug);
-            one_gpu.set_feature(Target::CUDA);
-            module_name = "debug_cuda";
-            break;
-        case CUDA:
-            one_gpu.set_feature(Target::CUDA);
-            module_name += "cuda";
-            break;
-        case OpenGLDebug:
-            one_gpu.set_feature(Target::Debug);
-            one_gpu.set_feature(Target::OpenGL);
-            module_name = "debug_opengl";
-            load_opengl();
-            break;
-        case OpenGL:
-            one_gpu.set_feature(Target::OpenGL);
-            module_name += "opengl";
-            load_opengl();
-            break;
-        case OpenGLComputeDebug:
-            one_gpu.set_feature(Target::Debug);
-            one_gpu.set_feature(Target::OpenGLCompute);
-            module_name = "debug_openglcompute";
-            load_opengl();
-            break;
-        case OpenGLCompute:
-            one_gpu.set_feature(Target::OpenGLCompute);
-            module_name += "openglcompute";
-            load_opengl();
-            break;
-        case HexagonDebug:
-            one_gpu.set_feature(Target::Debug);
-            one_gpu.set_feature(Target::HVX_64);
-            module_name = "debug_hexagon";
-            break;
-        case Hexagon:
-            one_gpu.set_feature(Target::HVX_64);
-            module_name += "hexagon";
-            break;
-        case D3D12ComputeDebug:
-            one_gpu.set_feature(Target::Debug);
-            one_gpu.set_feature(Target::D3D12Compute);
-            module_name = "debug_d3d12compute";
-            break;
-        case D3D12Compute:
-            one_gpu.set_feature(Target::D3D12Compute);
-            module_name += "d3d12compute";
+// Compile a shared runtime. For the main shared runtime, the handlers
+// it calls by default are returned in internal_handlers; they're
+// published by the caller while holding shared_runtimes_mutex.
+JITModule make_module(llvm::Module *for_module, Target target,
+                      RuntimeKind runtime_kind, const std::vector<JITModule> &deps,
+                      JITHandlers *internal_handlers) {
+    JITModule runtime;
+    // Ensure that JIT feature is set on target as it must be in
+    // order for the right runtime components to be added.
+    target.set_feature(Target::JIT);
+    // msan doesn't work for jit modules
+    target.set_feature(Target::MSAN, false);
+    // Shared runtimes are compiled once, so always optimize them fully.
+    target.set_feature(Target::TieredJIT, false);
+
+    Target one_gpu(target);
+    one_gpu.set_feature(Target::Debug, false);
+    one_gpu.set_feature(Target::OpenCL, false);
+    one_gpu.set_feature(Target::Metal, false);
+    one_gpu.set_feature(Target::CUDA, false);
+    one_gpu.set_feature(Target::HVX_64, false);
+    one_gpu.set_feature(Target::HVX_128, false);
+    one_gpu.set_feature(Target::OpenGL, false);
+    one_gpu.set_feature(Target::OpenGLCompute, false);
+    one_gpu.set_feature(Target::D3D12Compute, false);
+    string module_name;
+    switch (runtime_kind) {
+    case OpenCLDebug:
+        one_gpu.set_feature(Target::Debug);
+        one_gpu.set_feature(Target::OpenCL);
+        module_name = "debug_opencl";
+        break;
+    case OpenCL:
+        one_gpu.set_feature(Target::OpenCL);
+        module_name += "opencl";
+        break;
+    case MetalDebug:
+        one_gpu.set_feature(Target::Debug);
+        one_gpu.set_feature(Target::Metal);
+        load_metal();
+        module_name = "debug_metal";
+        break;
+    case Metal:
+        one_gpu.set_feature(Target::Metal);
+        module_name += "metal";
+        load_metal();
+        break;
+    case CUDADebug:
+        one_gpu.set_feature(Target::Debug);
+        one_gpu.set_feature(Target::CUDA);
+        module_name = "debug_cuda";
+        break;
+    case CUDA:
+        one_gpu.set_feature(Target::CUDA);
+        module_name += "cuda";
+        break;
+    case OpenGLDebug:
+        one_gpu.set_feature(Target::Debug);
+        one_gpu.set_feature(Target::OpenGL);
+        module_name = "debug_opengl";
+        load_opengl();
+        break;
+    case OpenGL:
+        one_gpu.set_feature(Target::OpenGL);
+        module_name += "opengl";
+        load_opengl();
+        break;
+    case OpenGLComputeDebug:
+        one_gpu.set_feature(Target::Debug);
+        one_gpu.set_feature(Target::OpenGLCompute);
+        module_name = "debug_openglcompute";
+        load_opengl();
+        break;
+    case OpenGLCompute:
+        one_gpu.set_feature(Target::OpenGLCompute);
+        module_name += "openglcompute";
+        load_opengl();
+        break;
+    case HexagonDebug:
+        one_gpu.set_feature(Target::Debug);
+        one_gpu.set_feature(Target::HVX_64);
+        module_name = "debug_hexagon";
+        break;
+    case Hexagon:
+        one_gpu.set_feature(Target::HVX_64);
+        module_name += "hexagon";
+        break;
+    case D3D12ComputeDebug:
+        one_gpu.set_feature(Target::Debug);
+        one_gpu.set_feature(Target::D3D12Compute);
+        module_name = "debug_d3d12compute";
+        break;
+    case D3D12Compute:
+        one_gpu.set_feature(Target::D3D12Compute);
+        module_name += "d3d12compute";
 #if !defined(_WIN32)
-            internal_error << "JIT support for Direct3D 12 is only implemented on Windows 10 and above.\n";
+        internal_error << "JIT support for Direct3D 12 is only implemented on Windows 10 and above.\n";
 #endif
-            break;
-        default:
-            module_name = "shared runtime";
-            break;
-        }
+        break;
+    default:
+        module_name = "shared runtime";
+        break;
+    }
 
-        // This function is protected by a mutex so this is thread safe.
-        auto module =
-            get_initial_module_for_target(one_gpu,
-                                          &runtime.jit_module->context,
-                                          true,
-                                          runtime_kind != MainShared);
-        if (for_module) {
-            clone_target_options(*for_module, *module);
-        }
-        module->setModuleIdentifier(module_name);
+    auto module =
+        get_initial_module_for_target(one_gpu,
+                                      &runtime.jit_module->context,
+                                      true,
+                                      runtime_kind != MainShared);
+    if (for_module) {
+        clone_target_options(*for_module, *module);
+    }
+    module->setModuleIdentifier(module_name);
 
-        std::set<std::string> halide_exports_unique;
+    std::set<std::string> halide_exports_unique;
 
-        // Enumerate the functions.
-        for (auto &f : *module) {
-            // LLVM_Runtime_Linker has marked everything that should be exported as weak
-            if (f.hasWeakLinkage()) {
-                halide_exports_unique.insert(get_llvm_function_name(f));
-            }
+    // Enumerate the functions.
+    for (auto &f : *module) {
+        // LLVM_Runtime_Linker has marked everything that should be exported as weak
+        if (f.hasWeakLinkage()) {
+            halide_exports_unique.insert(get_llvm_function_name(f));
         }
+    }
 
-        std::vector<std::string> halide_exports(halide_exports_unique.begin(), halide_exports_unique.end());
+    std::vector<std::string> halide_exports(halide_exports_unique.begin(), halide_exports_unique.end());
 
-        runtime.compile_module(std::move(module), "", target, deps, halide_exports);
+    runtime.compile_module(std::move(module), "", target, deps, halide_exports);
 
-        if (runtime_kind == MainShared) {
-            runtime_internal_handlers.custom_print =
-                hook_function(runtime.exports(), "halide_set_custom_print", print_handler);
+    if (runtime_kind == MainShared) {
+        internal_handlers->custom_print =
+            hook_function(runtime.exports(), "halide_set_custom_print", print_handler);
 
-            runtime_internal_handlers.custom_malloc =
-                hook_function(runtime.exports(), "halide_set_custom_malloc", malloc_handler);
+        internal_handlers->custom_malloc =
+            hook_function(runtime.exports(), "halide_set_custom_malloc", malloc_handler);
 
-            runtime_internal_handlers.custom_free =
-                hook_function(runtime.exports(), "halide_set_custom_free", free_handler);
+        internal_handlers->custom_free =
+            hook_function(runtime.exports(), "halide_set_custom_free", free_handler);
 
-            runtime_internal_handlers.custom_do_task =
-                hook_function(runtime.exports(), "halide_set_custom_do_task", do_task_handler);
+        internal_handlers->custom_do_task =
+            hook_function(runtime.exports(), "halide_set_custom_do_task", do_task_handler);
 
-            runtime_internal_handlers.custom_do_par_for =
-                hook_function(runtime.exports(), "halide_set_custom_do_par_for", do_par_for_handler);
+        internal_handlers->custom_do_par_for =
+            hook_function(runtime.exports(), "halide_set_custom_do_par_for", do_par_for_handler);
 
-            runtime_internal_handlers.custom_error =
-                hook_function(runtime.exports(), "halide_set_error_handler", error_handler_handler);
+        internal_handlers->custom_error =
+            hook_function(runtime.exports(), "halide_set_error_handler", error_handler_handler);
 
-            runtime_internal_handlers.custom_trace =
-                hook_function(runtime.exports(), "halide_set_custom_trace", trace_handler);
+        internal_handlers->custom_trace =
+            hook_function(runtime.exports(), "halide_set_custom_trace", trace_handler);
 
-            runtime_internal_handlers.custom_get_symbol =
-                hook_function(shared_runtimes(MainShared).exports(), "halide_set_custom_get_symbol", get_symbol_handler);
+        internal_handlers->custom_get_symbol =
+            hook_function(runtime.exports(), "halide_set_custom_get_symbol", get_symbol_handler);
 
-            runtime_internal_handlers.custom_load_library =
-                hook_function(shared_runtimes(MainShared).exports(), "halide_set_custom_load_library", load_library_handler);
+        internal_handlers->custom_load_library =
+            hook_function(runtime.exports(), "halide_set_custom_load_library", load_library_handler);
 
-            runtime_internal_handlers.custom_get_library_symbol =
-                hook_function(shared_runtimes(MainShared).exports(), "halide_set_custom_get_library_symbol", get_library_symbol_handler);
+        internal_handlers->custom_get_library_symbol =
+            hook_function(runtime.exports(), "halide_set_custom_get_library_symbol", get_library_symbol_handler);
 
-            active_handlers = runtime_internal_handlers;
-            merge_handlers(active_handlers, default_handlers);
+        if (default_cache_size != 0) {
+            runtime.memoization_cache_set_size(default_cache_size);
+        }
 
-            if (default_cache_size != 0) {
-                runtime.memoization_cache_set_size(default_cache_size);
-            }
+        runtime.jit_module->name = "MainShared";
+    } else {
+        runtime.jit_module->name = "GPU";
+    }
+
+    uint64_t arg_addr =
+        runtime.jit_module->execution_engine->getGlobalValueAddress("halide_jit_module_argument");
+
+    internal_assert(arg_addr != 0);
+    *((void **)arg_addr) = runtime.jit_module.get();
+
+    uint64_t fun_addr = runtime.jit_module->execution_engine->getGlobalValueAddress("halide_jit_module_adjust_ref_count");
+    internal_assert(fun_addr != 0);
+    *(void (**)(void *arg, int32_t count))fun_addr = &adjust_module_ref_count;
+    return runtime;
+}
 
-            runtime.jit_module->name = "MainShared";
-        } else {
-            runtime.jit_module->name = "GPU";
+// Get the shared runtime of the given kind, compiling it first if it
+// doesn't exist yet and create is true. Returns an uncompiled
+// JITModule if there is no such runtime.
+JITModule get_shared_runtime(llvm::Module *for_module, const Target &target,
+                             RuntimeKind runtime_kind, const std::vector<JITModule> &deps,
+                             bool create) {
+    {
+        std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+        JITModule &runtime = shared_runtimes(runtime_kind);
+        if (runtime.compiled() || !create) {
+            return runtime;
         }
+    }
 
-        uint64_t arg_addr =
-            runtime.jit_module->execution_engine->getGlobalValueAddress("halide_jit_module_argument");
+    std::lock_guard<std::mutex> creation_lock(shared_runtime_creation_mutexes[runtime_kind]);
+    {
+        // Another thread may have made it while we were waiting.
+        std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+        JITModule &runtime = shared_runtimes(runtime_kind);
+        if (runtime.compiled()) {
+            return runtime;
+        }
+    }
 
-        internal_assert(arg_addr != 0);
-        *((void **)arg_addr) = runtime.jit_module.get();
+    JITHandlers internal_handlers;
+    JITModule runtime = make_module(for_module, target, runtime_kind, deps, &internal_handlers);
 
-        uint64_t fun_addr = runtime.jit_module->execution_engine->getGlobalValueAddress("halide_jit_module_adjust_ref_count");
-        internal_assert(fun_addr != 0);
-        *(void (**)(void *arg, int32_t count))fun_addr = &adjust_module_ref_count;
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    shared_runtimes(runtime_kind) = runtime;
+    if (runtime_kind == MainShared) {
+        runtime_internal_handlers = internal_handlers;
+        active_handlers = runtime_internal_handlers;
+        merge_handlers(active_handlers, default_handlers);
     }
     return runtime;
 }
@@ -848,11 +1095,9 @@ JITModule &make_module(llvm::Module *for_module, Target target,
  * JITSharedRuntime::release_all is called, the global state is reset
  * and any newly compiled Funcs will get a new runtime. */
 std::vector<JITModule> JITSharedRuntime::get(llvm::Module *for_module, const Target &target, bool create) {
-    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
-
     std::vector<JITModule> result;
 
-    JITModule m = make_module(for_module, target, MainShared, result, create);
+    JITModule m = get_shared_runtime(for_module, target, MainShared, result, create);
     if (m.compiled()) {
         result.push_back(m);
     }
@@ -861,49 +1106,49 @@ std::vector<JITModule> JITSharedRuntime::get(llvm::Module *for_module, const Tar
     std::vector<JITModule> gpu_modules;
     if (target.has_feature(Target::OpenCL)) {
         auto kind = target.has_feature(Target::Debug) ? OpenCLDebug : OpenCL;
-        JITModule m = make_module(for_module, target, kind, result, create);
+        JITModule m = get_shared_runtime(for_module, target, kind, result, create);
         if (m.compiled()) {
             result.push_back(m);
         }
     }
     if (target.has_feature(Target::Metal)) {
         auto kind = target.has_feature(Target::Debug) ? MetalDebug : Metal;
-        JITModule m = make_module(for_module, target, kind, result, create);
+        JITModule m = get_shared_runtime(for_module, target, kind, result, create);
         if (m.compiled()) {
             result.push_back(m);
         }
     }
     if (target.has_feature(Target::CUDA)) {
         auto kind = target.has_feature(Target::Debug) ? CUDADebug : CUDA;
-        JITModule m = make_module(for_module, target, kind, result, create);
+        JITModule m = get_shared_runtime(for_module, target, kind, result, create);
         if (m.compiled()) {
             result.push_back(m);
         }
     }
     if (target.has_feature(Target::OpenGL)) {
         auto kind = target.has_feature(Target::Debug) ? OpenGLDebug : OpenGL;
-        JITModule m = make_module(for_module, target, kind, result, create);
+        JITModule m = get_shared_runtime(for_module, target, kind, result, create);
         if (m.compiled()) {
             result.push_back(m);
         }
     }
     if (target.has_feature(Target::OpenGLCompute)) {
         auto kind = target.has_feature(Target::Debug) ? OpenGLComputeDebug : OpenGLCompute;
-        JITModule m = make_module(for_module, target, kind, result, create);
+        JITModule m = get_shared_runtime(for_module, target, kind, result, create);
         if (m.compiled()) {
             result.push_back(m);
         }
     }
     if (target.features_any_of({Target::HVX_64, Target::HVX_128})) {
         auto kind = target.has_feature(Target::Debug) ? HexagonDebug : Hexagon;
-        JITModule m = make_module(for_module, target, kind, result, create);
+        JITModule m = get_shared_runtime(for_module, target, kind, result, create);
         if (m.compiled()) {
             result.push_back(m);
         }
     }
     if (target.has_feature(Target::D3D12Compute)) {
         auto kind = target.has_feature(Target::Debug) ? D3D12ComputeDebug : D3D12Compute;
-        JITModule m = make_module(for_module, target, kind, result, create);
+        JITModule m = get_shared_runtime(for_module, target, kind, result, create);
         if (m.compiled()) {
             result.push_back(m);
         }
@@ -919,12 +1164,21 @@ std::vector<JITModule> JITSharedRuntime::get(llvm::Module *for_module, const Tar
 // calls another callback which is not overriden by the caller.)
 void JITSharedRuntime::init_jit_user_context(JITUserContext &jit_user_context,
                                              void *user_context, const JITHandlers &handlers) {
-    jit_user_context.handlers = active_handlers;
+    {
+        std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+        jit_user_context.handlers = active_handlers;
+    }
     jit_user_context.user_context = user_context;
     merge_handlers(jit_user_context.handlers, handlers);
 }
 
 void JITSharedRuntime::release_all() {
+    // Wait for any shared runtimes that are being compiled, so that
+    // they don't reappear after being released.
+    std::unique_lock<std::mutex> creation_locks[MaxRuntimeKind];
+    for (int i = 0; i < MaxRuntimeKind; i++) {
+        creation_locks[i] = std::unique_lock<std::mutex>(shared_runtime_creation_mutexes[i]);
+    }
     std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
 
     for (int i = MaxRuntimeKind; i > 0; i--) {
@@ -933,6 +1187,7 @@ void JITSharedRuntime::release_all() {
 }
 
 JITHandlers JITSharedRuntime::set_default_handlers(const JITHandlers &handlers) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
     JITHandlers result = default_handlers;
     default_handlers = handlers;
     active_handlers = runtime_internal_handlers;
@@ -941,6 +1196,8 @@ JITHandlers JITSharedRuntime::set_default_handlers(const JITHandlers &handlers)
 }
 
 void JITSharedRuntime::memoization_cache_set_size(int64_t size) {
+    // The main shared runtime reads default_cache_size when it is made.
+    std::lock_guard<std::mutex> creation_lock(shared_runtime_creation_mutexes[MainShared]);
     std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
 
     if (size != default_cache_size) {
@@ -98,6 +98,17 @@ struct JITModule {
     argv_wrapper argv_function() const;
     // @}
 
+    /** For a module compiled with Target::TieredJIT, whether the
+     * background compile with full optimization has finished, so that
+     * main_function, argv_function and the entrypoint symbols now
+     * return the optimized code. Always false for other modules. */
+    bool optimized_tier_ready() const;
+
+    /** The number of functions that modules compiled with
+     * Target::LazyJIT have compiled so far, over the whole
+     * process. Only meant for tests. */
+    static uint64_t num_lazily_compiled_functions();
+
     /** Add another JITModule to the dependency chain. Dependencies
      * are searched to resolve symbols not found in the current
      * compilation unit while JITting. */
@@ -27,6 +27,13 @@
 
 #include <llvm/ExecutionEngine/JITEventListener.h>
 #include <llvm/ExecutionEngine/MCJIT.h>
+#if LLVM_VERSION >= 110
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#endif
+#if LLVM_VERSION >= 120
+#include <llvm/ExecutionEngine/Orc/Mangling.h>
+#endif
 #include <llvm/ExecutionEngine/SectionMemoryManager.h>
 
 #include "llvm/Support/ErrorHandling.h"
@@ -1,5 +1,12 @@
 #include "LLVM_Runtime_Linker.h"
+#include "Debug.h"
 #include "LLVM_Headers.h"
+#include "Util.h"
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <mutex>
 
 namespace Halide {
 
@@ -25,11 +32,31 @@ std::unique_ptr<llvm::Module> parse_bitcode_file(llvm::StringRef buf, llvm::LLVM
     return result;
 }
 
+// All of the runtime bitcode built into libHalide. Only used to
+// fingerprint the runtime for the on-disk cache of initial modules.
+struct EmbeddedBitcode {
+    const unsigned char *data;
+    const int *length;
+};
+
+std::vector<EmbeddedBitcode> &embedded_bitcode() {
+    static std::vector<EmbeddedBitcode> all;
+    return all;
+}
+
+struct RegisterEmbeddedBitcode {
+    RegisterEmbeddedBitcode(const unsigned char *data, const int *length) {
+        embedded_bitcode().push_back({data, length});
+    }
+};
+
 }  // namespace
 
 #define DECLARE_INITMOD(mod)                                                              \
     extern "C" unsigned char halide_internal_initmod_##mod[];                             \
     extern "C" int halide_internal_initmod_##mod##_length;                                \
+    RegisterEmbeddedBitcode register_initmod_##mod(                                       \
+        halide_internal_initmod_##mod, &halide_internal_initmod_##mod##_length);          \
     std::unique_ptr<llvm::Module> get_initmod_##mod(llvm::LLVMContext *context) {         \
         llvm::StringRef sb = llvm::StringRef((const char *)halide_internal_initmod_##mod, \
                                              halide_internal_initmod_##mod##_length);     \
@@ -144,6 +171,7 @@ DECLARE_CPP_INITMOD(qurt_threads)
 DECLARE_CPP_INITMOD(qurt_threads_tsan)
 DECLARE_CPP_INITMOD(qurt_yield)
 DECLARE_CPP_INITMOD(runtime_api)
+DECLARE_CPP_INITMOD(scratch_pool)
 DECLARE_CPP_INITMOD(ssp)
 DECLARE_CPP_INITMOD(to_string)
 DECLARE_CPP_INITMOD(trace_helper)
@@ -765,8 +793,10 @@ std::unique_ptr<llvm::Module> link_with_wasm_jit_runtime(llvm::LLVMContext *c, c
     return std::move(modules[0]);
 }
 
-/** Create an llvm module containing the support code for a given target. */
-std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
+namespace {
+
+/** Parse and link the runtime modules needed for a given target. */
+std::unique_ptr<llvm::Module> link_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
     enum InitialModuleType {
         ModuleAOT,
         ModuleAOTNoRuntime,
@@ -979,6 +1009,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             }
 
             modules.push_back(get_initmod_allocation_cache(c, bits_64, debug));
+            modules.push_back(get_initmod_scratch_pool(c, bits_64, debug));
             modules.push_back(get_initmod_device_interface(c, bits_64, debug));
             modules.push_back(get_initmod_metadata(c, bits_64, debug));
             modules.push_back(get_initmod_float16_t(c, bits_64, debug));
@@ -1198,6 +1229,131 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
     return std::move(modules[0]);
 }
 
+uint64_t fnv1a_hash(uint64_t h, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// A hash of all of the runtime bitcode built into libHalide and the
+// LLVM version, so that a cache on disk written by a different build
+// of Halide is never used.
+uint64_t runtime_fingerprint() {
+    static const uint64_t fingerprint = []() {
+        uint64_t h = 0xcbf29ce484222325ULL;
+        const int llvm_version = LLVM_VERSION;
+        h = fnv1a_hash(h, &llvm_version, sizeof(llvm_version));
+        for (const EmbeddedBitcode &b : embedded_bitcode()) {
+            h = fnv1a_hash(h, b.length, sizeof(*b.length));
+            h = fnv1a_hash(h, b.data, *b.length);
+        }
+        return h;
+    }();
+    return fingerprint;
+}
+
+// The path of the on-disk copy of an initial module, or the empty
+// string if HL_RUNTIME_CACHE_DIR is not set.
+std::string initial_module_cache_path(const std::string &key) {
+    std::string dir = get_env_variable("HL_RUNTIME_CACHE_DIR");
+    if (dir.empty()) {
+        return "";
+    }
+    uint64_t h = fnv1a_hash(runtime_fingerprint(), key.data(), key.size());
+    char name[64];
+    snprintf(name, sizeof(name), "halide_runtime_%016llx.bc", (unsigned long long)h);
+    return dir + "/" + name;
+}
+
+bool read_initial_module_from_disk(const std::string &path, llvm::LLVMContext *c, std::string *bitcode) {
+    std::ifstream f(path, std::ios::in | std::ios::binary);
+    if (!f.is_open()) {
+        return false;
+    }
+    std::string data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    // Make sure the file is complete and well-formed before trusting it.
+    auto m = llvm::parseBitcodeFile(llvm::MemoryBufferRef(data, path), *c);
+    if (!m) {
+        llvm::consumeError(m.takeError());
+        debug(1) << "Ignoring unreadable cached runtime " << path << "\n";
+        return false;
+    }
+    *bitcode = std::move(data);
+    return true;
+}
+
+void write_initial_module_to_disk(const std::string &path, const std::string &bitcode) {
+    // Write to a temporary file and rename it into place, so that
+    // concurrent compilers never see a partial file.
+    int fd;
+    llvm::SmallString<128> temp_path;
+    if (llvm::sys::fs::createUniqueFile(path + "-%%%%%%.tmp", fd, temp_path)) {
+        debug(1) << "Could not create a temporary file to cache the runtime in " << path << "\n";
+        return;
+    }
+    {
+        llvm::raw_fd_ostream out(fd, /* shouldClose */ true);
+        out << bitcode;
+    }
+    if (llvm::sys::fs::rename(temp_path, path)) {
+        llvm::sys::fs::remove(temp_path);
+        debug(1) << "Could not cache the runtime in " << path << "\n";
+    }
+}
+
+}  // namespace
+
+/** Create an llvm module containing the support code for a given
+ * target. Parsing and linking the runtime is a large part of the
+ * cost of compiling a small pipeline, so the linked module is kept as
+ * bitcode for each distinct request, and parsed into the given
+ * context on later calls. If the environment variable
+ * HL_RUNTIME_CACHE_DIR names a directory, the bitcode is also shared
+ * across processes through that directory. */
+std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
+    static std::mutex cache_mutex;
+    static std::map<std::string, std::string> cache;
+
+    const std::string key = t.to_string() +
+                            (for_shared_jit_runtime ? "/shared_jit_runtime" : "") +
+                            (just_gpu ? "/just_gpu" : "");
+
+    const std::string *bitcode = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        auto it = cache.find(key);
+        if (it != cache.end()) {
+            bitcode = &it->second;
+        }
+    }
+
+    if (!bitcode) {
+        std::unique_ptr<llvm::Module> module;
+        std::string data;
+        const std::string path = initial_module_cache_path(key);
+        if (path.empty() || !read_initial_module_from_disk(path, c, &data)) {
+            module = link_initial_module_for_target(t, c, for_shared_jit_runtime, just_gpu);
+            llvm::raw_string_ostream out(data);
+            llvm::WriteBitcodeToFile(*module, out);
+            out.flush();
+            if (!path.empty()) {
+                write_initial_module_to_disk(path, data);
+            }
+        }
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        // Entries are never removed or replaced, so the pointer
+        // remains valid once the lock is released.
+        bitcode = &cache.emplace(key, std::move(data)).first->second;
+        if (module) {
+            return module;
+        }
+    }
+
+    return parse_bitcode_file(*bitcode, c, "halide_runtime");
+}
+
 #ifdef WITH_NVPTX
 std::unique_ptr<llvm::Module> get_initial_module_for_ptx_device(Target target, llvm::LLVMContext *c) {
     std::vector<std::unique_ptr<llvm::Module>> modules;
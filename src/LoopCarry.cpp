@@ -192,6 +192,17 @@ class LoopCarryOverLoop : public IRMutator {
     const Scope<> &in_consume;
 
     int max_carried_values;
+    int native_vector_bits;
+
+    // The number of carried value slots a value of the given type
+    // takes up.
+    size_t value_cost(Type t) const {
+        if (native_vector_bits <= 0) {
+            return 1;
+        }
+        int bits = t.bits() * t.lanes();
+        return (size_t)std::max(1, (bits + native_vector_bits - 1) / native_vector_bits);
+    }
 
     using IRMutator::visit;
 
@@ -354,19 +365,22 @@ class LoopCarryOverLoop : public IRMutator {
 
         // Only keep the top N carried values. Otherwise we'll just
         // spray stack spills everywhere. This is ugly, because we're
-        // relying on a heuristic.
+        // relying on a heuristic. Wide vectors that span several
+        // registers count for more than one value.
         vector<vector<int>> trimmed;
         size_t sz = 0;
         for (const vector<int> &c : chains) {
-            if (sz + c.size() > (size_t)max_carried_values) {
-                if (sz < (size_t)max_carried_values - 1) {
+            size_t cost = value_cost(loads[c.front()][0]->type);
+            if (sz + c.size() * cost > (size_t)max_carried_values) {
+                size_t fits = ((size_t)max_carried_values - sz) / cost;
+                if (fits > 1) {
                     // Take a partial chain
-                    trimmed.emplace_back(c.begin(), c.begin() + max_carried_values - sz);
+                    trimmed.emplace_back(c.begin(), c.begin() + fits);
                 }
                 break;
             }
             trimmed.push_back(c);
-            sz += c.size();
+            sz += c.size() * cost;
         }
         chains.swap(trimmed);
 
@@ -485,8 +499,8 @@ class LoopCarryOverLoop : public IRMutator {
     }
 
 public:
-    LoopCarryOverLoop(const string &var, const Scope<> &s, int max_carried_values)
-        : in_consume(s), max_carried_values(max_carried_values) {
+    LoopCarryOverLoop(const string &var, const Scope<> &s, int max_carried_values, int native_vector_bits)
+        : in_consume(s), max_carried_values(max_carried_values), native_vector_bits(native_vector_bits) {
         linear.push(var, 1);
     }
 
@@ -504,6 +518,7 @@ class LoopCarry : public IRMutator {
     using IRMutator::visit;
 
     int max_carried_values;
+    int native_vector_bits;
     Scope<> in_consume;
 
     Stmt visit(const ProducerConsumer *op) override {
@@ -517,10 +532,14 @@ class LoopCarry : public IRMutator {
     }
 
     Stmt visit(const For *op) override {
-        if (op->for_type == ForType::Serial && !is_one(op->extent)) {
+        if (is_gpu_loop(op)) {
+            // Kernel bodies have their own register allocation
+            // constraints and can't hold stack allocations.
+            return op;
+        } else if (op->for_type == ForType::Serial && !is_one(op->extent)) {
             Stmt stmt;
             Stmt body = mutate(op->body);
-            LoopCarryOverLoop carry(op->name, in_consume, max_carried_values);
+            LoopCarryOverLoop carry(op->name, in_consume, max_carried_values, native_vector_bits);
             body = carry.mutate(body);
             if (body.same_as(op->body)) {
                 stmt = op;
@@ -542,18 +561,41 @@ class LoopCarry : public IRMutator {
         }
     }
 
+    bool is_gpu_loop(const For *op) const {
+        return (op->for_type == ForType::GPUBlock ||
+                op->for_type == ForType::GPUThread ||
+                op->for_type == ForType::GPULane ||
+                (op->device_api != DeviceAPI::None &&
+                 op->device_api != DeviceAPI::Host &&
+                 op->device_api != DeviceAPI::Hexagon));
+    }
+
 public:
-    LoopCarry(int max_carried_values)
-        : max_carried_values(max_carried_values) {
+    LoopCarry(int max_carried_values, int native_vector_bits)
+        : max_carried_values(max_carried_values), native_vector_bits(native_vector_bits) {
     }
 };
 
 }  // namespace
 
-Stmt loop_carry(Stmt s, int max_carried_values) {
-    s = LoopCarry(max_carried_values).mutate(s);
+Stmt loop_carry(Stmt s, int max_carried_values, int native_vector_bits) {
+    s = LoopCarry(max_carried_values, native_vector_bits).mutate(s);
     return s;
 }
 
+Stmt loop_carry(Stmt s, const Target &t) {
+    // Leave about half of the vector register file for the
+    // computation that consumes the carried values.
+    int vector_registers = 16;
+    if ((t.arch == Target::X86 &&
+         t.features_any_of({Target::AVX512, Target::AVX512_KNL,
+                            Target::AVX512_Skylake, Target::AVX512_Cannonlake})) ||
+        (t.arch == Target::ARM && t.bits == 64)) {
+        vector_registers = 32;
+    }
+    int native_vector_bits = t.natural_vector_size(UInt(8)) * 8;
+    return loop_carry(std::move(s), vector_registers / 2, native_vector_bits);
+}
+
 }  // namespace Internal
 }  // namespace Halide
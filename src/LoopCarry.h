@@ -2,6 +2,7 @@
 #define HALIDE_LOOP_CARRY_H
 
 #include "Expr.h"
+#include "Target.h"
 
 namespace Halide {
 namespace Internal {
@@ -10,9 +11,18 @@ namespace Internal {
  * induction variables instead of redoing the load. If the loads are
  * predicated, the predicates need to match. Can be an optimization or
  * pessimization depending on how good the L1 cache is on the architecture
- * and how many memory issue slots there are. Currently only intended
- * for Hexagon. */
-Stmt loop_carry(Stmt, int max_carried_values = 8);
+ * and how many memory issue slots there are. If the loop body is an
+ * unrolled outer dimension jammed into a sliding serial loop (e.g. a
+ * vertical stencil unrolled over several rows), only the rows that are
+ * new on each iteration get loaded. If native_vector_bits is non-zero,
+ * max_carried_values is a budget of vector registers of that size
+ * rather than a count of values. */
+Stmt loop_carry(Stmt, int max_carried_values = 8, int native_vector_bits = 0);
+
+/** Carry loads across loop iterations with a register budget suitable
+ * for the given CPU target. Used when the target has the LoopCarry
+ * feature. Loops that run on a GPU are left alone. */
+Stmt loop_carry(Stmt, const Target &t);
 
 }  // namespace Internal
 }  // namespace Halide
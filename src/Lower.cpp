@@ -39,7 +39,9 @@
 #include "LoopCarry.h"
 #include "LowerWarpShuffles.h"
 #include "Memoization.h"
+#include "ParallelBatch.h"
 #include "PartitionLoops.h"
+#include "PoolParallelAllocations.h"
 #include "Prefetch.h"
 #include "Profiling.h"
 #include "PurifyIndexMath.h"
@@ -126,6 +128,11 @@ Module lower(const vector<Function> &output_funcs,
     vector<vector<string>> fused_groups;
     std::tie(order, fused_groups) = realization_order(outputs, env);
 
+    if (t.has_feature(Target::SpecializeOnEstimates)) {
+        debug(1) << "Specializing on estimated buffer shapes...\n";
+        specialize_on_estimates(outputs, env);
+    }
+
     // Try to simplify the RHS/LHS of a function definition by propagating its
     // specializations' conditions
     simplify_specializations(env);
@@ -376,6 +383,17 @@ Module lower(const vector<Function> &output_funcs,
     debug(2) << "Lowering after hoisting loop invariant if statements:\n"
              << s << "\n\n";
 
+    // Hexagon does this itself during codegen.
+    if (t.has_feature(Target::LoopCarry) &&
+        t.arch != Target::Hexagon &&
+        !t.features_any_of({Target::HVX_64, Target::HVX_128})) {
+        debug(1) << "Carrying values across loop iterations...\n";
+        s = loop_carry(s, t);
+        s = simplify(s);
+        debug(2) << "Lowering after carrying values across loop iterations:\n"
+                 << s << "\n\n";
+    }
+
     debug(1) << "Injecting early frees...\n";
     s = inject_early_frees(s);
     debug(2) << "Lowering after injecting early frees:\n"
@@ -405,6 +423,14 @@ Module lower(const vector<Function> &output_funcs,
                  << s << "\n\n";
     }
 
+    if (t.has_feature(Target::PoolParallelAllocations) &&
+        t.arch != Target::Hexagon) {
+        debug(1) << "Pooling allocations in parallel loops...\n";
+        s = pool_parallel_allocations(s);
+        debug(2) << "Lowering after pooling allocations in parallel loops:\n"
+                 << s << "\n\n";
+    }
+
     if (t.has_feature(Target::CUDA)) {
         debug(1) << "Injecting warp shuffles...\n";
         s = lower_warp_shuffles(s);
@@ -539,6 +565,11 @@ Module lower(const vector<Function> &output_funcs,
 
     result_module.append(main_func);
 
+    if (t.has_feature(Target::ParallelBatch)) {
+        debug(1) << "Adding parallel batch dispatcher...\n";
+        result_module.append(parallel_batch_dispatcher(main_func, t));
+    }
+
     auto *logger = get_compiler_logger();
     if (logger) {
         auto time_end = std::chrono::high_resolution_clock::now();
@@ -15,6 +15,7 @@
 #include "LLVM_Headers.h"
 #include "LLVM_Output.h"
 #include "LLVM_Runtime_Linker.h"
+#include "ParallelBatch.h"
 #include "Pipeline.h"
 #include "PythonExtensionGen.h"
 #include "StmtToHtml.h"
@@ -811,7 +812,7 @@ void compile_multitarget(const std::string &fn_name,
             user_error << "All Targets must have matching arch-bits-os for compile_multitarget.\n";
         }
         // Some features must match across all targets.
-        static const std::array<Target::Feature, 9> must_match_features = {{
+        static const std::array<Target::Feature, 10> must_match_features = {{
             Target::ASAN,
             Target::CPlusPlusMangling,
             Target::Debug,
@@ -819,6 +820,7 @@ void compile_multitarget(const std::string &fn_name,
             Target::Matlab,
             Target::MSAN,
             Target::NoRuntime,
+            Target::ParallelBatch,
             Target::TSAN,
             Target::UserContext,
         }};
@@ -834,10 +836,13 @@ void compile_multitarget(const std::string &fn_name,
         std::string sub_fn_name = needs_wrapper ? (fn_name + suffix) : fn_name;
 
         // We always produce the runtime separately, so add NoRuntime explicitly.
-        // Matlab should be added to the wrapper pipeline below, instead of each sub-pipeline.
+        // Matlab and the parallel batch dispatcher should be added to the wrapper pipeline below,
+        // instead of each sub-pipeline.
         Target sub_fn_target = target.with_feature(Target::NoRuntime);
         if (needs_wrapper) {
-            sub_fn_target = sub_fn_target.without_feature(Target::Matlab);
+            sub_fn_target = sub_fn_target
+                                .without_feature(Target::Matlab)
+                                .without_feature(Target::ParallelBatch);
         }
 
         {
@@ -937,7 +942,13 @@ void compile_multitarget(const std::string &fn_name,
         }
 
         Module wrapper_module(fn_name, wrapper_target);
-        wrapper_module.append(LoweredFunc(fn_name, base_target_args, wrapper_body, LinkageType::ExternalPlusMetadata));
+        LoweredFunc wrapper_func(fn_name, base_target_args, wrapper_body, LinkageType::ExternalPlusMetadata);
+        wrapper_module.append(wrapper_func);
+        if (base_target.has_feature(Target::ParallelBatch)) {
+            // The batch dispatcher calls the wrapper, so each item
+            // dispatches to the best sub-target.
+            wrapper_module.append(parallel_batch_dispatcher(wrapper_func, wrapper_target));
+        }
 
         std::map<Output, std::string> wrapper_out = {{Output::object,
                                                       temp_obj_dir.add_temp_object_file(output_files.at(Output::static_library), "_wrapper", base_target, /* in_front*/ true)}};
@@ -947,7 +958,11 @@ void compile_multitarget(const std::string &fn_name,
 
     if (contains(output_files, Output::c_header)) {
         Module header_module(fn_name, base_target);
-        header_module.append(LoweredFunc(fn_name, base_target_args, {}, LinkageType::ExternalPlusMetadata));
+        LoweredFunc header_func(fn_name, base_target_args, {}, LinkageType::ExternalPlusMetadata);
+        header_module.append(header_func);
+        if (base_target.has_feature(Target::ParallelBatch)) {
+            header_module.append(parallel_batch_dispatcher(header_func, base_target));
+        }
         std::map<Output, std::string> header_out = {{Output::c_header, output_files.at(Output::c_header)}};
         debug(1) << "compile_multitarget: c_header " << header_out.at(Output::c_header) << "\n";
         header_module.compile(header_out);
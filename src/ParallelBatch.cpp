@@ -0,0 +1,68 @@
+#include "ParallelBatch.h"
+#include "IR.h"
+#include "IROperator.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+using std::vector;
+
+LoweredFunc parallel_batch_dispatcher(const LoweredFunc &func, const Target &t) {
+    const string batch_size_name = "batch_size";
+    const string loop_name = unique_name('b');
+    Expr batch_index = Variable::make(Int(32), loop_name);
+
+    vector<LoweredArgument> batch_args;
+    vector<Expr> call_args;
+    size_t batch_size_position = 0;
+    for (const LoweredArgument &arg : func.args) {
+        user_assert(arg.name != batch_size_name)
+            << "Pipeline " << func.name << " has an argument named " << batch_size_name
+            << ", which clashes with the batch size argument of its parallel batch dispatcher.\n";
+        if (arg.is_buffer()) {
+            Type array_type = type_of<halide_buffer_t **>();
+            batch_args.emplace_back(arg.name, Argument::InputScalar, array_type, 0, ArgumentEstimates{});
+            call_args.push_back(Call::make(type_of<halide_buffer_t *>(), Call::buffer_array_get,
+                                           {Variable::make(array_type, arg.name), batch_index},
+                                           Call::Extern));
+        } else {
+            if (arg.name == "__user_context") {
+                // The user context stays the first argument.
+                batch_size_position = batch_args.size() + 1;
+            }
+            batch_args.push_back(arg);
+            call_args.push_back(Variable::make(arg.type, arg.name));
+        }
+    }
+    batch_args.insert(batch_args.begin() + batch_size_position,
+                      LoweredArgument(batch_size_name, Argument::InputScalar, Int(32), 0, ArgumentEstimates{}));
+
+    // Call the pipeline itself, so each item runs its own checks and
+    // bounds queries. The cost of waking up the thread pool is paid
+    // once for the whole batch, and small items that don't fill the
+    // machine on their own run concurrently.
+    bool c_plus_plus = (func.name_mangling == NameMangling::CPlusPlus ||
+                        (func.name_mangling == NameMangling::Default &&
+                         t.has_feature(Target::CPlusPlusMangling)));
+    string callee = func.name;
+    if (!c_plus_plus) {
+        // Namespaces only affect C++ mangled names.
+        vector<string> namespaces;
+        callee = extract_namespaces(func.name, namespaces);
+    }
+    Call::CallType call_type = c_plus_plus ? Call::ExternCPlusPlus : Call::Extern;
+    Expr result = Call::make(Int(32), callee, call_args, call_type);
+    string result_name = unique_name(func.name + "_result");
+    Expr result_var = Variable::make(Int(32), result_name);
+    Stmt body = AssertStmt::make(result_var == 0, result_var);
+    body = LetStmt::make(result_name, result, body);
+    body = For::make(loop_name, 0, Variable::make(Int(32), batch_size_name),
+                     ForType::Parallel, DeviceAPI::Host, body);
+
+    return LoweredFunc(func.name + "_batch", batch_args, body, LinkageType::External, func.name_mangling);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,41 @@
+#ifndef HALIDE_INTERNAL_PARALLEL_BATCH_H
+#define HALIDE_INTERNAL_PARALLEL_BATCH_H
+
+/** \file
+ *
+ * Defines the extra function emitted when Target::ParallelBatch is
+ * on, which dispatches a pipeline over many sets of buffers from a
+ * single parallel loop.
+ */
+
+#include "Module.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Make a LoweredFunc named func.name + "_batch" that calls func once
+ * for each of batch_size sets of buffers, from a single parallel
+ * loop. Each buffer argument of func becomes an array of batch_size
+ * halide_buffer_t pointers, which need not all have the same
+ * shape. The scalar arguments are shared by every call. For a
+ * pipeline "f" with arguments (float k, halide_buffer_t *in,
+ * halide_buffer_t *out), the signature is:
+ *
+ * int f_batch(int batch_size, float k, halide_buffer_t **in, halide_buffer_t **out);
+ *
+ * With Target::UserContext, the user context comes first and is
+ * passed through to every call.
+ *
+ * This is only a dispatcher: each call is an ordinary call to func,
+ * so every item still validates its own buffers and answers its own
+ * bounds queries. What is shared is the parallel loop, so that many
+ * small items run concurrently and the thread pool is woken once.
+ *
+ * Returns the first nonzero error code of any of the calls, unless
+ * Target::NoAsserts is set. */
+LoweredFunc parallel_batch_dispatcher(const LoweredFunc &func, const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -0,0 +1,103 @@
+#include "PoolParallelAllocations.h"
+#include "CodeGen_Internal.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Simplify.h"
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+bool is_host_loop(const For *op) {
+    return op->device_api == DeviceAPI::None || op->device_api == DeviceAPI::Host;
+}
+
+// Allocate the temporaries in a parallel loop body from a scratch pool.
+class AllocateFromPool : public IRMutator {
+    using IRMutator::visit;
+
+    const std::string &pool;
+
+    Stmt visit(const Allocate *op) override {
+        if (op->new_expr.defined() ||
+            !op->free_function.empty() ||
+            op->extents.empty() ||
+            (op->memory_type != MemoryType::Auto &&
+             op->memory_type != MemoryType::Heap &&
+             op->memory_type != MemoryType::Stack)) {
+            return IRMutator::visit(op);
+        }
+
+        int32_t constant_size = Allocate::constant_allocation_size(op->extents, op->name);
+        if (constant_size > 0 &&
+            op->memory_type != MemoryType::Heap &&
+            can_allocation_fit_on_stack((int64_t)constant_size * op->type.bytes())) {
+            // This is going on the real stack anyway.
+            return IRMutator::visit(op);
+        }
+
+        // Compute the same size in bytes the heap allocation would
+        // have had, including the padding for reading one scalar past
+        // the end.
+        Expr size = make_const(UInt(64), op->type.bytes());
+        for (const Expr &e : op->extents) {
+            size *= cast<uint64_t>(e);
+        }
+        size += op->type.bytes();
+        size = simplify(select(op->condition, size, make_zero(UInt(64))));
+
+        Expr new_expr = Call::make(Handle(), "halide_scratch_pool_alloc",
+                                   {Variable::make(Handle(), pool), size}, Call::Extern);
+
+        Stmt body = mutate(op->body);
+        return Allocate::make(op->name, op->type, MemoryType::Heap, op->extents,
+                              op->condition, body, new_expr, "halide_scratch_pool_free");
+    }
+
+    Stmt visit(const For *op) override {
+        if (!is_host_loop(op)) {
+            return op;
+        }
+        return IRMutator::visit(op);
+    }
+
+public:
+    AllocateFromPool(const std::string &pool)
+        : pool(pool) {
+    }
+};
+
+class PoolParallelAllocations : public IRMutator {
+    using IRMutator::visit;
+
+    Stmt visit(const For *op) override {
+        if (!is_host_loop(op)) {
+            return op;
+        }
+        if (op->for_type != ForType::Parallel) {
+            return IRMutator::visit(op);
+        }
+
+        // Nested parallel loops share the pool of the outermost one.
+        std::string pool = unique_name("scratch_pool");
+        Stmt body = AllocateFromPool(pool).mutate(op->body);
+        if (body.same_as(op->body)) {
+            return op;
+        }
+
+        Stmt loop = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+        Expr new_expr = Call::make(Handle(), "halide_scratch_pool_create", {}, Call::Extern);
+        return Allocate::make(pool, UInt(8), MemoryType::Heap, {}, const_true(),
+                              loop, new_expr, "halide_scratch_pool_destroy");
+    }
+};
+
+}  // namespace
+
+Stmt pool_parallel_allocations(const Stmt &s) {
+    return PoolParallelAllocations().mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,26 @@
+#ifndef HALIDE_POOL_PARALLEL_ALLOCATIONS_H
+#define HALIDE_POOL_PARALLEL_ALLOCATIONS_H
+
+/** \file
+ * Defines the lowering pass that makes the temporaries of parallel
+ * loops reuse memory across iterations.
+ */
+
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Heap and pseudostack allocations inside the body of a parallel
+ * loop are otherwise allocated and freed once per iteration. Wrap
+ * each outermost parallel loop on the host in a scratch pool (see
+ * halide_scratch_pool_create), and allocate such temporaries from the
+ * pool instead, so that each worker thread reuses the same blocks
+ * from one iteration to the next. Allocations small enough to live
+ * on the stack are left alone. */
+Stmt pool_parallel_allocations(const Stmt &s);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
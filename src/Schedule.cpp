@@ -220,10 +220,11 @@ struct FuncScheduleContents {
     std::map<std::string, Internal::FunctionPtr> wrappers;
     MemoryType memory_type;
     bool memoized, async;
+    int async_depth;
 
     FuncScheduleContents()
         : store_level(LoopLevel::inlined()), compute_level(LoopLevel::inlined()),
-          memory_type(MemoryType::Auto), memoized(false), async(false){};
+          memory_type(MemoryType::Auto), memoized(false), async(false), async_depth(0){};
 
     // Pass an IRMutator through to all Exprs referenced in the FuncScheduleContents
     void mutate(IRMutator *mutator) {
@@ -340,6 +341,7 @@ FuncSchedule FuncSchedule::deep_copy(
     copy.contents->memory_type = contents->memory_type;
     copy.contents->memoized = contents->memoized;
     copy.contents->async = contents->async;
+    copy.contents->async_depth = contents->async_depth;
 
     // Deep-copy wrapper functions.
     for (const auto &iter : contents->wrappers) {
@@ -375,6 +377,14 @@ bool FuncSchedule::async() const {
     return contents->async;
 }
 
+int &FuncSchedule::async_depth() {
+    return contents->async_depth;
+}
+
+int FuncSchedule::async_depth() const {
+    return contents->async_depth;
+}
+
 std::vector<StorageDim> &FuncSchedule::storage_dims() {
     return contents->storage_dims;
 }
@@ -535,6 +535,15 @@ public:
     bool &async();
     bool async() const;
 
+    /** The number of additional slices of folded storage an
+     * asynchronous producer may fill ahead of its consumer. Zero
+     * means the fold factor is just large enough to hold the
+     * footprint of one iteration of the consumer. */
+    // @{
+    int &async_depth();
+    int async_depth() const;
+    // @}
+
     /** The list and order of dimensions used to store this
      * function. The first dimension in the vector corresponds to the
      * innermost dimension for storage (i.e. which dimension is
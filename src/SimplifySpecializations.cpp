@@ -4,9 +4,12 @@
 #include "IREquality.h"
 #include "IRMutator.h"
 #include "IROperator.h"
+#include "IRVisitor.h"
+#include "Parameter.h"
 #include "Simplify.h"
 #include "Substitute.h"
 
+#include <limits>
 #include <set>
 #include <utility>
 
@@ -154,8 +157,140 @@ vector<Definition> propagate_specialization_in_definition(Definition &def, const
     return result;
 }
 
+// Find the input buffers referred to by a Function.
+class FindBufferParams : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Call *op) override {
+        IRGraphVisitor::visit(op);
+        if (op->param.defined() && op->param.is_buffer() &&
+            !names.count(op->param.name())) {
+            names.insert(op->param.name());
+            params.push_back(op->param);
+        }
+    }
+
+    std::set<string> names;
+
+public:
+    vector<Parameter> params;
+};
+
+Expr buffer_field(const Parameter &p, const string &field, int d) {
+    return Variable::make(Int(32), p.name() + "." + field + "." + std::to_string(d), p);
+}
+
+// The condition under which a buffer has the given constant mins and
+// extents and a dense layout. Stops at the first dimension without a
+// constant extent, or past which the layout is not known to be dense.
+Expr dense_shape_condition(const Parameter &p, const vector<Expr> &mins, const vector<Expr> &extents) {
+    Expr cond;
+    int64_t stride = 1;
+    for (int d = 0; d < (int)extents.size(); d++) {
+        const int64_t *extent = extents[d].defined() ? as_const_int(extents[d]) : nullptr;
+        if (!extent || *extent <= 0) {
+            break;
+        }
+        Expr c = buffer_field(p, "extent", d) == (int)*extent;
+        const int64_t *min = mins[d].defined() ? as_const_int(mins[d]) : nullptr;
+        if (min) {
+            c = c && buffer_field(p, "min", d) == (int)*min;
+        }
+        // A stride constraint other than the dense stride means the
+        // buffer isn't dense, so we can't say anything about the
+        // strides of any outer dimensions either.
+        Expr stride_constraint = p.stride_constraint(d);
+        bool dense = true;
+        if (!stride_constraint.defined()) {
+            c = c && buffer_field(p, "stride", d) == (int)stride;
+        } else if (!is_const(stride_constraint, stride)) {
+            dense = false;
+        }
+        cond = cond.defined() ? (cond && c) : c;
+        stride *= *extent;
+        if (!dense || stride > std::numeric_limits<int32_t>::max()) {
+            break;
+        }
+    }
+    return cond;
+}
+
+void add_specialization_to_stage(Definition &def, const Expr &cond) {
+    if (!def.defined() ||
+        !def.specializations().empty() ||
+        !def.schedule().fuse_level().level.is_inlined() ||
+        !def.schedule().fused_pairs().empty()) {
+        return;
+    }
+    def.add_specialization(cond);
+}
+
 }  // namespace
 
+void specialize_on_estimates(const vector<Function> &outputs, map<string, Function> &env) {
+    Expr cond;
+    auto add_condition = [&](const Expr &c) {
+        if (c.defined()) {
+            cond = cond.defined() ? (cond && c) : c;
+        }
+    };
+
+    // The output buffers, using the estimates on either the buffer or
+    // the Func.
+    for (const Function &f : outputs) {
+        for (const Parameter &p : f.output_buffers()) {
+            vector<Expr> mins, extents;
+            for (int d = 0; d < f.dimensions(); d++) {
+                Expr m = p.min_constraint_estimate(d);
+                Expr e = p.extent_constraint_estimate(d);
+                for (const Bound &b : f.schedule().estimates()) {
+                    if (!e.defined() && b.var == f.args()[d]) {
+                        m = b.min;
+                        e = b.extent;
+                    }
+                }
+                mins.push_back(m);
+                extents.push_back(e);
+            }
+            add_condition(dense_shape_condition(p, mins, extents));
+        }
+    }
+
+    // The input buffers, using the estimates set on them.
+    FindBufferParams finder;
+    for (const auto &iter : env) {
+        iter.second.accept(&finder);
+    }
+    for (const Parameter &p : finder.params) {
+        vector<Expr> mins, extents;
+        for (int d = 0; d < p.dimensions(); d++) {
+            mins.push_back(p.min_constraint_estimate(d));
+            extents.push_back(p.extent_constraint_estimate(d));
+        }
+        add_condition(dense_shape_condition(p, mins, extents));
+    }
+
+    if (!cond.defined()) {
+        return;
+    }
+
+    debug(1) << "Specializing on estimated shapes: " << cond << "\n";
+
+    // The condition only depends on the pipeline's buffers, so it
+    // applies equally to every Func that gets its own loop nest.
+    for (auto &iter : env) {
+        Function &f = iter.second;
+        if (f.has_extern_definition() ||
+            f.schedule().compute_level().is_inlined()) {
+            continue;
+        }
+        add_specialization_to_stage(f.definition(), cond);
+        for (size_t i = 0; i < f.updates().size(); i++) {
+            add_specialization_to_stage(f.update((int)i), cond);
+        }
+    }
+}
+
 void simplify_specializations(map<string, Function> &env) {
     for (auto &iter : env) {
         Function &func = iter.second;
@@ -9,6 +9,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include "Expr.h"
 
@@ -21,6 +22,18 @@ class Function;
  * specializations. */
 void simplify_specializations(std::map<std::string, Function> &env);
 
+/** Add a specialization to every stage of every Function that is
+ * not inlined, for the case where the output and input buffers have
+ * exactly the mins and extents given by their estimates, and are
+ * densely packed. Within that specialization all the mins, extents
+ * and strides are constants,
+ * which simplifies index arithmetic and bounds checks and lets loops
+ * over the vectorized dimension drop their tails. The generic code is
+ * kept as the fallback. Stages that already have specializations, or
+ * that are fused with other stages via compute_with, are left
+ * alone. */
+void specialize_on_estimates(const std::vector<Function> &outputs, std::map<std::string, Function> &env);
+
 }  // namespace Internal
 }  // namespace Halide
 
@@ -704,15 +704,23 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
                 Expr max_extent = find_constant_bound(extent, Direction::Upper, scope);
                 scope.pop(op->name);
 
+                // An async producer with a nonzero depth gets room
+                // to run that many loop iterations ahead of the
+                // consumer.
+                int slices = 1;
+                if (func.schedule().async()) {
+                    slices += func.schedule().async_depth();
+                }
+
                 const int max_fold = 1024;
                 const int64_t *const_max_extent = as_const_int(max_extent);
-                if (const_max_extent && *const_max_extent <= max_fold) {
-                    factor = static_cast<int>(next_power_of_two(*const_max_extent));
+                if (const_max_extent && *const_max_extent * slices <= max_fold) {
+                    factor = static_cast<int>(next_power_of_two(*const_max_extent * slices));
                 } else {
                     // Try a little harder to find a bounding power of two
                     int e = max_fold * 2;
                     bool success = false;
-                    while (e > 0 && can_prove(extent <= e / 2)) {
+                    while (e > 0 && can_prove(extent * slices <= e / 2)) {
                         success = true;
                         e /= 2;
                     }
@@ -941,6 +949,16 @@ class StorageFolding : public IRMutator {
         debug(3) << "Attempting to fold " << op->name << "\n";
         body = folder.mutate(body);
 
+        if (folder.dims_folded.empty() &&
+            func_it != env.end() &&
+            func.schedule().async() &&
+            func.schedule().async_depth() > 0) {
+            user_warning << "Func " << op->name << " was scheduled as async with depth "
+                         << func.schedule().async_depth() << ", but its storage could not be folded, "
+                         << "so the producer can't run ahead of the consumer. Use store_at to hoist "
+                         << "the storage outside of the loop the producer is computed at.\n";
+        }
+
         if (body.same_as(op->body)) {
             return op;
         } else if (folder.dims_folded.empty()) {
@@ -362,6 +362,12 @@ const std::map<std::string, Target::Feature> feature_name_map = {
     {"sve", Target::SVE},
     {"sve2", Target::SVE2},
     {"arm_dot_prod", Target::ARMDotProd},
+    {"loop_carry", Target::LoopCarry},
+    {"specialize_on_estimates", Target::SpecializeOnEstimates},
+    {"parallel_batch", Target::ParallelBatch},
+    {"lazy_jit", Target::LazyJIT},
+    {"tiered_jit", Target::TieredJIT},
+    {"pool_parallel_allocations", Target::PoolParallelAllocations},
     // NOTE: When adding features to this map, be sure to update PyEnums.cpp as well.
 };
 
@@ -121,6 +121,12 @@ struct Target {
         SVE = halide_target_feature_sve,
         SVE2 = halide_target_feature_sve2,
         ARMDotProd = halide_target_feature_arm_dot_prod,
+        LoopCarry = halide_target_feature_loop_carry,
+        SpecializeOnEstimates = halide_target_feature_specialize_on_estimates,
+        ParallelBatch = halide_target_feature_parallel_batch,
+        LazyJIT = halide_target_feature_lazy_jit,
+        TieredJIT = halide_target_feature_tiered_jit,
+        PoolParallelAllocations = halide_target_feature_pool_parallel_allocations,
         FeatureEnd = halide_target_feature_end
     };
     Target()
@@ -6,12 +6,13 @@
 #include "Func.h"
 #include "ImageParam.h"
 #include "JITModule.h"
-#if WITH_WABT
+#if WITH_WABT || WITH_WASMTIME
 #include "LLVM_Headers.h"
 #endif
 #include "LLVM_Output.h"
 #include "LLVM_Runtime_Linker.h"
 #include "Target.h"
+#include "Util.h"
 
 #include <cmath>
 #include <csignal>
@@ -33,6 +34,14 @@
 #include "wabt-src/src/stream.h"
 #endif
 
+#if WITH_WASMTIME
+#include "wasmtime.h"
+#endif
+
+#if WITH_WABT && WITH_WASMTIME
+#error "Only one of WITH_WABT and WITH_WASMTIME may be defined"
+#endif
+
 namespace Halide {
 namespace Internal {
 
@@ -42,7 +51,7 @@ namespace Internal {
 // receive the result value.
 static const char kTrampolineSuffix[] = "_trampoline";
 
-#if WITH_WABT
+#if WITH_WABT || WITH_WASMTIME
 
 namespace {
 
@@ -425,6 +434,8 @@ auto dynamic_type_dispatch(const halide_type_t &type, Args &&... args) -> declty
 }
 // clang-format on
 
+#if WITH_WABT
+
 std::string to_string(const wabt::MemoryStream &m) {
     wabt::OutputBuffer &o = const_cast<wabt::MemoryStream *>(&m)->output_buffer();
     return std::string((const char *)o.data.data(), o.data.size());
@@ -455,7 +466,7 @@ uint8_t *get_wasm_memory_base(WabtContext &wabt_context) {
     return wabt_context.memory.UnsafeData();
 }
 
-wasm32_ptr_t wabt_malloc(WabtContext &wabt_context, size_t size) {
+wasm32_ptr_t wasm_malloc(WabtContext &wabt_context, size_t size) {
     wasm32_ptr_t p = wabt_context.bdmalloc.alloc_region(size);
     if (!p) {
         constexpr int kWasmPageSize = 65536;
@@ -473,7 +484,7 @@ wasm32_ptr_t wabt_malloc(WabtContext &wabt_context, size_t size) {
     return p;
 }
 
-void wabt_free(WabtContext &wabt_context, wasm32_ptr_t ptr) {
+void wasm_free(WabtContext &wabt_context, wasm32_ptr_t ptr) {
     wdebug(2) << "freeing ptr at: " << ptr << "\n";
     wabt_context.bdmalloc.free_region(ptr);
 }
@@ -491,10 +502,15 @@ JITUserContext *get_jit_user_context(WabtContext &wabt_context, const wabt::inte
     return jit_user_context;
 }
 
+#endif  // WITH_WABT
+
 // -----------------------
 // halide_buffer_t <-> wasm_halide_buffer_t helpers
 // -----------------------
 
+// These only need get_wasm_memory_base() and wasm_malloc() to be defined for
+// the engine's Context type, so they are shared by all of the engines.
+
 struct wasm_halide_buffer_t {
     uint64_t device;
     wasm32_ptr_t device_interface;  // halide_device_interface_t*
@@ -506,7 +522,8 @@ struct wasm_halide_buffer_t {
     wasm32_ptr_t padding;  // always zero
 };
 
-void dump_hostbuf(WabtContext &wabt_context, const halide_buffer_t *buf, const std::string &label) {
+template<typename Context>
+void dump_hostbuf(Context &context, const halide_buffer_t *buf, const std::string &label) {
 #if WASM_DEBUG_LEVEL >= 2
     const halide_dimension_t *dim = buf->dim;
     const uint8_t *host = buf->host;
@@ -533,11 +550,12 @@ void dump_hostbuf(WabtContext &wabt_context, const halide_buffer_t *buf, const s
 #endif
 }
 
-void dump_wasmbuf(WabtContext &wabt_context, wasm32_ptr_t buf_ptr, const std::string &label) {
+template<typename Context>
+void dump_wasmbuf(Context &context, wasm32_ptr_t buf_ptr, const std::string &label) {
 #if WASM_DEBUG_LEVEL >= 2
     wassert(buf_ptr);
 
-    uint8_t *base = get_wasm_memory_base(wabt_context);
+    uint8_t *base = get_wasm_memory_base(context);
     wasm_halide_buffer_t *buf = (wasm_halide_buffer_t *)(base + buf_ptr);
     halide_dimension_t *dim = buf->dim ? (halide_dimension_t *)(base + buf->dim) : nullptr;
     uint8_t *host = buf->host ? (base + buf->host) : nullptr;
@@ -571,7 +589,8 @@ static_assert(sizeof(wasm_halide_buffer_t) == 40, "wasm_halide_buffer_t");
 // Given a halide_buffer_t on the host, allocate a wasm_halide_buffer_t in wasm
 // memory space and copy all relevant data. The resulting buf is laid out in
 // contiguous memory, and can be free with a single free().
-wasm32_ptr_t hostbuf_to_wasmbuf(WabtContext &wabt_context, const halide_buffer_t *src) {
+template<typename Context>
+wasm32_ptr_t hostbuf_to_wasmbuf(Context &context, const halide_buffer_t *src) {
     static_assert(sizeof(halide_type_t) == 4, "halide_type_t");
     static_assert(sizeof(halide_dimension_t) == 16, "halide_dimension_t");
     static_assert(sizeof(wasm_halide_buffer_t) == 40, "wasm_halide_buffer_t");
@@ -581,7 +600,7 @@ wasm32_ptr_t hostbuf_to_wasmbuf(WabtContext &wabt_context, const halide_buffer_t
         return 0;
     }
 
-    dump_hostbuf(wabt_context, src, "src");
+    dump_hostbuf(context, src, "src");
 
     wassert(src->device == 0);
     wassert(src->device_interface == nullptr);
@@ -595,10 +614,10 @@ wasm32_ptr_t hostbuf_to_wasmbuf(WabtContext &wabt_context, const halide_buffer_t
     const size_t host_size_in_bytes = src->size_in_bytes();
     const size_t mem_needed = host_offset + host_size_in_bytes;
 
-    const wasm32_ptr_t dst_ptr = wabt_malloc(wabt_context, mem_needed);
+    const wasm32_ptr_t dst_ptr = wasm_malloc(context, mem_needed);
     wassert(dst_ptr);
 
-    uint8_t *base = get_wasm_memory_base(wabt_context);
+    uint8_t *base = get_wasm_memory_base(context);
 
     wasm_halide_buffer_t *dst = (wasm_halide_buffer_t *)(base + dst_ptr);
     dst->device = 0;
@@ -617,21 +636,22 @@ wasm32_ptr_t hostbuf_to_wasmbuf(WabtContext &wabt_context, const halide_buffer_t
         memcpy(base + dst->host, src->host, host_size_in_bytes);
     }
 
-    dump_wasmbuf(wabt_context, dst_ptr, "dst");
+    dump_wasmbuf(context, dst_ptr, "dst");
 
     return dst_ptr;
 }
 
 // Given a pointer to a wasm_halide_buffer_t in wasm memory space,
 // allocate a Buffer<> on the host and copy all relevant data.
-void wasmbuf_to_hostbuf(WabtContext &wabt_context, wasm32_ptr_t src_ptr, Halide::Runtime::Buffer<> &dst) {
+template<typename Context>
+void wasmbuf_to_hostbuf(Context &context, wasm32_ptr_t src_ptr, Halide::Runtime::Buffer<> &dst) {
     wdebug(2) << "\nwasmbuf_to_hostbuf:\n";
 
-    dump_wasmbuf(wabt_context, src_ptr, "src");
+    dump_wasmbuf(context, src_ptr, "src");
 
     wassert(src_ptr);
 
-    uint8_t *base = get_wasm_memory_base(wabt_context);
+    uint8_t *base = get_wasm_memory_base(context);
 
     wasm_halide_buffer_t *src = (wasm_halide_buffer_t *)(base + src_ptr);
 
@@ -648,7 +668,7 @@ void wasmbuf_to_hostbuf(WabtContext &wabt_context, wasm32_ptr_t src_ptr, Halide:
     dst_tmp.dim = src->dim ? (halide_dimension_t *)(base + src->dim) : nullptr;
     dst_tmp.padding = 0;
 
-    dump_hostbuf(wabt_context, &dst_tmp, "dst_tmp");
+    dump_hostbuf(context, &dst_tmp, "dst_tmp");
 
     dst = Halide::Runtime::Buffer<>(dst_tmp);
     if (src->host) {
@@ -657,18 +677,19 @@ void wasmbuf_to_hostbuf(WabtContext &wabt_context, wasm32_ptr_t src_ptr, Halide:
         const size_t host_size_in_bytes = dst.raw_buffer()->size_in_bytes();
         memcpy(dst.raw_buffer()->host, base + src->host, host_size_in_bytes);
     }
-    dump_hostbuf(wabt_context, dst.raw_buffer(), "dst");
+    dump_hostbuf(context, dst.raw_buffer(), "dst");
 }
 
 // Given a wasm_halide_buffer_t, copy possibly-changed data into a halide_buffer_t.
 // Both buffers are asserted to match in type and dimensions.
-void copy_wasmbuf_to_existing_hostbuf(WabtContext &wabt_context, wasm32_ptr_t src_ptr, halide_buffer_t *dst) {
+template<typename Context>
+void copy_wasmbuf_to_existing_hostbuf(Context &context, wasm32_ptr_t src_ptr, halide_buffer_t *dst) {
     wassert(src_ptr && dst);
 
     wdebug(2) << "\ncopy_wasmbuf_to_existing_hostbuf:\n";
-    dump_wasmbuf(wabt_context, src_ptr, "src");
+    dump_wasmbuf(context, src_ptr, "src");
 
-    uint8_t *base = get_wasm_memory_base(wabt_context);
+    uint8_t *base = get_wasm_memory_base(context);
 
     wasm_halide_buffer_t *src = (wasm_halide_buffer_t *)(base + src_ptr);
     wassert(src->device == 0);
@@ -676,7 +697,7 @@ void copy_wasmbuf_to_existing_hostbuf(WabtContext &wabt_context, wasm32_ptr_t sr
     wassert(src->dimensions == dst->dimensions);
     wassert(src->type == dst->type);
 
-    dump_hostbuf(wabt_context, dst, "dst_pre");
+    dump_hostbuf(context, dst, "dst_pre");
 
     if (src->dimensions) {
         memcpy(dst->dim, base + src->dim, sizeof(halide_dimension_t) * src->dimensions);
@@ -690,18 +711,19 @@ void copy_wasmbuf_to_existing_hostbuf(WabtContext &wabt_context, wasm32_ptr_t sr
     dst->device_interface = 0;
     dst->flags = src->flags;
 
-    dump_hostbuf(wabt_context, dst, "dst_post");
+    dump_hostbuf(context, dst, "dst_post");
 }
 
 // Given a halide_buffer_t, copy possibly-changed data into a wasm_halide_buffer_t.
 // Both buffers are asserted to match in type and dimensions.
-void copy_hostbuf_to_existing_wasmbuf(WabtContext &wabt_context, const halide_buffer_t *src, wasm32_ptr_t dst_ptr) {
+template<typename Context>
+void copy_hostbuf_to_existing_wasmbuf(Context &context, const halide_buffer_t *src, wasm32_ptr_t dst_ptr) {
     wassert(src && dst_ptr);
 
     wdebug(1) << "\ncopy_hostbuf_to_existing_wasmbuf:\n";
-    dump_hostbuf(wabt_context, src, "src");
+    dump_hostbuf(context, src, "src");
 
-    uint8_t *base = get_wasm_memory_base(wabt_context);
+    uint8_t *base = get_wasm_memory_base(context);
 
     wasm_halide_buffer_t *dst = (wasm_halide_buffer_t *)(base + dst_ptr);
     wassert(src->device == 0);
@@ -709,7 +731,7 @@ void copy_hostbuf_to_existing_wasmbuf(WabtContext &wabt_context, const halide_bu
     wassert(src->dimensions == dst->dimensions);
     wassert(src->type == dst->type);
 
-    dump_wasmbuf(wabt_context, dst_ptr, "dst_pre");
+    dump_wasmbuf(context, dst_ptr, "dst_pre");
 
     if (src->dimensions) {
         memcpy(base + dst->dim, src->dim, sizeof(halide_dimension_t) * src->dimensions);
@@ -723,9 +745,128 @@ void copy_hostbuf_to_existing_wasmbuf(WabtContext &wabt_context, const halide_bu
     dst->device_interface = 0;
     dst->flags = src->flags;
 
-    dump_wasmbuf(wabt_context, dst_ptr, "dst_post");
+    dump_wasmbuf(context, dst_ptr, "dst_post");
+}
+
+// --------------------------------------------------
+// Extern callback helpers
+// --------------------------------------------------
+
+struct ExternArgType {
+    halide_type_t type;
+    bool is_void;
+    bool is_buffer;
+};
+
+using TrampolineFn = void (*)(void **);
+
+bool should_skip_extern_symbol(const std::string &name) {
+    static std::set<std::string> symbols = {
+        "halide_print",
+        "halide_error"};
+    return symbols.count(name) > 0;
+}
+
+// Find the trampoline and the argument types (return type first) for
+// the define_extern named fn_name. Returns false if fn_name can't be
+// called from wasm.
+bool get_extern_callback_info(const std::string &fn_name,
+                              const std::map<std::string, Halide::JITExtern> &jit_externs,
+                              const JITModule &trampolines,
+                              std::vector<ExternArgType> &arg_types,
+                              TrampolineFn &trampoline_fn) {
+    if (should_skip_extern_symbol(fn_name)) {
+        wdebug(1) << "Skipping extern symbol: " << fn_name << "\n";
+        return false;
+    }
+
+    const auto it = jit_externs.find(fn_name);
+    if (it == jit_externs.end()) {
+        wdebug(1) << "Extern symbol not found in JIT Externs: " << fn_name << "\n";
+        return false;
+    }
+    const ExternSignature &sig = it->second.extern_c_function().signature();
+
+    const auto &tramp_it = trampolines.exports().find(fn_name + kTrampolineSuffix);
+    if (tramp_it == trampolines.exports().end()) {
+        wdebug(1) << "Extern symbol not found in trampolines: " << fn_name << "\n";
+        return false;
+    }
+    trampoline_fn = (TrampolineFn)tramp_it->second.address;
+
+    const size_t arg_count = sig.arg_types().size();
+
+    arg_types.clear();
+    if (sig.is_void_return()) {
+        const bool is_void = true;
+        const bool is_buffer = false;
+        // Specifying a type here with bits == 0 should trigger a proper 'void' return type
+        arg_types.push_back(ExternArgType{{halide_type_int, 0, 0}, is_void, is_buffer});
+    } else {
+        const Type &t = sig.ret_type();
+        const bool is_void = false;
+        const bool is_buffer = (t == type_of<halide_buffer_t *>());
+        user_assert(t.lanes() == 1) << "Halide Extern functions cannot return vector values.";
+        user_assert(!is_buffer) << "Halide Extern functions cannot return halide_buffer_t.";
+        arg_types.push_back(ExternArgType{t, is_void, is_buffer});
+    }
+    for (size_t i = 0; i < arg_count; ++i) {
+        const Type &t = sig.arg_types()[i];
+        const bool is_void = false;
+        const bool is_buffer = (t == type_of<halide_buffer_t *>());
+        user_assert(t.lanes() == 1) << "Halide Extern functions cannot accept vector values as arguments.";
+        arg_types.push_back(ExternArgType{t, is_void, is_buffer});
+    }
+    return true;
 }
 
+// The libm functions we provide to wasm code, as X(type, name) lists.
+// clang-format off
+#define FOR_EACH_POSIX_MATH_1(X) \
+    X(double, acos)              \
+    X(double, acosh)             \
+    X(double, asin)              \
+    X(double, asinh)             \
+    X(double, atan)              \
+    X(double, atanh)             \
+    X(double, cos)               \
+    X(double, cosh)              \
+    X(double, exp)               \
+    X(double, log)               \
+    X(double, round)             \
+    X(double, sin)               \
+    X(double, sinh)              \
+    X(double, tan)               \
+    X(double, tanh)              \
+    X(float, acosf)              \
+    X(float, acoshf)             \
+    X(float, asinf)              \
+    X(float, asinhf)             \
+    X(float, atanf)              \
+    X(float, atanhf)             \
+    X(float, cosf)               \
+    X(float, coshf)              \
+    X(float, expf)               \
+    X(float, logf)               \
+    X(float, roundf)             \
+    X(float, sinf)               \
+    X(float, sinhf)              \
+    X(float, tanf)               \
+    X(float, tanhf)
+
+#define FOR_EACH_POSIX_MATH_2(X) \
+    X(float, atan2f)             \
+    X(double, atan2)             \
+    X(float, fminf)              \
+    X(double, fmin)              \
+    X(float, fmaxf)              \
+    X(double, fmax)              \
+    X(float, powf)               \
+    X(double, pow)
+// clang-format on
+
+#if WITH_WABT
+
 // --------------------------------------------------
 // Helpers for converting to/from wabt::interp::Value
 // --------------------------------------------------
@@ -889,7 +1030,7 @@ WABT_HOST_CALLBACK(free) {
 
     wasm32_ptr_t p = args[0].Get<int32_t>();
     if (p) p -= kExtraMallocSlop;
-    wabt_free(wabt_context, p);
+    wasm_free(wabt_context, p);
     return wabt::Result::Ok;
 }
 
@@ -905,7 +1046,7 @@ WABT_HOST_CALLBACK(getenv) {
 
     // TODO: this string is leaked
     if (e) {
-        wasm32_ptr_t r = wabt_malloc(wabt_context, strlen(e) + 1);
+        wasm32_ptr_t r = wasm_malloc(wabt_context, strlen(e) + 1);
         strcpy((char *)base + r, e);
         results[0] = wabt::interp::Value::Make(r);
     } else {
@@ -1003,7 +1144,7 @@ WABT_HOST_CALLBACK(malloc) {
     WabtContext &wabt_context = get_wabt_context(thread);
 
     size_t size = args[0].Get<int32_t>() + kExtraMallocSlop;
-    wasm32_ptr_t p = wabt_malloc(wabt_context, size);
+    wasm32_ptr_t p = wasm_malloc(wabt_context, size);
     if (p) p += kExtraMallocSlop;
     results[0] = wabt::interp::Value::Make(p);
     return wabt::Result::Ok;
@@ -1100,52 +1241,11 @@ const HostCallbackMap &get_host_callback_map() {
 
         // Posix math.
         #define DEFINE_POSIX_MATH_CALLBACK(t, f) { #f, wabt_posix_math_1<t, ::f> },
-
-        DEFINE_POSIX_MATH_CALLBACK(double, acos)
-        DEFINE_POSIX_MATH_CALLBACK(double, acosh)
-        DEFINE_POSIX_MATH_CALLBACK(double, asin)
-        DEFINE_POSIX_MATH_CALLBACK(double, asinh)
-        DEFINE_POSIX_MATH_CALLBACK(double, atan)
-        DEFINE_POSIX_MATH_CALLBACK(double, atanh)
-        DEFINE_POSIX_MATH_CALLBACK(double, cos)
-        DEFINE_POSIX_MATH_CALLBACK(double, cosh)
-        DEFINE_POSIX_MATH_CALLBACK(double, exp)
-        DEFINE_POSIX_MATH_CALLBACK(double, log)
-        DEFINE_POSIX_MATH_CALLBACK(double, round)
-        DEFINE_POSIX_MATH_CALLBACK(double, sin)
-        DEFINE_POSIX_MATH_CALLBACK(double, sinh)
-        DEFINE_POSIX_MATH_CALLBACK(double, tan)
-        DEFINE_POSIX_MATH_CALLBACK(double, tanh)
-
-        DEFINE_POSIX_MATH_CALLBACK(float, acosf)
-        DEFINE_POSIX_MATH_CALLBACK(float, acoshf)
-        DEFINE_POSIX_MATH_CALLBACK(float, asinf)
-        DEFINE_POSIX_MATH_CALLBACK(float, asinhf)
-        DEFINE_POSIX_MATH_CALLBACK(float, atanf)
-        DEFINE_POSIX_MATH_CALLBACK(float, atanhf)
-        DEFINE_POSIX_MATH_CALLBACK(float, cosf)
-        DEFINE_POSIX_MATH_CALLBACK(float, coshf)
-        DEFINE_POSIX_MATH_CALLBACK(float, expf)
-        DEFINE_POSIX_MATH_CALLBACK(float, logf)
-        DEFINE_POSIX_MATH_CALLBACK(float, roundf)
-        DEFINE_POSIX_MATH_CALLBACK(float, sinf)
-        DEFINE_POSIX_MATH_CALLBACK(float, sinhf)
-        DEFINE_POSIX_MATH_CALLBACK(float, tanf)
-        DEFINE_POSIX_MATH_CALLBACK(float, tanhf)
-
+        FOR_EACH_POSIX_MATH_1(DEFINE_POSIX_MATH_CALLBACK)
         #undef DEFINE_POSIX_MATH_CALLBACK
 
         #define DEFINE_POSIX_MATH_CALLBACK2(t, f) { #f, wabt_posix_math_2<t, ::f> },
-
-        DEFINE_POSIX_MATH_CALLBACK2(float, atan2f)
-        DEFINE_POSIX_MATH_CALLBACK2(double, atan2)
-        DEFINE_POSIX_MATH_CALLBACK2(float, fminf)
-        DEFINE_POSIX_MATH_CALLBACK2(double, fmin)
-        DEFINE_POSIX_MATH_CALLBACK2(float, fmaxf)
-        DEFINE_POSIX_MATH_CALLBACK2(double, fmax)
-        DEFINE_POSIX_MATH_CALLBACK2(float, powf)
-        DEFINE_POSIX_MATH_CALLBACK2(double, pow)
-
+        FOR_EACH_POSIX_MATH_2(DEFINE_POSIX_MATH_CALLBACK2)
         #undef DEFINE_POSIX_MATH_CALLBACK2
     };
 
@@ -1154,17 +1254,9 @@ const HostCallbackMap &get_host_callback_map() {
 // clang-format on
 
 // --------------------------------------------------
-// Host Callback Functions
+// Extern Callback Functions
 // --------------------------------------------------
 
-struct ExternArgType {
-    halide_type_t type;
-    bool is_void;
-    bool is_buffer;
-};
-
-using TrampolineFn = void (*)(void **);
-
 wabt::Result extern_callback_wrapper(const std::vector<ExternArgType> &arg_types,
                                      TrampolineFn trampoline_fn,
                                      wabt::interp::Thread &thread,
@@ -1220,60 +1312,14 @@ wabt::Result extern_callback_wrapper(const std::vector<ExternArgType> &arg_types
     return wabt::Result::Ok;
 }
 
-bool should_skip_extern_symbol(const std::string &name) {
-    static std::set<std::string> symbols = {
-        "halide_print",
-        "halide_error"};
-    return symbols.count(name) > 0;
-}
-
 wabt::interp::HostFunc::Ptr make_extern_callback(wabt::interp::Store &store,
                                                  const std::map<std::string, Halide::JITExtern> &jit_externs,
                                                  const JITModule &trampolines,
                                                  const wabt::interp::ImportDesc &import) {
-    const std::string &fn_name = import.type.name;
-    if (should_skip_extern_symbol(fn_name)) {
-        wdebug(1) << "Skipping extern symbol: " << fn_name << "\n";
-        return wabt::interp::HostFunc::Ptr();
-    }
-
-    const auto it = jit_externs.find(fn_name);
-    if (it == jit_externs.end()) {
-        wdebug(1) << "Extern symbol not found in JIT Externs: " << fn_name << "\n";
-        return wabt::interp::HostFunc::Ptr();
-    }
-    const ExternSignature &sig = it->second.extern_c_function().signature();
-
-    const auto &tramp_it = trampolines.exports().find(fn_name + kTrampolineSuffix);
-    if (tramp_it == trampolines.exports().end()) {
-        wdebug(1) << "Extern symbol not found in trampolines: " << fn_name << "\n";
-        return wabt::interp::HostFunc::Ptr();
-    }
-    TrampolineFn trampoline_fn = (TrampolineFn)tramp_it->second.address;
-
-    const size_t arg_count = sig.arg_types().size();
-
     std::vector<ExternArgType> arg_types;
-
-    if (sig.is_void_return()) {
-        const bool is_void = true;
-        const bool is_buffer = false;
-        // Specifying a type here with bits == 0 should trigger a proper 'void' return type
-        arg_types.push_back(ExternArgType{{halide_type_int, 0, 0}, is_void, is_buffer});
-    } else {
-        const Type &t = sig.ret_type();
-        const bool is_void = false;
-        const bool is_buffer = (t == type_of<halide_buffer_t *>());
-        user_assert(t.lanes() == 1) << "Halide Extern functions cannot return vector values.";
-        user_assert(!is_buffer) << "Halide Extern functions cannot return halide_buffer_t.";
-        arg_types.push_back(ExternArgType{t, is_void, is_buffer});
-    }
-    for (size_t i = 0; i < arg_count; ++i) {
-        const Type &t = sig.arg_types()[i];
-        const bool is_void = false;
-        const bool is_buffer = (t == type_of<halide_buffer_t *>());
-        user_assert(t.lanes() == 1) << "Halide Extern functions cannot accept vector values as arguments.";
-        arg_types.push_back(ExternArgType{t, is_void, is_buffer});
+    TrampolineFn trampoline_fn = nullptr;
+    if (!get_extern_callback_info(import.type.name, jit_externs, trampolines, arg_types, trampoline_fn)) {
+        return wabt::interp::HostFunc::Ptr();
     }
 
     const auto callback_wrapper =
@@ -1304,123 +1350,746 @@ wabt::Features calc_features(const Target &target) {
     return f;
 }
 
-}  // namespace
-
 #endif  // WITH_WABT
 
-struct WasmModuleContents {
-    mutable RefCount ref_count;
+#if WITH_WASMTIME
 
-    const Target target;
-    const std::vector<Argument> arguments;
-    std::map<std::string, Halide::JITExtern> jit_externs;
-    std::vector<JITModule> extern_deps;
-    JITModule trampolines;
+// --------------------------------------------------
+// Wasmtime helpers
+// --------------------------------------------------
 
-#if WITH_WABT
-    BDMalloc bdmalloc;
-    wabt::interp::Store store;
-    wabt::interp::Module::Ptr module;
-    wabt::interp::Instance::Ptr instance;
-    wabt::interp::Thread::Options thread_options;
-    wabt::interp::Memory::Ptr memory;
-#endif
+// Unlike wabt, which lets us attach a context to each call, the wasm-c-api
+// binds the host functions to their environment once, at instantiation time.
+// The WasmtimeContext therefore lives as long as the module does, and the
+// user context is swapped in for the duration of each call.
+struct WasmtimeContext {
+    JITUserContext *jit_user_context = nullptr;
+    wasm_store_t *store = nullptr;
+    wasm_memory_t *memory = nullptr;
+    BDMalloc &bdmalloc;
 
-    WasmModuleContents(
-        const Module &halide_module,
-        const std::vector<Argument> &arguments,
-        const std::string &fn_name,
-        const std::map<std::string, Halide::JITExtern> &jit_externs,
-        const std::vector<JITModule> &extern_deps);
+    // We can't throw (or abort) from a host callback, as that would unwind
+    // through the engine's frames. Errors are stashed here instead, and the
+    // callback traps; run() reports the error once the call has returned.
+    std::string pending_error;
 
-    int run(const void **args);
+    explicit WasmtimeContext(BDMalloc &bdmalloc)
+        : bdmalloc(bdmalloc) {
+    }
 
-    ~WasmModuleContents();
+    WasmtimeContext(const WasmtimeContext &) = delete;
+    WasmtimeContext(WasmtimeContext &&) = delete;
+    void operator=(const WasmtimeContext &) = delete;
+    void operator=(WasmtimeContext &&) = delete;
 };
 
-WasmModuleContents::WasmModuleContents(
-    const Module &halide_module,
-    const std::vector<Argument> &arguments,
-    const std::string &fn_name,
-    const std::map<std::string, Halide::JITExtern> &jit_externs,
-    const std::vector<JITModule> &extern_deps)
-    : target(halide_module.target()),
-      arguments(arguments),
-      jit_externs(jit_externs),
-      extern_deps(extern_deps),
-      trampolines(JITModule::make_trampolines_module(get_host_target(), jit_externs, kTrampolineSuffix, extern_deps)) {
-
-#if WITH_WABT
-    user_assert(LLVM_VERSION >= 110) << "Using the WebAssembly JIT is only supported under LLVM 11+.";
-
-    wdebug(1) << "Compiling wasm function " << fn_name << "\n";
-
-    // Compile halide into wasm bytecode.
-    std::vector<char> final_wasm = compile_to_wasm(halide_module, fn_name);
+std::string to_string(const wasm_byte_vec_t *v) {
+    std::string s(v->data, v->size);
+    // Messages from the engine may or may not include the terminating null.
+    while (!s.empty() && s.back() == '\0') {
+        s.pop_back();
+    }
+    return s;
+}
 
-    store = wabt::interp::Store(calc_features(halide_module.target()));
+wasm_trap_t *make_trap(WasmtimeContext &context, const std::string &msg) {
+    wasm_message_t message;
+    wasm_name_new(&message, msg.size() + 1, msg.c_str());
+    wasm_trap_t *trap = wasm_trap_new(context.store, &message);
+    wasm_byte_vec_delete(&message);
+    return trap;
+}
 
-    // Create a wabt Module for it.
-    wabt::MemoryStream log_stream;
-    constexpr bool kReadDebugNames = true;
-    constexpr bool kStopOnFirstError = true;
-    constexpr bool kFailOnCustomSectionError = true;
-    wabt::ReadBinaryOptions options(store.features(),
-                                    &log_stream,
-                                    kReadDebugNames,
-                                    kStopOnFirstError,
-                                    kFailOnCustomSectionError);
-    wabt::Errors errors;
-    wabt::interp::ModuleDesc module_desc;
-    wabt::Result r = wabt::interp::ReadBinaryInterp(final_wasm.data(),
-                                                    final_wasm.size(),
-                                                    options,
-                                                    &errors,
-                                                    &module_desc);
-    internal_assert(Succeeded(r))
-        << "ReadBinaryInterp failed:\n"
-        << wabt::FormatErrorsToString(errors, wabt::Location::Type::Binary) << "\n"
-        << "  log: " << to_string(log_stream) << "\n";
+// Return the message of a trap, and delete it.
+std::string trap_message(wasm_trap_t *trap) {
+    wasm_message_t message;
+    wasm_trap_message(trap, &message);
+    std::string s = to_string(&message);
+    wasm_byte_vec_delete(&message);
+    wasm_trap_delete(trap);
+    return s;
+}
 
-    if (WASM_DEBUG_LEVEL >= 2) {
-        wabt::MemoryStream dis_stream;
-        module_desc.istream.Disassemble(&dis_stream);
-        wdebug(WASM_DEBUG_LEVEL) << "Disassembly:\n"
-                                 << to_string(dis_stream) << "\n";
-    }
+uint8_t *get_wasm_memory_base(WasmtimeContext &context) {
+    // Note that this can move whenever the memory grows.
+    return (uint8_t *)wasm_memory_data(context.memory);
+}
 
-    module = wabt::interp::Module::New(store, module_desc);
+wasm32_ptr_t wasm_malloc(WasmtimeContext &context, size_t size) {
+    wasm32_ptr_t p = context.bdmalloc.alloc_region(size);
+    if (!p) {
+        constexpr int kWasmPageSize = 65536;
+        const int32_t pages_needed = (size + kWasmPageSize - 1) / kWasmPageSize;
+        wdebug(1) << "attempting to grow by pages: " << pages_needed << "\n";
 
-    // Bind all imports to our callbacks.
-    wabt::interp::RefVec imports;
-    const HostCallbackMap &host_callback_map = get_host_callback_map();
-    for (const auto &import : module->desc().imports) {
-        wdebug(1) << "import=" << import.type.module << "." << import.type.name << "\n";
-        if (import.type.type->kind == wabt::interp::ExternKind::Func && import.type.module == "env") {
-            auto it = host_callback_map.find(import.type.name);
-            if (it != host_callback_map.end()) {
-                auto func_type = *wabt::cast<wabt::interp::FuncType>(import.type.type.get());
-                auto host_func = wabt::interp::HostFunc::New(store, func_type, it->second);
-                imports.push_back(host_func.ref());
-                continue;
+        // This is usually called from a host callback, so we can't assert
+        // here; record the failure and return 0, which the runtime reports
+        // as an out-of-memory error.
+        if (!wasm_memory_grow(context.memory, pages_needed)) {
+            wdebug(1) << "wasm_memory_grow() failed\n";
+            if (context.pending_error.empty()) {
+                context.pending_error = "wasm_memory_grow() failed";
             }
-
-            // If it's not one of the standard host callbacks, assume it must be
-            // a define_extern, and look for it in the jit_externs.
-            auto host_func = make_extern_callback(store, jit_externs, trampolines, import);
-            imports.push_back(host_func.ref());
-            continue;
+            return 0;
         }
-        // By default, just push a null reference. This won't resolve, and
-        // instantiation will fail.
-        imports.push_back(wabt::interp::Ref::Null);
+
+        context.bdmalloc.grow_total_size(wasm_memory_data_size(context.memory));
+        p = context.bdmalloc.alloc_region(size);
     }
 
-    wabt::interp::RefPtr<wabt::interp::Trap> trap;
-    instance = wabt::interp::Instance::Instantiate(store, module.ref(), imports, &trap);
-    internal_assert(instance) << "Error initializing module: " << trap->message() << "\n";
+    wdebug(2) << "allocation of " << size << " at: " << p << "\n";
+    return p;
+}
 
-    int32_t heap_base = -1;
+void wasm_free(WasmtimeContext &context, wasm32_ptr_t ptr) {
+    wdebug(2) << "freeing ptr at: " << ptr << "\n";
+    context.bdmalloc.free_region(ptr);
+}
+
+// Some internal code can call halide_error(null, ...), so this needs to be resilient to that.
+// Callers must expect null and not crash.
+JITUserContext *get_jit_user_context(WasmtimeContext &context, const wasm_val_t &arg) {
+    int32_t ucon_magic = arg.of.i32;
+    if (ucon_magic == 0) {
+        return nullptr;
+    }
+    wassert(ucon_magic == kMagicJitUserContextValue);
+    JITUserContext *jit_user_context = context.jit_user_context;
+    wassert(jit_user_context);
+    return jit_user_context;
+}
+
+// --------------------------------------------------
+// Helpers for converting to/from wasm_val_t
+// --------------------------------------------------
+
+inline wasm_val_t make_wasm_val(int32_t v) {
+    wasm_val_t val;
+    val.kind = WASM_I32;
+    val.of.i32 = v;
+    return val;
+}
+
+inline wasm_val_t make_wasm_val(int64_t v) {
+    wasm_val_t val;
+    val.kind = WASM_I64;
+    val.of.i64 = v;
+    return val;
+}
+
+inline wasm_val_t make_wasm_val(float v) {
+    wasm_val_t val;
+    val.kind = WASM_F32;
+    val.of.f32 = v;
+    return val;
+}
+
+inline wasm_val_t make_wasm_val(double v) {
+    wasm_val_t val;
+    val.kind = WASM_F64;
+    val.of.f64 = v;
+    return val;
+}
+
+// Integer types narrower than 64 bits are passed as i32.
+template<typename T>
+struct LoadWasmVal {
+    inline wasm_val_t operator()(const void *src) {
+        using WasmT = typename std::conditional<sizeof(T) == 8, int64_t, int32_t>::type;
+        return make_wasm_val((WasmT) * (const T *)src);
+    }
+};
+
+template<>
+inline wasm_val_t LoadWasmVal<bool>::operator()(const void *src) {
+    return make_wasm_val((int32_t) * (const uint8_t *)src);
+}
+
+template<>
+inline wasm_val_t LoadWasmVal<float>::operator()(const void *src) {
+    return make_wasm_val(*(const float *)src);
+}
+
+template<>
+inline wasm_val_t LoadWasmVal<double>::operator()(const void *src) {
+    return make_wasm_val(*(const double *)src);
+}
+
+template<>
+inline wasm_val_t LoadWasmVal<void *>::operator()(const void *src) {
+    // Halide 'handle' types are always uint64, even on 32-bit systems
+    return make_wasm_val((int64_t) * (const uint64_t *)src);
+}
+
+template<>
+inline wasm_val_t LoadWasmVal<float16_t>::operator()(const void *src) {
+    return make_wasm_val((int32_t) * (const uint16_t *)src);
+}
+
+template<>
+inline wasm_val_t LoadWasmVal<bfloat16_t>::operator()(const void *src) {
+    return make_wasm_val((int32_t) * (const uint16_t *)src);
+}
+
+template<typename T>
+inline wasm_val_t load_wasm_val(const T &val) {
+    return LoadWasmVal<T>()(&val);
+}
+
+// -----
+
+template<typename T>
+struct StoreWasmVal {
+    inline void operator()(const wasm_val_t &src, void *dst) {
+        *(T *)dst = (T)(sizeof(T) == 8 ? src.of.i64 : src.of.i32);
+    }
+};
+
+template<>
+inline void StoreWasmVal<bool>::operator()(const wasm_val_t &src, void *dst) {
+    *(uint8_t *)dst = (uint8_t)src.of.i32;
+}
+
+template<>
+inline void StoreWasmVal<float>::operator()(const wasm_val_t &src, void *dst) {
+    *(float *)dst = src.of.f32;
+}
+
+template<>
+inline void StoreWasmVal<double>::operator()(const wasm_val_t &src, void *dst) {
+    *(double *)dst = src.of.f64;
+}
+
+template<>
+inline void StoreWasmVal<void *>::operator()(const wasm_val_t &src, void *dst) {
+    // Halide 'handle' types are always uint64, even on 32-bit systems
+    *(uint64_t *)dst = (uint64_t)src.of.i64;
+}
+
+template<>
+inline void StoreWasmVal<float16_t>::operator()(const wasm_val_t &src, void *dst) {
+    *(uint16_t *)dst = (uint16_t)src.of.i32;
+}
+
+template<>
+inline void StoreWasmVal<bfloat16_t>::operator()(const wasm_val_t &src, void *dst) {
+    *(uint16_t *)dst = (uint16_t)src.of.i32;
+}
+
+template<typename T>
+inline T store_wasm_val(const wasm_val_t &src) {
+    T dst;
+    StoreWasmVal<T>()(src, &dst);
+    return dst;
+}
+
+// --------------------------------------------------
+// Wasmtime Host Callback Functions
+// --------------------------------------------------
+
+template<typename T, T some_func(T)>
+wasm_trap_t *wasmtime_posix_math_1(void *env, const wasm_val_vec_t *args, wasm_val_vec_t *results) {
+    wassert(args->size == 1);
+    const T in = store_wasm_val<T>(args->data[0]);
+    const T out = some_func(in);
+    results->data[0] = load_wasm_val(out);
+    return nullptr;
+}
+
+template<typename T, T some_func(T, T)>
+wasm_trap_t *wasmtime_posix_math_2(void *env, const wasm_val_vec_t *args, wasm_val_vec_t *results) {
+    wassert(args->size == 2);
+    const T in1 = store_wasm_val<T>(args->data[0]);
+    const T in2 = store_wasm_val<T>(args->data[1]);
+    const T out = some_func(in1, in2);
+    results->data[0] = load_wasm_val(out);
+    return nullptr;
+}
+
+#define WASMTIME_HOST_CALLBACK(x)                                        \
+    wasm_trap_t *wasmtime_jit_##x##_callback(void *env,                  \
+                                             const wasm_val_vec_t *args, \
+                                             wasm_val_vec_t *results)
+
+#define WASMTIME_HOST_CALLBACK_UNIMPLEMENTED(x)                          \
+    WASMTIME_HOST_CALLBACK(x) {                                          \
+        return make_trap(*(WasmtimeContext *)env,                        \
+                         "WebAssembly JIT does not yet support the " #x \
+                         "() call.");                                    \
+    }
+
+WASMTIME_HOST_CALLBACK(__cxa_atexit) {
+    // nothing
+    results->data[0] = make_wasm_val((int32_t)0);
+    return nullptr;
+}
+
+WASMTIME_HOST_CALLBACK(__extendhfsf2) {
+    const uint16_t in = store_wasm_val<uint16_t>(args->data[0]);
+    const float out = (float)float16_t::make_from_bits(in);
+    results->data[0] = make_wasm_val(out);
+    return nullptr;
+}
+
+WASMTIME_HOST_CALLBACK(__truncsfhf2) {
+    const float in = args->data[0].of.f32;
+    const uint16_t out = float16_t(in).to_bits();
+    results->data[0] = load_wasm_val(out);
+    return nullptr;
+}
+
+WASMTIME_HOST_CALLBACK(abort) {
+    abort();
+    return nullptr;
+}
+
+WASMTIME_HOST_CALLBACK_UNIMPLEMENTED(fclose)
+
+WASMTIME_HOST_CALLBACK_UNIMPLEMENTED(fileno)
+
+WASMTIME_HOST_CALLBACK_UNIMPLEMENTED(fopen)
+
+WASMTIME_HOST_CALLBACK(free) {
+    WasmtimeContext &context = *(WasmtimeContext *)env;
+
+    wasm32_ptr_t p = args->data[0].of.i32;
+    if (p) p -= kExtraMallocSlop;
+    wasm_free(context, p);
+    return nullptr;
+}
+
+WASMTIME_HOST_CALLBACK_UNIMPLEMENTED(fwrite)
+
+WASMTIME_HOST_CALLBACK(getenv) {
+    WasmtimeContext &context = *(WasmtimeContext *)env;
+
+    const int32_t s = args->data[0].of.i32;
+
+    char *e = getenv((char *)get_wasm_memory_base(context) + s);
+
+    // TODO: this string is leaked
+    if (e) {
+        wasm32_ptr_t r = wasm_malloc(context, strlen(e) + 1);
+        if (!r) {
+            return make_trap(context, context.pending_error);
+        }
+        // wasm_malloc() may have grown the memory, so refetch the base.
+        strcpy((char *)get_wasm_memory_base(context) + r, e);
+        results->data[0] = make_wasm_val(r);
+    } else {
+        results->data[0] = make_wasm_val((int32_t)0);
+    }
+    return nullptr;
+}
+
+WASMTIME_HOST_CALLBACK(halide_print) {
+    WasmtimeContext &context = *(WasmtimeContext *)env;
+
+    wassert(args->size == 2);
+
+    JITUserContext *jit_user_context = get_jit_user_context(context, args->data[0]);
+    const int32_t str_address = args->data[1].of.i32;
+
+    uint8_t *p = get_wasm_memory_base(context);
+    const char *str = (const char *)p + str_address;
+
+    if (jit_user_context && jit_user_context->handlers.custom_print != NULL) {
+        (*jit_user_context->handlers.custom_print)(jit_user_context, str);
+    } else {
+        std::cout << str;
+    }
+    return nullptr;
+}
+
+WASMTIME_HOST_CALLBACK(halide_trace_helper) {
+    WasmtimeContext &context = *(WasmtimeContext *)env;
+
+    wassert(args->size == 12);
+
+    uint8_t *base = get_wasm_memory_base(context);
+
+    JITUserContext *jit_user_context = get_jit_user_context(context, args->data[0]);
+
+    const wasm32_ptr_t func_name_ptr = args->data[1].of.i32;
+    const wasm32_ptr_t value_ptr = args->data[2].of.i32;
+    const wasm32_ptr_t coordinates_ptr = args->data[3].of.i32;
+    const int type_code = args->data[4].of.i32;
+    const int type_bits = args->data[5].of.i32;
+    const int type_lanes = args->data[6].of.i32;
+    const int trace_code = args->data[7].of.i32;
+    const int parent_id = args->data[8].of.i32;
+    const int value_index = args->data[9].of.i32;
+    const int dimensions = args->data[10].of.i32;
+    const wasm32_ptr_t trace_tag_ptr = args->data[11].of.i32;
+
+    wassert(dimensions >= 0 && dimensions < 1024);  // not a hard limit, just a sanity check
+
+    halide_trace_event_t event;
+    event.func = (const char *)(base + func_name_ptr);
+    event.value = value_ptr ? ((void *)(base + value_ptr)) : nullptr;
+    event.coordinates = coordinates_ptr ? ((int32_t *)(base + coordinates_ptr)) : nullptr;
+    event.trace_tag = (const char *)(base + trace_tag_ptr);
+    event.type.code = (halide_type_code_t)type_code;
+    event.type.bits = (uint8_t)type_bits;
+    event.type.lanes = (uint16_t)type_lanes;
+    event.event = (halide_trace_event_code_t)trace_code;
+    event.parent_id = parent_id;
+    event.value_index = value_index;
+    event.dimensions = dimensions;
+
+    int32_t result = 0;
+    if (jit_user_context && jit_user_context->handlers.custom_trace != NULL) {
+        result = (*jit_user_context->handlers.custom_trace)(jit_user_context, &event);
+    } else {
+        debug(0) << "Dropping trace event due to lack of trace handler.\n";
+    }
+
+    results->data[0] = make_wasm_val(result);
+    return nullptr;
+}
+
+WASMTIME_HOST_CALLBACK(halide_error) {
+    WasmtimeContext &context = *(WasmtimeContext *)env;
+
+    wassert(args->size == 2);
+
+    JITUserContext *jit_user_context = get_jit_user_context(context, args->data[0]);
+    const int32_t str_address = args->data[1].of.i32;
+
+    uint8_t *p = get_wasm_memory_base(context);
+    const char *str = (const char *)p + str_address;
+
+    if (jit_user_context && jit_user_context->handlers.custom_error != NULL) {
+        (*jit_user_context->handlers.custom_error)(jit_user_context, str);
+    } else {
+        context.pending_error = str;
+        return make_trap(context, str);
+    }
+    return nullptr;
+}
+
+WASMTIME_HOST_CALLBACK(malloc) {
+    WasmtimeContext &context = *(WasmtimeContext *)env;
+
+    size_t size = args->data[0].of.i32 + kExtraMallocSlop;
+    wasm32_ptr_t p = wasm_malloc(context, size);
+    if (p) p += kExtraMallocSlop;
+    results->data[0] = make_wasm_val(p);
+    return nullptr;
+}
+
+WASMTIME_HOST_CALLBACK(memcpy) {
+    WasmtimeContext &context = *(WasmtimeContext *)env;
+
+    const int32_t dst = args->data[0].of.i32;
+    const int32_t src = args->data[1].of.i32;
+    const int32_t n = args->data[2].of.i32;
+
+    uint8_t *base = get_wasm_memory_base(context);
+
+    memcpy(base + dst, base + src, n);
+
+    results->data[0] = make_wasm_val(dst);
+    return nullptr;
+}
+
+WASMTIME_HOST_CALLBACK(memset) {
+    WasmtimeContext &context = *(WasmtimeContext *)env;
+
+    const int32_t s = args->data[0].of.i32;
+    const int32_t c = args->data[1].of.i32;
+    const int32_t n = args->data[2].of.i32;
+
+    uint8_t *base = get_wasm_memory_base(context);
+    memset(base + s, c, n);
+
+    results->data[0] = make_wasm_val(s);
+    return nullptr;
+}
+
+WASMTIME_HOST_CALLBACK(memcmp) {
+    WasmtimeContext &context = *(WasmtimeContext *)env;
+
+    const int32_t s1 = args->data[0].of.i32;
+    const int32_t s2 = args->data[1].of.i32;
+    const int32_t n = args->data[2].of.i32;
+
+    uint8_t *base = get_wasm_memory_base(context);
+
+    const int32_t r = memcmp(base + s1, base + s2, n);
+
+    results->data[0] = make_wasm_val(r);
+    return nullptr;
+}
+
+WASMTIME_HOST_CALLBACK(strlen) {
+    WasmtimeContext &context = *(WasmtimeContext *)env;
+    const int32_t s = args->data[0].of.i32;
+
+    uint8_t *base = get_wasm_memory_base(context);
+    int32_t r = strlen((char *)base + s);
+
+    results->data[0] = make_wasm_val(r);
+    return nullptr;
+}
+
+WASMTIME_HOST_CALLBACK_UNIMPLEMENTED(write)
+
+using WasmtimeHostCallbackMap = std::unordered_map<std::string, wasm_func_callback_with_env_t>;
+
+// clang-format off
+const WasmtimeHostCallbackMap &get_wasmtime_host_callback_map() {
+
+    static WasmtimeHostCallbackMap m = {
+        // General runtime functions.
+
+        #define DEFINE_CALLBACK(f) { #f, wasmtime_jit_##f##_callback },
+
+        DEFINE_CALLBACK(__cxa_atexit)
+        DEFINE_CALLBACK(__extendhfsf2)
+        DEFINE_CALLBACK(__truncsfhf2)
+        DEFINE_CALLBACK(abort)
+        DEFINE_CALLBACK(fclose)
+        DEFINE_CALLBACK(fileno)
+        DEFINE_CALLBACK(fopen)
+        DEFINE_CALLBACK(free)
+        DEFINE_CALLBACK(fwrite)
+        DEFINE_CALLBACK(getenv)
+        DEFINE_CALLBACK(halide_error)
+        DEFINE_CALLBACK(halide_print)
+        DEFINE_CALLBACK(halide_trace_helper)
+        DEFINE_CALLBACK(malloc)
+        DEFINE_CALLBACK(memcmp)
+        DEFINE_CALLBACK(memcpy)
+        DEFINE_CALLBACK(memset)
+        DEFINE_CALLBACK(strlen)
+        DEFINE_CALLBACK(write)
+
+        #undef DEFINE_CALLBACK
+
+        // Posix math.
+        #define DEFINE_POSIX_MATH_CALLBACK(t, f) { #f, wasmtime_posix_math_1<t, ::f> },
+        FOR_EACH_POSIX_MATH_1(DEFINE_POSIX_MATH_CALLBACK)
+        #undef DEFINE_POSIX_MATH_CALLBACK
+
+        #define DEFINE_POSIX_MATH_CALLBACK2(t, f) { #f, wasmtime_posix_math_2<t, ::f> },
+        FOR_EACH_POSIX_MATH_2(DEFINE_POSIX_MATH_CALLBACK2)
+        #undef DEFINE_POSIX_MATH_CALLBACK2
+    };
+
+    return m;
+}
+// clang-format on
+
+// --------------------------------------------------
+// Wasmtime Extern Callback Functions
+// --------------------------------------------------
+
+struct WasmtimeExternCallback {
+    WasmtimeContext *context;
+    std::vector<ExternArgType> arg_types;
+    TrampolineFn trampoline_fn;
+};
+
+wasm_trap_t *wasmtime_extern_callback_wrapper(void *env, const wasm_val_vec_t *args, wasm_val_vec_t *results) {
+    const WasmtimeExternCallback &callback = *(const WasmtimeExternCallback *)env;
+    WasmtimeContext &context = *callback.context;
+    const std::vector<ExternArgType> &arg_types = callback.arg_types;
+
+    wassert(arg_types.size() >= 1);
+    const size_t arg_types_len = arg_types.size() - 1;
+    const ExternArgType &ret_type = arg_types[0];
+
+    // There's wasted space here, but that's ok.
+    std::vector<Halide::Runtime::Buffer<>> buffers(arg_types_len);
+    std::vector<uint64_t> scalars(arg_types_len, 0);
+    std::vector<void *> trampoline_args(arg_types_len, nullptr);
+
+    for (size_t i = 0; i < arg_types_len; ++i) {
+        const auto &a = arg_types[i + 1];
+        if (a.is_buffer) {
+            const wasm32_ptr_t buf_ptr = args->data[i].of.i32;
+            wasmbuf_to_hostbuf(context, buf_ptr, buffers[i]);
+            trampoline_args[i] = buffers[i].raw_buffer();
+        } else {
+            dynamic_type_dispatch<StoreWasmVal>(a.type, args->data[i], (void *)&scalars[i]);
+            trampoline_args[i] = &scalars[i];
+        }
+    }
+
+    // The return value (if any) is always scalar.
+    uint64_t ret_val = 0;
+    const bool has_retval = !ret_type.is_void;
+    internal_assert(!ret_type.is_buffer);
+    if (has_retval) {
+        trampoline_args.push_back(&ret_val);
+    }
+    (*callback.trampoline_fn)(trampoline_args.data());
+
+    if (has_retval) {
+        results->data[0] = dynamic_type_dispatch<LoadWasmVal>(ret_type.type, (void *)&ret_val);
+    }
+
+    // Progagate buffer data backwards. Note that for arbitrary extern functions,
+    // we have no idea which buffers might be "input only", so we copy all data for all of them.
+    for (size_t i = 0; i < arg_types_len; ++i) {
+        const auto &a = arg_types[i + 1];
+        if (a.is_buffer) {
+            const wasm32_ptr_t buf_ptr = args->data[i].of.i32;
+            copy_hostbuf_to_existing_wasmbuf(context, buffers[i], buf_ptr);
+        }
+    }
+
+    return nullptr;
+}
+
+wasm_func_t *make_extern_callback(wasm_store_t *store,
+                                  WasmtimeContext *context,
+                                  const std::map<std::string, Halide::JITExtern> &jit_externs,
+                                  const JITModule &trampolines,
+                                  const std::string &fn_name,
+                                  const wasm_functype_t *func_type) {
+    std::vector<ExternArgType> arg_types;
+    TrampolineFn trampoline_fn = nullptr;
+    if (!get_extern_callback_info(fn_name, jit_externs, trampolines, arg_types, trampoline_fn)) {
+        return nullptr;
+    }
+
+    // The callback info is owned by the function, and deleted along with it.
+    WasmtimeExternCallback *callback = new WasmtimeExternCallback{context, std::move(arg_types), trampoline_fn};
+    return wasm_func_new_with_env(store, func_type, wasmtime_extern_callback_wrapper, callback,
+                                  [](void *env) { delete (WasmtimeExternCallback *)env; });
+}
+
+#endif  // WITH_WASMTIME
+
+}  // namespace
+
+#endif  // WITH_WABT || WITH_WASMTIME
+
+struct WasmModuleContents {
+    mutable RefCount ref_count;
+
+    const Target target;
+    const std::vector<Argument> arguments;
+    std::map<std::string, Halide::JITExtern> jit_externs;
+    std::vector<JITModule> extern_deps;
+    JITModule trampolines;
+
+#if WITH_WABT
+    BDMalloc bdmalloc;
+    wabt::interp::Store store;
+    wabt::interp::Module::Ptr module;
+    wabt::interp::Instance::Ptr instance;
+    wabt::interp::Thread::Options thread_options;
+    wabt::interp::Memory::Ptr memory;
+#elif WITH_WASMTIME
+    BDMalloc bdmalloc;
+    WasmtimeContext wasmtime_context{bdmalloc};
+    wasm_engine_t *engine = nullptr;
+    wasm_store_t *store = nullptr;
+    wasm_module_t *module = nullptr;
+    wasm_instance_t *instance = nullptr;
+    std::vector<wasm_func_t *> host_funcs;
+    wasm_extern_vec_t exports = {0, nullptr};
+    wasm_func_t *func = nullptr;
+#endif
+
+    WasmModuleContents(
+        const Module &halide_module,
+        const std::vector<Argument> &arguments,
+        const std::string &fn_name,
+        const std::map<std::string, Halide::JITExtern> &jit_externs,
+        const std::vector<JITModule> &extern_deps);
+
+    int run(const void **args);
+
+    ~WasmModuleContents();
+};
+
+WasmModuleContents::WasmModuleContents(
+    const Module &halide_module,
+    const std::vector<Argument> &arguments,
+    const std::string &fn_name,
+    const std::map<std::string, Halide::JITExtern> &jit_externs,
+    const std::vector<JITModule> &extern_deps)
+    : target(halide_module.target()),
+      arguments(arguments),
+      jit_externs(jit_externs),
+      extern_deps(extern_deps),
+      trampolines(JITModule::make_trampolines_module(get_host_target(), jit_externs, kTrampolineSuffix, extern_deps)) {
+
+#if WITH_WABT
+    user_assert(LLVM_VERSION >= 110) << "Using the WebAssembly JIT is only supported under LLVM 11+.";
+
+    wdebug(1) << "Compiling wasm function " << fn_name << "\n";
+
+    // Compile halide into wasm bytecode.
+    std::vector<char> final_wasm = compile_to_wasm(halide_module, fn_name);
+
+    store = wabt::interp::Store(calc_features(halide_module.target()));
+
+    // Create a wabt Module for it.
+    wabt::MemoryStream log_stream;
+    constexpr bool kReadDebugNames = true;
+    constexpr bool kStopOnFirstError = true;
+    constexpr bool kFailOnCustomSectionError = true;
+    wabt::ReadBinaryOptions options(store.features(),
+                                    &log_stream,
+                                    kReadDebugNames,
+                                    kStopOnFirstError,
+                                    kFailOnCustomSectionError);
+    wabt::Errors errors;
+    wabt::interp::ModuleDesc module_desc;
+    wabt::Result r = wabt::interp::ReadBinaryInterp(final_wasm.data(),
+                                                    final_wasm.size(),
+                                                    options,
+                                                    &errors,
+                                                    &module_desc);
+    internal_assert(Succeeded(r))
+        << "ReadBinaryInterp failed:\n"
+        << wabt::FormatErrorsToString(errors, wabt::Location::Type::Binary) << "\n"
+        << "  log: " << to_string(log_stream) << "\n";
+
+    if (WASM_DEBUG_LEVEL >= 2) {
+        wabt::MemoryStream dis_stream;
+        module_desc.istream.Disassemble(&dis_stream);
+        wdebug(WASM_DEBUG_LEVEL) << "Disassembly:\n"
+                                 << to_string(dis_stream) << "\n";
+    }
+
+    module = wabt::interp::Module::New(store, module_desc);
+
+    // Bind all imports to our callbacks.
+    wabt::interp::RefVec imports;
+    const HostCallbackMap &host_callback_map = get_host_callback_map();
+    for (const auto &import : module->desc().imports) {
+        wdebug(1) << "import=" << import.type.module << "." << import.type.name << "\n";
+        if (import.type.type->kind == wabt::interp::ExternKind::Func && import.type.module == "env") {
+            auto it = host_callback_map.find(import.type.name);
+            if (it != host_callback_map.end()) {
+                auto func_type = *wabt::cast<wabt::interp::FuncType>(import.type.type.get());
+                auto host_func = wabt::interp::HostFunc::New(store, func_type, it->second);
+                imports.push_back(host_func.ref());
+                continue;
+            }
+
+            // If it's not one of the standard host callbacks, assume it must be
+            // a define_extern, and look for it in the jit_externs.
+            auto host_func = make_extern_callback(store, jit_externs, trampolines, import);
+            imports.push_back(host_func.ref());
+            continue;
+        }
+        // By default, just push a null reference. This won't resolve, and
+        // instantiation will fail.
+        imports.push_back(wabt::interp::Ref::Null);
+    }
+
+    wabt::interp::RefPtr<wabt::interp::Trap> trap;
+    instance = wabt::interp::Instance::Instantiate(store, module.ref(), imports, &trap);
+    internal_assert(instance) << "Error initializing module: " << trap->message() << "\n";
+
+    int32_t heap_base = -1;
 
     for (const auto &e : module_desc.exports) {
         if (e.type.name == "__heap_base") {
@@ -1442,7 +2111,111 @@ WasmModuleContents::WasmModuleContents(
 
     bdmalloc.init(memory->ByteSize(), heap_base);
 
-#endif  // WITH_WABT
+#elif WITH_WASMTIME
+    user_assert(LLVM_VERSION >= 110) << "Using the WebAssembly JIT is only supported under LLVM 11+.";
+
+    wdebug(1) << "Compiling wasm function " << fn_name << "\n";
+
+    // Compile halide into wasm bytecode.
+    std::vector<char> final_wasm = compile_to_wasm(halide_module, fn_name);
+
+    // Wasmtime always accepts sign-extension and saturating
+    // float-to-int ops; SIMD has to be asked for.
+    wasm_config_t *config = wasm_config_new();
+    wasmtime_config_wasm_simd_set(config, target.has_feature(Target::WasmSimd128));
+    engine = wasm_engine_new_with_config(config);
+    store = wasm_store_new(engine);
+    wasmtime_context.store = store;
+
+    // Compile the wasm bytecode to native code.
+    wasm_byte_vec_t binary;
+    wasm_byte_vec_new(&binary, final_wasm.size(), final_wasm.data());
+    module = wasm_module_new(store, &binary);
+    wasm_byte_vec_delete(&binary);
+    internal_assert(module) << "wasm_module_new failed\n";
+
+    // Bind all imports to our callbacks.
+    wasm_importtype_vec_t import_types;
+    wasm_module_imports(module, &import_types);
+    std::vector<wasm_extern_t *> imports;
+    const WasmtimeHostCallbackMap &host_callback_map = get_wasmtime_host_callback_map();
+    for (size_t i = 0; i < import_types.size; i++) {
+        const wasm_importtype_t *import = import_types.data[i];
+        const std::string import_module = to_string(wasm_importtype_module(import));
+        const std::string import_name = to_string(wasm_importtype_name(import));
+        const wasm_externtype_t *import_type = wasm_importtype_type(import);
+        wdebug(1) << "import=" << import_module << "." << import_name << "\n";
+
+        wasm_func_t *host_func = nullptr;
+        if (wasm_externtype_kind(import_type) == WASM_EXTERN_FUNC && import_module == "env") {
+            const wasm_functype_t *func_type = wasm_externtype_as_functype_const(import_type);
+            auto it = host_callback_map.find(import_name);
+            if (it != host_callback_map.end()) {
+                host_func = wasm_func_new_with_env(store, func_type, it->second, &wasmtime_context, nullptr);
+            } else {
+                // If it's not one of the standard host callbacks, assume it must be
+                // a define_extern, and look for it in the jit_externs.
+                host_func = make_extern_callback(store, &wasmtime_context, jit_externs, trampolines, import_name, func_type);
+            }
+        }
+        // Unlike wabt, there's no null reference we can pass for an
+        // import we can't resolve, so fail here instead of at instantiation.
+        internal_assert(host_func) << "Error initializing module: unresolved import "
+                                   << import_module << "." << import_name << "\n";
+        host_funcs.push_back(host_func);
+        imports.push_back(wasm_func_as_extern(host_func));
+    }
+    wasm_importtype_vec_delete(&import_types);
+
+    wasm_extern_vec_t import_vec = {imports.size(), imports.data()};
+    wasm_trap_t *trap = nullptr;
+    instance = wasm_instance_new(store, module, &import_vec, &trap);
+    if (trap) {
+        internal_error << "Error initializing module: " << trap_message(trap) << "\n";
+    }
+    internal_assert(instance) << "Error initializing module\n";
+
+    int32_t heap_base = -1;
+
+    // The exports of the instance are in the same order as those of the module.
+    wasm_exporttype_vec_t export_types;
+    wasm_module_exports(module, &export_types);
+    wasm_instance_exports(instance, &exports);
+    internal_assert(export_types.size == exports.size);
+    for (size_t i = 0; i < exports.size; i++) {
+        const std::string export_name = to_string(wasm_exporttype_name(export_types.data[i]));
+        wasm_extern_t *e = exports.data[i];
+        if (export_name == "__heap_base") {
+            wasm_global_t *global = wasm_extern_as_global(e);
+            internal_assert(global);
+            wasm_val_t val;
+            wasm_global_get(global, &val);
+            heap_base = val.of.i32;
+            wdebug(1) << "__heap_base is " << heap_base << "\n";
+            continue;
+        }
+        if (export_name == "memory") {
+            internal_assert(wasm_extern_kind(e) == WASM_EXTERN_MEMORY);
+            internal_assert(!wasmtime_context.memory) << "Expected exactly one memory object but saw " << (void *)wasmtime_context.memory;
+            wasmtime_context.memory = wasm_extern_as_memory(e);
+            wdebug(1) << "heap_size is " << wasm_memory_data_size(wasmtime_context.memory) << "\n";
+            continue;
+        }
+        if (wasm_extern_kind(e) == WASM_EXTERN_FUNC) {
+            wdebug(1) << "Selecting export '" << export_name << "'\n";
+            internal_assert(!func) << "Multiple exported funcs found";
+            func = wasm_extern_as_func(e);
+            continue;
+        }
+    }
+    wasm_exporttype_vec_delete(&export_types);
+    internal_assert(heap_base >= 0) << "__heap_base not found";
+    internal_assert(func) << "No exported func found";
+    internal_assert(wasmtime_context.memory && wasm_memory_data_size(wasmtime_context.memory) > 0) << "memory size is unlikely";
+
+    bdmalloc.init(wasm_memory_data_size(wasmtime_context.memory), heap_base);
+
+#endif
 }
 
 int WasmModuleContents::run(const void **args) {
@@ -1528,7 +2301,7 @@ int WasmModuleContents::run(const void **args) {
     }
 
     for (wasm32_ptr_t p : wbufs) {
-        wabt_free(wabt_context, p);
+        wasm_free(wabt_context, p);
     }
 
     // Don't do this: things allocated by Halide runtime might need to persist
@@ -1537,6 +2310,82 @@ int WasmModuleContents::run(const void **args) {
 
     return result;
 
+#elif WITH_WASMTIME
+    JITUserContext *jit_user_context = nullptr;
+    for (size_t i = 0; i < arguments.size(); i++) {
+        const Argument &arg = arguments[i];
+        const void *arg_ptr = args[i];
+        if (arg.name == "__user_context") {
+            jit_user_context = *(JITUserContext **)const_cast<void *>(arg_ptr);
+        }
+    }
+
+    // Errors below are reported by throwing, so the per-call state is
+    // released by these guards rather than at the end of the function.
+    ScopedValue<JITUserContext *> scoped_user_context(wasmtime_context.jit_user_context, jit_user_context);
+    wasmtime_context.pending_error.clear();
+
+    std::vector<wasm_val_t> wasm_args;
+    std::vector<wasm32_ptr_t> wbufs(arguments.size(), 0);
+    struct FreeWasmBufs {
+        WasmtimeContext &context;
+        std::vector<wasm32_ptr_t> &wbufs;
+        ~FreeWasmBufs() {
+            for (wasm32_ptr_t p : wbufs) {
+                wasm_free(context, p);
+            }
+        }
+    } free_wbufs{wasmtime_context, wbufs};
+
+    for (size_t i = 0; i < arguments.size(); i++) {
+        const Argument &arg = arguments[i];
+        const void *arg_ptr = args[i];
+        if (arg.is_buffer()) {
+            halide_buffer_t *buf = (halide_buffer_t *)const_cast<void *>(arg_ptr);
+            // It's OK for this to be null (let Halide asserts handle it)
+            wasm32_ptr_t wbuf = hostbuf_to_wasmbuf(wasmtime_context, buf);
+            wbufs[i] = wbuf;
+            wasm_args.push_back(make_wasm_val(wbuf));
+        } else {
+            if (arg.name == "__user_context") {
+                wasm_args.push_back(make_wasm_val(kMagicJitUserContextValue));
+            } else {
+                wasm_args.push_back(dynamic_type_dispatch<LoadWasmVal>(arg.type, arg_ptr));
+            }
+        }
+    }
+
+    wasm_val_t wasm_result = make_wasm_val((int32_t)0);
+    wasm_val_vec_t args_vec = {wasm_args.size(), wasm_args.data()};
+    wasm_val_vec_t results_vec = {1, &wasm_result};
+    wasm_trap_t *trap = wasm_func_call(func, &args_vec, &results_vec);
+    if (trap) {
+        const std::string message = trap_message(trap);
+        if (!wasmtime_context.pending_error.empty()) {
+            std::string error;
+            std::swap(error, wasmtime_context.pending_error);
+            halide_runtime_error << error;
+        }
+        internal_error << "wasm_func_call failed: " << message << "\n";
+    }
+    int32_t result = wasm_result.of.i32;
+
+    wdebug(1) << "Result is " << result << "\n";
+
+    if (result == 0) {
+        // Update any output buffers
+        for (size_t i = 0; i < arguments.size(); i++) {
+            const Argument &arg = arguments[i];
+            const void *arg_ptr = args[i];
+            if (arg.is_buffer()) {
+                halide_buffer_t *buf = (halide_buffer_t *)const_cast<void *>(arg_ptr);
+                copy_wasmbuf_to_existing_hostbuf(wasmtime_context, wbufs[i], buf);
+            }
+        }
+    }
+
+    return result;
+
 #endif
 
     internal_error << "WasmExecutor is not configured correctly";
@@ -1546,6 +2395,23 @@ int WasmModuleContents::run(const void **args) {
 WasmModuleContents::~WasmModuleContents() {
 #if WITH_WABT
     // nothing
+#elif WITH_WASMTIME
+    wasm_extern_vec_delete(&exports);
+    if (instance) {
+        wasm_instance_delete(instance);
+    }
+    for (wasm_func_t *f : host_funcs) {
+        wasm_func_delete(f);
+    }
+    if (module) {
+        wasm_module_delete(module);
+    }
+    if (store) {
+        wasm_store_delete(store);
+    }
+    if (engine) {
+        wasm_engine_delete(engine);
+    }
 #endif
 }
 
@@ -1561,7 +2427,7 @@ void destroy<WasmModuleContents>(const WasmModuleContents *p) {
 
 /*static*/
 bool WasmModule::can_jit_target(const Target &target) {
-#if WITH_WABT
+#if WITH_WABT || WITH_WASMTIME
     if (target.arch == Target::WebAssembly) {
         return true;
     }
@@ -1569,6 +2435,15 @@ bool WasmModule::can_jit_target(const Target &target) {
     return false;
 }
 
+/*static*/
+bool WasmModule::runs_native_code() {
+#if WITH_WASMTIME
+    return true;
+#else
+    return false;
+#endif
+}
+
 /*static*/
 WasmModule WasmModule::compile(
     const Module &module,
@@ -1576,7 +2451,7 @@ WasmModule WasmModule::compile(
     const std::string &fn_name,
     const std::map<std::string, Halide::JITExtern> &jit_externs,
     const std::vector<JITModule> &extern_deps) {
-#if !defined(WITH_WABT)
+#if !defined(WITH_WABT) && !defined(WITH_WASMTIME)
     user_error << "Cannot run JITted WebAssembly without configuring a WebAssembly engine.";
     return WasmModule();
 #endif
@@ -7,7 +7,8 @@
  * Bindings for parameters, extern calls, etc. are established and the
  * Wasm code is executed. Allows calls to realize to work
  * exactly as if native code had been run, but via a JavaScript/Wasm VM.
- * Currently, only the WABT interpreter is supported.
+ * Either the WABT interpreter or the Wasmtime engine (which compiles
+ * the Wasm to native code first) may be used, chosen at build time.
  */
 
 #include "Argument.h"
@@ -28,6 +29,11 @@ struct WasmModule {
     /** If the given target can be executed via the wasm executor, return true. */
     static bool can_jit_target(const Target &target);
 
+    /** If wasm code is compiled to native code before it is run, rather
+     * than interpreted, return true. Only then are timings of it
+     * meaningful. */
+    static bool runs_native_code();
+
     /** Compile generated wasm code with a set of externs. */
     static WasmModule compile(
         const Module &module,
@@ -15,6 +15,10 @@
 #include <string.h>
 #include <vector>
 
+#ifdef HALIDE_RUNTIME_BUFFER_USE_THREADS
+#include <thread>
+#endif
+
 #if defined(__has_feature)
 #if __has_feature(memory_sanitizer)
 #include <sanitizer/msan_interface.h>
@@ -96,6 +100,20 @@ enum struct BufferDeviceOwnership : int {
     Cropped,                 ///> Call halide_device_release_crop when DevRefCount goes to zero.
 };
 
+/** This indicates how Halide::Runtime::Buffer should traverse the
+ * values of a buffer in for_each_value, copy_from and fill. Parallel
+ * splits the outermost dimension of the traversal across threads, so
+ * the function passed to for_each_value must be safe to call
+ * concurrently on distinct elements. Small buffers are always
+ * traversed on the calling thread. Parallel traversals use std::thread,
+ * so they are only enabled if HALIDE_RUNTIME_BUFFER_USE_THREADS is
+ * defined before this header is included. Otherwise Parallel is
+ * equivalent to Sequential, and this header doesn't need <thread>. */
+enum struct BufferExecutionPolicy : int {
+    Sequential,  ///> Traverse the buffer on the calling thread
+    Parallel,    ///> Split the traversal across std::threads
+};
+
 /** A similar struct for managing device allocations. */
 struct DeviceRefCount {
     // This is only ever constructed when there's something to manage,
@@ -791,6 +809,19 @@ public:
         buf.host = (uint8_t *)((uintptr_t)(unaligned_ptr + alignment - 1) & ~(alignment - 1));
     }
 
+    /** Point this Buffer at host memory that is owned by an
+     * AllocationHeader created elsewhere (for example, one that
+     * unmaps a memory-mapped file). The Buffer takes over the
+     * header's initial reference, which is shared with any copies of
+     * this Buffer, and header->deallocate_fn(header) is called when
+     * the last of them is destroyed. Drops the reference to any
+     * previously owned memory. Retains the shape of the buffer. */
+    void adopt_host_allocation(T *data, AllocationHeader *header) {
+        deallocate();
+        alloc = header;
+        buf.host = (uint8_t *)data;
+    }
+
     /** Drop reference to any owned host or device memory, possibly
      * freeing it, if this buffer held the last reference to
      * it. Retains the shape of the buffer. Does nothing if this
@@ -1204,9 +1235,14 @@ public:
      * sprite onto a framebuffer, you'll want to translate the sprite
      * to the correct location first like so: \code
      * framebuffer.copy_from(sprite.translated({x, y})); \endcode
+     *
+     * Runs of values that are contiguous in both buffers are copied
+     * with memcpy. Pass BufferExecutionPolicy::Parallel to split large
+     * copies across threads.
     */
     template<typename T2, int D2>
-    void copy_from(const Buffer<T2, D2> &other) {
+    void copy_from(const Buffer<T2, D2> &other,
+                   BufferExecutionPolicy policy = BufferExecutionPolicy::Sequential) {
         static_assert(!std::is_const<T>::value, "Cannot call copy_from() on a Buffer<const T>");
         assert(!device_dirty() && "Cannot call Halide::Runtime::Buffer::copy_from on a device dirty destination.");
         assert(!other.device_dirty() && "Cannot call Halide::Runtime::Buffer::copy_from on a device dirty source.");
@@ -1236,22 +1272,22 @@ public:
             using MemType = uint8_t;
             auto &typed_dst = (Buffer<MemType, D> &)dst;
             auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) { dst = src; }, typed_src);
+            copy_values(typed_dst, typed_src, policy);
         } else if (T_is_void ? (type().bytes() == 2) : (sizeof(not_void_T) == 2)) {
             using MemType = uint16_t;
             auto &typed_dst = (Buffer<MemType, D> &)dst;
             auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) { dst = src; }, typed_src);
+            copy_values(typed_dst, typed_src, policy);
         } else if (T_is_void ? (type().bytes() == 4) : (sizeof(not_void_T) == 4)) {
             using MemType = uint32_t;
             auto &typed_dst = (Buffer<MemType, D> &)dst;
             auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) { dst = src; }, typed_src);
+            copy_values(typed_dst, typed_src, policy);
         } else if (T_is_void ? (type().bytes() == 8) : (sizeof(not_void_T) == 8)) {
             using MemType = uint64_t;
             auto &typed_dst = (Buffer<MemType, D> &)dst;
             auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) { dst = src; }, typed_src);
+            copy_values(typed_dst, typed_src, policy);
         } else {
             assert(false && "type().bytes() must be 1, 2, 4, or 8");
         }
@@ -1943,9 +1979,10 @@ public:
         return all_equal;
     }
 
-    Buffer<T, D> &fill(not_void_T val) {
+    Buffer<T, D> &fill(not_void_T val,
+                       BufferExecutionPolicy policy = BufferExecutionPolicy::Sequential) {
         set_host_dirty();
-        for_each_value([=](T &v) { v = val; });
+        for_each_value(policy, [=](T &v) { v = val; });
         return *this;
     }
 
@@ -1982,6 +2019,17 @@ private:
     static void increment_ptrs() {
     }
 
+    // Same as advance_ptrs, but advances the pointers n times.
+    template<typename Ptr, typename... Ptrs>
+    HALIDE_ALWAYS_INLINE static void advance_ptrs_by(const int *stride, int64_t n, Ptr *ptr, Ptrs... ptrs) {
+        (*ptr) += n * (*stride);
+        advance_ptrs_by(stride + 1, n, ptrs...);
+    }
+
+    HALIDE_ALWAYS_INLINE
+    static void advance_ptrs_by(const int *, int64_t) {
+    }
+
     template<typename Fn, typename... Ptrs>
     HALIDE_NEVER_INLINE static void for_each_value_helper(Fn &&f, int d, bool innermost_strides_are_one,
                                                           const for_each_value_task_dim<sizeof...(Ptrs)> *t, Ptrs... ptrs) {
@@ -2071,8 +2119,68 @@ private:
         return innermost_strides_are_one;
     }
 
+    // Run body(t, d, begin) on disjoint ranges of the outermost
+    // dimension d of a prepared for_each_value traversal with at least
+    // one dimension, each from its own thread. t is a copy of the
+    // traversal with the extent of d reduced to that of the range,
+    // which starts at index begin.
+    template<int N, typename Body>
+    HALIDE_NEVER_INLINE static void for_each_value_parallel(int dimensions,
+                                                            const for_each_value_task_dim<N> *t,
+                                                            Body &&body) {
+        // The dimensions folded away by for_each_value_prep are left
+        // with an extent of one.
+        int d = dimensions - 1;
+        while (d > 0 && t[d].extent == 1) {
+            d--;
+        }
+        int64_t elements = 1;
+        for (int i = 0; i < dimensions; i++) {
+            elements *= t[i].extent;
+        }
+
+        // Not worth waking up another thread for less than this.
+        const int64_t min_elements_per_thread = 64 * 1024;
+        int64_t threads = 1;
+#ifdef HALIDE_RUNTIME_BUFFER_USE_THREADS
+        threads = std::min((int64_t)std::thread::hardware_concurrency(),
+                           std::min((int64_t)t[d].extent, elements / min_elements_per_thread));
+#endif
+        if (threads <= 1) {
+            body(t, d, 0);
+            return;
+        }
+
+#ifdef HALIDE_RUNTIME_BUFFER_USE_THREADS
+        const int64_t extent = t[d].extent;
+        auto run = [&](int64_t i) {
+            const int begin = (int)(extent * i / threads);
+            const int end = (int)(extent * (i + 1) / threads);
+            std::vector<for_each_value_task_dim<N>> chunk(t, t + dimensions);
+            chunk[d].extent = end - begin;
+            body(chunk.data(), d, begin);
+        };
+        std::vector<std::thread> workers;
+        for (int64_t i = 1; i < threads; i++) {
+            workers.emplace_back(run, i);
+        }
+        run(0);
+        for (std::thread &w : workers) {
+            w.join();
+        }
+#endif
+    }
+
+    template<typename Fn, typename... Ptrs>
+    HALIDE_ALWAYS_INLINE static void for_each_value_range(Fn &&f, int dimensions, bool innermost_strides_are_one,
+                                                          const for_each_value_task_dim<sizeof...(Ptrs)> *t,
+                                                          int d, int begin, Ptrs... ptrs) {
+        advance_ptrs_by(t[d].stride, begin, (&ptrs)...);
+        for_each_value_helper(f, dimensions - 1, innermost_strides_are_one, t, ptrs...);
+    }
+
     template<typename Fn, typename... Args, int N = sizeof...(Args) + 1>
-    void for_each_value_impl(Fn &&f, Args &&... other_buffers) const {
+    void for_each_value_impl(BufferExecutionPolicy policy, Fn &&f, Args &&... other_buffers) const {
         Buffer<>::for_each_value_task_dim<N> *t =
             (Buffer<>::for_each_value_task_dim<N> *)HALIDE_ALLOCA((dimensions() + 1) * sizeof(for_each_value_task_dim<N>));
         // Move the preparatory code into a non-templated helper to
@@ -2080,10 +2188,70 @@ private:
         const halide_buffer_t *buffers[] = {&buf, (&other_buffers.buf)...};
         bool innermost_strides_are_one = Buffer<>::for_each_value_prep(t, buffers);
 
-        Buffer<>::for_each_value_helper(f, dimensions() - 1,
-                                        innermost_strides_are_one,
-                                        t,
-                                        data(), (other_buffers.data())...);
+        if (policy == BufferExecutionPolicy::Parallel && dimensions() > 0) {
+            Buffer<>::for_each_value_parallel(
+                dimensions(), t,
+                [&](const Buffer<>::for_each_value_task_dim<N> *chunk, int d, int begin) {
+                    Buffer<>::for_each_value_range(f, dimensions(), innermost_strides_are_one,
+                                                   chunk, d, begin,
+                                                   data(), (other_buffers.data())...);
+                });
+        } else {
+            Buffer<>::for_each_value_helper(f, dimensions() - 1,
+                                            innermost_strides_are_one,
+                                            t,
+                                            data(), (other_buffers.data())...);
+        }
+    }
+
+    // The same traversal as for_each_value_helper for copy_from, but
+    // with a memcpy for the innermost dimension when it is dense in
+    // both buffers.
+    template<typename MemType>
+    HALIDE_NEVER_INLINE static void copy_helper(int d, bool innermost_strides_are_one,
+                                                const for_each_value_task_dim<2> *t,
+                                                MemType *dst, const MemType *src) {
+        if (d == -1) {
+            *dst = *src;
+        } else if (d == 0) {
+            if (innermost_strides_are_one) {
+                memcpy(dst, src, (size_t)t[0].extent * sizeof(MemType));
+            } else {
+                for (int i = t[0].extent; i != 0; i--) {
+                    *dst = *src;
+                    dst += t[0].stride[0];
+                    src += t[0].stride[1];
+                }
+            }
+        } else {
+            for (int i = t[d].extent; i != 0; i--) {
+                copy_helper(d - 1, innermost_strides_are_one, t, dst, src);
+                dst += t[d].stride[0];
+                src += t[d].stride[1];
+            }
+        }
+    }
+
+    template<typename MemType, int D2>
+    static void copy_values(Buffer<MemType, D2> &dst, Buffer<const MemType, D2> &src, BufferExecutionPolicy policy) {
+        const int dimensions = dst.dimensions();
+        Buffer<>::for_each_value_task_dim<2> *t =
+            (Buffer<>::for_each_value_task_dim<2> *)HALIDE_ALLOCA((dimensions + 1) * sizeof(for_each_value_task_dim<2>));
+        const halide_buffer_t *buffers[] = {&dst.buf, &src.buf};
+        bool innermost_strides_are_one = Buffer<>::for_each_value_prep(t, buffers);
+
+        if (policy == BufferExecutionPolicy::Parallel && dimensions > 0) {
+            Buffer<>::for_each_value_parallel(
+                dimensions, t,
+                [&](const Buffer<>::for_each_value_task_dim<2> *chunk, int d, int begin) {
+                    MemType *dst_ptr = dst.data();
+                    const MemType *src_ptr = src.data();
+                    advance_ptrs_by(chunk[d].stride, begin, &dst_ptr, &src_ptr);
+                    Buffer<>::copy_helper(dimensions - 1, innermost_strides_are_one, chunk, dst_ptr, src_ptr);
+                });
+        } else {
+            Buffer<>::copy_helper(dimensions - 1, innermost_strides_are_one, t, dst.data(), src.data());
+        }
     }
     // @}
 
@@ -2101,11 +2269,15 @@ public:
      * 'this' or the other-buffers arguments) will allow mutation of the
      * buffer contents, while a Buffer<const T> will not. Attempting to specify
      * a mutable reference for the lambda argument of a Buffer<const T>
-     * will result in a compilation error. */
+     * will result in a compilation error.
+     *
+     * The overloads taking a BufferExecutionPolicy as the first
+     * argument can split the traversal across threads, in which case
+     * the function is called concurrently on distinct values. */
     // @{
     template<typename Fn, typename... Args, int N = sizeof...(Args) + 1>
     HALIDE_ALWAYS_INLINE const Buffer<T, D> &for_each_value(Fn &&f, Args &&... other_buffers) const {
-        for_each_value_impl(f, std::forward<Args>(other_buffers)...);
+        for_each_value_impl(BufferExecutionPolicy::Sequential, f, std::forward<Args>(other_buffers)...);
         return *this;
     }
 
@@ -2113,7 +2285,21 @@ public:
     HALIDE_ALWAYS_INLINE
         Buffer<T, D> &
         for_each_value(Fn &&f, Args &&... other_buffers) {
-        for_each_value_impl(f, std::forward<Args>(other_buffers)...);
+        for_each_value_impl(BufferExecutionPolicy::Sequential, f, std::forward<Args>(other_buffers)...);
+        return *this;
+    }
+
+    template<typename Fn, typename... Args, int N = sizeof...(Args) + 1>
+    HALIDE_ALWAYS_INLINE const Buffer<T, D> &for_each_value(BufferExecutionPolicy policy, Fn &&f, Args &&... other_buffers) const {
+        for_each_value_impl(policy, f, std::forward<Args>(other_buffers)...);
+        return *this;
+    }
+
+    template<typename Fn, typename... Args, int N = sizeof...(Args) + 1>
+    HALIDE_ALWAYS_INLINE
+        Buffer<T, D> &
+        for_each_value(BufferExecutionPolicy policy, Fn &&f, Args &&... other_buffers) {
+        for_each_value_impl(policy, f, std::forward<Args>(other_buffers)...);
         return *this;
     }
     // @}
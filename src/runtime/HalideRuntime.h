@@ -357,6 +357,22 @@ extern halide_malloc_t halide_set_custom_malloc(halide_malloc_t user_malloc);
 extern halide_free_t halide_set_custom_free(halide_free_t user_free);
 //@}
 
+/** Halide uses these functions to reuse the scratch memory needed by
+ * the iterations of a parallel loop. A pool is created before the
+ * loop and destroyed after it. Temporaries inside the loop body are
+ * allocated from the pool and returned to it when they go out of
+ * scope, so a worker thread running many iterations reuses the same
+ * blocks instead of calling halide_malloc for every one of them. All
+ * memory is ultimately obtained from halide_malloc and released with
+ * halide_free. The pool may be used from multiple threads at once.
+ */
+//@{
+extern void *halide_scratch_pool_create(void *user_context);
+extern void halide_scratch_pool_destroy(void *user_context, void *pool);
+extern void *halide_scratch_pool_alloc(void *user_context, void *pool, uint64_t size);
+extern void halide_scratch_pool_free(void *user_context, void *ptr);
+//@}
+
 /** Halide calls these functions to interact with the underlying
  * system runtime functions. To replace in AOT code on platforms that
  * support weak linking, define these functions yourself, or use
@@ -1317,6 +1333,12 @@ typedef enum halide_target_feature_t {
     halide_target_feature_egl,                    ///< Force use of EGL support.
 
     halide_target_feature_arm_dot_prod,  ///< Enable ARMv8.2-a dotprod extension (i.e. udot and sdot instructions)
+    halide_target_feature_loop_carry,    ///< Reuse loads across iterations of serial loops by carrying them in registers. Always on for Hexagon.
+    halide_target_feature_specialize_on_estimates,  ///< Add a specialized fast path for input and output buffers that exactly match their estimated sizes and are densely packed.
+    halide_target_feature_parallel_batch,           ///< Also generate a <name>_batch function, which calls the pipeline on arrays of buffers from a single parallel loop. Each call still checks its own buffers.
+    halide_target_feature_lazy_jit,                 ///< When JIT compiling, compile each function the first time it is called, instead of all of them up front. Requires LLVM 11 or later.
+    halide_target_feature_tiered_jit,               ///< When JIT compiling, compile quickly with few optimizations first, then recompile with full optimization in the background and switch to that once it is ready.
+    halide_target_feature_pool_parallel_allocations,  ///< Serve heap allocations inside parallel loops from a scratch pool that is reused across iterations.
     halide_target_feature_end            ///< A sentinel. Every target is considered to have this feature, and setting this feature does nothing.
 } halide_target_feature_t;
 
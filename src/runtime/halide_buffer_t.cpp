@@ -213,6 +213,11 @@ halide_buffer_t *_halide_buffer_set_bounds(halide_buffer_t *buf,
     buf->dim[dim].extent = extent;
     return buf;
 }
+
+HALIDE_BUFFER_HELPER_ATTRS
+halide_buffer_t *_halide_buffer_array_get(halide_buffer_t *const *buffers, int i) {
+    return buffers[i];
+}
 }
 
 #undef HALIDE_BUFFER_HELPER_ATTRS
@@ -169,6 +169,10 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_qurt_hvx_unlock,
     (void *)&halide_qurt_hvx_unlock_as_destructor,
     (void *)&halide_release_jit_module,
+    (void *)&halide_scratch_pool_alloc,
+    (void *)&halide_scratch_pool_create,
+    (void *)&halide_scratch_pool_destroy,
+    (void *)&halide_scratch_pool_free,
     (void *)&halide_semaphore_init,
     (void *)&halide_semaphore_release,
     (void *)&halide_semaphore_try_acquire,
@@ -0,0 +1,128 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+// A scratch pool is a fixed set of growable blocks. An allocation
+// claims a free block, growing it if necessary, and releases it again
+// when freed. Blocks keep their memory until the pool is destroyed,
+// so after the first few iterations of a parallel loop each worker
+// finds a block that is already large enough.
+#define SCRATCH_POOL_SLOTS 64
+
+struct scratch_pool_t {
+    halide_pseudostack_slot_t slots[SCRATCH_POOL_SLOTS];
+    int busy[SCRATCH_POOL_SLOTS];
+};
+
+// Every pointer handed out is preceded by a header that records where
+// the memory came from. A slot of -1 means the pool was exhausted and
+// the memory came directly from halide_malloc.
+struct scratch_header_t {
+    scratch_pool_t *pool;
+    int slot;
+};
+
+WEAK size_t scratch_header_size() {
+    // Keep the pointers we hand out as aligned as those from halide_malloc.
+    const size_t alignment = halide_malloc_alignment();
+    return (sizeof(scratch_header_t) + alignment - 1) & ~(alignment - 1);
+}
+
+WEAK int scratch_pool_claim(scratch_pool_t *pool, size_t size) {
+    // Prefer a block that is already big enough, so that temporaries
+    // of different sizes don't keep trading blocks and reallocating.
+    for (int i = 0; i < SCRATCH_POOL_SLOTS; i++) {
+        if (!pool->busy[i] &&
+            pool->slots[i].size >= size &&
+            __sync_bool_compare_and_swap(&pool->busy[i], 0, 1)) {
+            return i;
+        }
+    }
+    for (int i = 0; i < SCRATCH_POOL_SLOTS; i++) {
+        if (!pool->busy[i] &&
+            __sync_bool_compare_and_swap(&pool->busy[i], 0, 1)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK void *halide_scratch_pool_create(void *user_context) {
+    scratch_pool_t *pool = (scratch_pool_t *)halide_malloc(user_context, sizeof(scratch_pool_t));
+    if (pool) {
+        memset(pool, 0, sizeof(scratch_pool_t));
+    }
+    return pool;
+}
+
+WEAK void halide_scratch_pool_destroy(void *user_context, void *ptr) {
+    scratch_pool_t *pool = (scratch_pool_t *)ptr;
+    if (!pool) {
+        return;
+    }
+    for (int i = 0; i < SCRATCH_POOL_SLOTS; i++) {
+        if (pool->slots[i].ptr) {
+            halide_free(user_context, pool->slots[i].ptr);
+        }
+    }
+    halide_free(user_context, pool);
+}
+
+WEAK void *halide_scratch_pool_alloc(void *user_context, void *ptr, uint64_t size) {
+    scratch_pool_t *pool = (scratch_pool_t *)ptr;
+    const size_t header_size = scratch_header_size();
+    const size_t total = header_size + (size_t)size;
+
+    int i = pool ? scratch_pool_claim(pool, total) : -1;
+    void *block = NULL;
+    if (i >= 0) {
+        halide_pseudostack_slot_t *slot = &pool->slots[i];
+        if (__builtin_expect(total > slot->size, 0)) {
+            if (slot->ptr) {
+                halide_free(user_context, slot->ptr);
+            }
+            slot->ptr = halide_malloc(user_context, total);
+            slot->size = slot->ptr ? total : 0;
+        }
+        block = slot->ptr;
+        if (!block) {
+            __sync_lock_release(&pool->busy[i]);
+            return NULL;
+        }
+    } else {
+        // Every block is in use. Fall back to the heap.
+        block = halide_malloc(user_context, total);
+        if (!block) {
+            return NULL;
+        }
+    }
+
+    scratch_header_t *header = (scratch_header_t *)block;
+    header->pool = pool;
+    header->slot = i;
+    return (uint8_t *)block + header_size;
+}
+
+WEAK void halide_scratch_pool_free(void *user_context, void *ptr) {
+    if (!ptr) {
+        return;
+    }
+    scratch_header_t *header = (scratch_header_t *)((uint8_t *)ptr - scratch_header_size());
+    if (header->slot < 0) {
+        halide_free(user_context, header);
+    } else {
+        __sync_lock_release(&header->pool->busy[header->slot]);
+    }
+}
+}
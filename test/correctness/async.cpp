@@ -420,6 +420,30 @@ int main(int argc, char **argv) {
         });
     }
 
+    // Multi-buffered async producer over strips of scanlines. The
+    // storage is folded automatically with room for the producer to
+    // compute two strips ahead of the one being consumed.
+    {
+        Func producer, consumer;
+        Var x, y, yo, yi;
+
+        producer(x, y) = expensive(x + y);
+        consumer(x, y) = producer(x, y - 1) + producer(x, y + 1);
+        consumer.compute_root().split(y, yo, yi, 8);
+        producer.store_root().compute_at(consumer, yo).async(2);
+
+        Buffer<int> out = consumer.realize(16, 64);
+
+        out.for_each_element([&](int x, int y) {
+            int correct = 2 * (x + y);
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n",
+                       x, y, out(x, y), correct);
+                exit(-1);
+            }
+        });
+    }
+
     // Computing other stages at the outermost var of an async stage
     // should include it in the async block.
     {
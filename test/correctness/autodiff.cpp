@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cmath>
 
 #include "Halide.h"
@@ -605,6 +606,10 @@ void test_linear_resampling_1d() {
     check(__LINE__, d_clamped1(0), 0.7f);
     check(__LINE__, d_clamped1(1), 0.5f);
     check(__LINE__, d_clamped1(2), 0.8f);
+
+    // clamped1 is small, so the scatter through the data-dependent fx
+    // becomes a gather over all of clamped1
+    _halide_user_assert(!has_non_pure_update(d(clamped1))) << "Function has non pure update\n";
 }
 
 void test_linear_resampling_2d() {
@@ -652,6 +657,59 @@ void test_linear_resampling_2d() {
     check(__LINE__, d_clamped1(2, 0), 0.8f);
 }
 
+void test_gather_2d(int grid_width) {
+    // Slice a small grid at two data-dependent indices, as when slicing a
+    // bilateral grid, and check the gradient of the grid against finite
+    // differences. Dimensions of the grid with extent up to 16 are
+    // gathered into; wider ones fall back to scattering.
+    const int width = 8, height = 6, grid_height = 3;
+    Var x("x"), y("y");
+    Buffer<float> image(width, height);
+    image.for_each_element([&](int x, int y) {
+        image(x, y) = ((x * 7 + y * 3) % 10) / 10.f;
+    });
+    Buffer<float> grid(grid_width, grid_height);
+    grid.for_each_element([&](int x, int y) {
+        grid(x, y) = 1.f + 0.5f * x - 0.25f * y;
+    });
+
+    Func f_image("f_image");
+    f_image(x, y) = image(x, y);
+    Func f_grid("f_grid");
+    f_grid(x, y) = grid(clamp(x, 0, grid_width - 1), clamp(y, 0, grid_height - 1));
+    Expr ix = clamp(cast<int>(f_image(x, y) * (grid_width - 1) + 0.5f), 0, grid_width - 1);
+    Expr iy = clamp(cast<int>((1.f - f_image(x, y)) * (grid_height - 1) + 0.5f), 0, grid_height - 1);
+    Func sliced("sliced");
+    sliced(x, y) = f_grid(ix, iy) * (f_image(x, y) + 0.5f);
+
+    RDom r(0, width, 0, height);
+    Func loss("loss");
+    loss() += sliced(r.x, r.y) * (1.f + r.x + 2.f * r.y);
+    Derivative d = propagate_adjoints(loss);
+
+    const bool gathered = grid_width <= 16;
+    _halide_user_assert(has_non_pure_update(d(f_grid)) != gathered)
+        << "Expected the adjoint of a " << grid_width << "x" << grid_height << " grid to "
+        << (gathered ? "gather" : "scatter") << "\n";
+
+    // The loss is linear in the grid, so central differences are exact up
+    // to rounding.
+    Buffer<float> d_grid = d(grid).realize(grid_width, grid_height);
+    const float eps = 0.5f;
+    for (int j = 0; j < grid_height; j++) {
+        for (int i = 0; i < grid_width; i++) {
+            const float original = grid(i, j);
+            grid(i, j) = original + eps;
+            Buffer<float> loss_plus = loss.realize();
+            grid(i, j) = original - eps;
+            Buffer<float> loss_minus = loss.realize();
+            grid(i, j) = original;
+            const float expected = (loss_plus() - loss_minus()) / (2.f * eps);
+            check(__LINE__, d_grid(i, j), expected, 1e-3f * std::max(1.f, std::fabs(expected)));
+        }
+    }
+}
+
 void test_sparse_update() {
     Var x("x");
     Buffer<float> input(3);
@@ -1417,6 +1475,175 @@ void test_random_float() {
     check(__LINE__, d_input(), o(0));
 }
 
+void test_checkpointing() {
+    Var x("x");
+    Buffer<float> input(8);
+    for (int i = 0; i < 8; i++) {
+        input(i) = 0.1f * i;
+    }
+    Func clamped("clamped");
+    clamped(x) = input(clamp(x, 0, 7));
+    // A chain of nonlinear stages, so that each adjoint reads the
+    // stage before it.
+    std::vector<Func> stages{clamped};
+    for (int i = 0; i < 4; i++) {
+        Func stage("stage_" + std::to_string(i));
+        stage(x) = sin(stages.back()(x) + stages.back()(x + 1));
+        stages.push_back(stage);
+    }
+    RDom r(0, 4);
+    Func f_loss("f_loss");
+    f_loss() += stages.back()(r.x) * stages.back()(r.x);
+
+    // Returns the names of the stages read directly by the adjoints
+    // that f depends on.
+    std::set<std::string> stage_names;
+    for (const Func &stage : stages) {
+        stage_names.insert(stage.name());
+    }
+    auto stages_read = [&](const Func &f) {
+        std::set<std::string> names;
+        for (const auto &it : find_transitive_calls(f.function())) {
+            if (stage_names.count(it.first)) {
+                continue;
+            }
+            for (const auto &call : find_direct_calls(it.second)) {
+                if (stage_names.count(call.first)) {
+                    names.insert(call.first);
+                }
+            }
+        }
+        return names;
+    };
+
+    Derivative d = propagate_adjoints(f_loss);
+    Buffer<float> d_input_buf = d(input).realize(8);
+    _halide_user_assert(stages_read(d(input)).size() == stages.size())
+        << "Expected the adjoints to read every stage\n";
+
+    // With no memory, every stage is recomputed inside the adjoints.
+    CheckpointOptions recompute_all;
+    recompute_all.memory_budget = 0;
+    Derivative d_recompute_all = propagate_adjoints(f_loss, recompute_all);
+    _halide_user_assert(stages_read(d_recompute_all(input)).empty())
+        << "Expected the adjoints to recompute every stage\n";
+    Buffer<float> d_input_recompute_all_buf = d_recompute_all(input).realize(8);
+
+    // With room for a few stages, only some are recomputed.
+    CheckpointOptions recompute_some;
+    recompute_some.memory_budget = 16 * sizeof(float);
+    Derivative d_recompute_some = propagate_adjoints(f_loss, recompute_some);
+    std::set<std::string> read = stages_read(d_recompute_some(input));
+    size_t num_read = read.size();
+    _halide_user_assert(num_read > 0 && num_read < stages.size())
+        << "Expected the adjoints to recompute some of the stages\n";
+    // A stage that's still read needs the stages before it, so
+    // recomputing those would save nothing: the ones read should be the
+    // first few.
+    for (size_t i = 0; i < num_read; i++) {
+        _halide_user_assert(read.count(stages[i].name()))
+            << "Expected " << stages[i].name() << " to be kept, as later stages are\n";
+    }
+    Buffer<float> d_input_recompute_some_buf = d_recompute_some(input).realize(8);
+
+    for (int i = 0; i < 8; i++) {
+        check(__LINE__, d_input_recompute_all_buf(i), d_input_buf(i), 1e-5f);
+        check(__LINE__, d_input_recompute_some_buf(i), d_input_buf(i), 1e-5f);
+    }
+}
+
+// Counts the distinct IR nodes in an expression.
+class CountIRNodes : public IRGraphVisitor {
+    using IRGraphVisitor::include;
+
+    void include(const Expr &e) override {
+        nodes.insert(e.get());
+        IRGraphVisitor::include(e);
+    }
+
+public:
+    std::set<const IRNode *> nodes;
+};
+
+void test_checkpointing_stencils() {
+    Var x("x"), y("y");
+    Buffer<float> input(8, 8);
+    for (int y = 0; y < 8; y++) {
+        for (int x = 0; x < 8; x++) {
+            input(x, y) = 0.01f * (x + 8 * y);
+        }
+    }
+    Func clamped("clamped");
+    clamped(x, y) = input(clamp(x, 0, 7), clamp(y, 0, 7));
+    // A chain of nonlinear 3x3 stencils. Recomputing each stage inlines
+    // nine copies of the one before it, so recomputing the whole chain
+    // would inline thousands of copies of the first stage.
+    std::vector<Func> stages{clamped};
+    for (int i = 0; i < 4; i++) {
+        Func stage("stencil_" + std::to_string(i));
+        Expr sum = 0.0f;
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                sum += stages.back()(x + dx, y + dy);
+            }
+        }
+        stage(x, y) = sin(0.1f * sum);
+        stages.push_back(stage);
+    }
+    RDom r(0, 4, 0, 4);
+    Func f_loss("f_loss");
+    f_loss() += stages.back()(r.x, r.y) * stages.back()(r.x, r.y);
+
+    std::set<std::string> stage_names;
+    for (const Func &stage : stages) {
+        stage_names.insert(stage.name());
+    }
+
+    Derivative d = propagate_adjoints(f_loss);
+    Buffer<float> d_input_buf = d(input).realize(8, 8);
+
+    // With no memory, as much of the chain as fits under the limit is
+    // recomputed, but not all of it.
+    CheckpointOptions checkpoint;
+    checkpoint.memory_budget = 0;
+    Derivative d_recompute = propagate_adjoints(f_loss, checkpoint);
+    std::map<std::string, Function> env = find_transitive_calls(d_recompute(input).function());
+    size_t num_read = 0;
+    for (const Func &stage : stages) {
+        num_read += env.count(stage.name());
+    }
+    _halide_user_assert(num_read > 0 && num_read < stages.size())
+        << "Expected the adjoints to recompute some, but not all, of the stencils\n";
+
+    // No definition in the gradient pipeline should have grown past a
+    // few inlined copies of the limit.
+    for (const auto &it : env) {
+        if (stage_names.count(it.first)) {
+            continue;
+        }
+        std::vector<Definition> definitions{it.second.definition()};
+        for (const Definition &update : it.second.updates()) {
+            definitions.push_back(update);
+        }
+        for (const Definition &def : definitions) {
+            CountIRNodes count;
+            for (const Expr &e : def.values()) {
+                e.accept(&count);
+            }
+            _halide_user_assert(count.nodes.size() <= 32 * (size_t)checkpoint.max_inlined_nodes)
+                << "Expected the definition of " << it.first << " to stay small, but it has "
+                << count.nodes.size() << " nodes\n";
+        }
+    }
+
+    Buffer<float> d_input_recompute_buf = d_recompute(input).realize(8, 8);
+    for (int y = 0; y < 8; y++) {
+        for (int x = 0; x < 8; x++) {
+            check(__LINE__, d_input_recompute_buf(x, y), d_input_buf(x, y), 1e-5f);
+        }
+    }
+}
+
 int main(int argc, char **argv) {
     test_scalar<float>();
     test_scalar<double>();
@@ -1431,6 +1658,9 @@ int main(int argc, char **argv) {
     test_1d_to_2d();
     test_linear_resampling_1d();
     test_linear_resampling_2d();
+    test_gather_2d(4);
+    test_gather_2d(16);
+    test_gather_2d(20);
     test_sparse_update();
     test_histogram();
     test_histogram_no_bounds();
@@ -1459,6 +1689,8 @@ int main(int argc, char **argv) {
     test_custom_adjoint_buffer();
     test_print();
     test_random_float();
+    test_checkpointing();
+    test_checkpointing_stencils();
     printf("[autodiff] Success!\n");
     return 0;
 }
@@ -1,5 +1,6 @@
 #include <iostream>
 // Don't include Halide.h: it is not necessary for this test.
+#define HALIDE_RUNTIME_BUFFER_USE_THREADS
 #include "HalideBuffer.h"
 
 #include <stdio.h>
@@ -415,6 +416,51 @@ int main(int argc, char **argv) {
         assert(b.dim(3).stride() == b2.dim(3).stride());
     }
 
+    {
+        // Check the parallel execution policy, and the memcpy paths of
+        // copy_from. The buffers are large enough to be split across
+        // threads.
+        const int W = 517, H = 389, C = 3;
+        Buffer<int> a(W, H, C);
+        Buffer<int> b = Buffer<int>::make_interleaved(W, H, C);
+        b.for_each_element([&](int x, int y, int c) { b(x, y, c) = x + W * (y + H * c); });
+
+        a.fill(-1, BufferExecutionPolicy::Parallel);
+        assert(a.all_equal(-1));
+
+        a.for_each_value(
+            BufferExecutionPolicy::Parallel,
+            [&](int &a, int b) { a = 3 * b; },
+            b);
+        a.for_each_element([&](int x, int y, int c) {
+            if (a(x, y, c) != 3 * b(x, y, c)) {
+                printf("a(%d, %d, %d) = %d instead of %d\n",
+                       x, y, c, a(x, y, c), 3 * b(x, y, c));
+                abort();
+            }
+        });
+
+        // Dense to dense, a single memcpy.
+        Buffer<int> c(W, H, C);
+        c.copy_from(a, BufferExecutionPolicy::Parallel);
+        // Interleaved to planar, and a crop, in which only rows are contiguous.
+        Buffer<int> d(W, H, C);
+        d.fill(0);
+        Buffer<int> e(W, H, C);
+        e.fill(0);
+        e.copy_from(b, BufferExecutionPolicy::Parallel);
+        d.copy_from(e.cropped(0, 3, W - 7).cropped(1, 5, H - 9), BufferExecutionPolicy::Parallel);
+        c.for_each_element([&](int x, int y, int c_) {
+            bool inside = x >= 3 && x < W - 4 && y >= 5 && y < H - 4;
+            if (c(x, y, c_) != a(x, y, c_) ||
+                e(x, y, c_) != b(x, y, c_) ||
+                d(x, y, c_) != (inside ? b(x, y, c_) : 0)) {
+                printf("copy_from failed at %d, %d, %d\n", x, y, c_);
+                abort();
+            }
+        });
+    }
+
     printf("Success!\n");
     return 0;
 }
@@ -1,4 +1,5 @@
 #include "Halide.h"
+#define HALIDE_IMAGE_IO_USE_THREADS
 #include "halide_image_io.h"
 #include "halide_test_dirs.h"
 
@@ -185,7 +186,7 @@ void do_test() {
     luma_buf.copy_from(color_buf);
     luma_buf.slice(2);
 
-    std::vector<std::string> formats = {"ppm", "pgm", "tmp", "mat", "tiff"};
+    std::vector<std::string> formats = {"ppm", "pgm", "tmp", "mat", "tiff", "htensor"};
 #ifndef HALIDE_NO_JPEG
     formats.push_back("jpg");
 #endif
@@ -255,10 +256,92 @@ void test_mat_header() {
     }
 }
 
+void test_htensor() {
+    // .htensor files keep the layout of dense buffers.
+    std::string filename = Internal::get_test_tmp_dir() + "test_interleaved.htensor";
+    Buffer<float> interleaved = Buffer<float>::make_interleaved(17, 11, 3);
+    interleaved.for_each_element([&](int x, int y, int c) {
+        interleaved(x, y, c) = x + y * 100 + c * 10000;
+    });
+    Tools::save_image(interleaved, filename);
+    Buffer<float> reloaded = Tools::load_image(filename);
+    if (reloaded.dim(0).stride() != 3 || reloaded.dim(2).stride() != 1) {
+        std::cout << "Layout of " << filename << " was not preserved\n";
+        abort();
+    }
+    reloaded.for_each_element([&](int x, int y, int c) {
+        if (reloaded(x, y, c) != interleaved(x, y, c)) {
+            std::cout << "reloaded(" << x << ", " << y << ", " << c << ") = " << reloaded(x, y, c)
+                      << " instead of " << interleaved(x, y, c) << "\n";
+            abort();
+        }
+    });
+
+    // Writing to the loaded buffer must not change the file.
+    reloaded(0, 0, 0) = -1.0f;
+    Buffer<float> reloaded_again = Tools::load_image(filename);
+    if (reloaded_again(0, 0, 0) != interleaved(0, 0, 0)) {
+        std::cout << "Writing to a loaded .htensor buffer changed the file\n";
+        abort();
+    }
+
+    // Write a tensor a few rows at a time, from strips that are not dense.
+    const int width = 37, height = 29, strip_height = 8;
+    filename = Internal::get_test_tmp_dir() + "test_streamed.htensor";
+    Tools::TensorWriter<Tools::Internal::CheckFail> writer(filename, halide_type_of<uint16_t>(), {width, height});
+    for (int y = 0; y < height; y += strip_height) {
+        Buffer<uint16_t> strip(width + 3, strip_height);
+        strip.crop(0, 0, width);
+        strip.crop(1, 0, std::min(strip_height, height - y));
+        strip.set_min(0, y);
+        strip.for_each_element([&](int x, int row) {
+            strip(x, row) = x + row * width;
+        });
+        writer.write(strip);
+    }
+    writer.finish();
+
+    Buffer<uint16_t> streamed = Tools::load_image(filename);
+    if (streamed.width() != width || streamed.height() != height) {
+        std::cout << "Streamed .htensor file has the wrong shape\n";
+        abort();
+    }
+    streamed.for_each_element([&](int x, int y) {
+        if (streamed(x, y) != x + y * width) {
+            std::cout << "streamed(" << x << ", " << y << ") = " << streamed(x, y)
+                      << " instead of " << x + y * width << "\n";
+            abort();
+        }
+    });
+
+    // A slab that would run past the end of the tensor is rejected.
+    filename = Internal::get_test_tmp_dir() + "test_overrun.htensor";
+    Tools::TensorWriter<Tools::Internal::CheckReturn> overrun(filename, halide_type_of<uint16_t>(), {width, height});
+    Buffer<uint16_t> too_tall(width, height + 1);
+    too_tall.fill(0);
+    if (overrun.write(too_tall)) {
+        std::cout << "TensorWriter accepted a slab past the end of the tensor\n";
+        abort();
+    }
+
+    // Empty buffers can be saved and loaded again.
+    filename = Internal::get_test_tmp_dir() + "test_empty.htensor";
+    Buffer<float> empty(0, 5);
+    Tools::save_image(empty, filename);
+    Buffer<float> empty_reloaded = Tools::load_image(filename);
+    if (empty_reloaded.dimensions() != 2 ||
+        empty_reloaded.dim(0).extent() != 0 ||
+        empty_reloaded.dim(1).extent() != 5) {
+        std::cout << "Empty .htensor file has the wrong shape\n";
+        abort();
+    }
+}
+
 int main(int argc, char **argv) {
     do_test<uint8_t>();
     do_test<uint16_t>();
     test_mat_header();
+    test_htensor();
     printf("Success!\n");
     return 0;
 }
@@ -0,0 +1,102 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+Func f, g;
+Var x, y;
+Param<int> mode;
+ImageParam in(Int(32), 2);
+
+bool run(const Target &t, const Buffer<int> &input) {
+    Buffer<int> out = g.realize(100, 50, t);
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            int correct = (input(x, y) * 3 + x) + (input(x + 1, y) * 3 + x + 1) - y;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly JIT does not support lazy_jit.\n");
+        return 0;
+    }
+    if (get_llvm_version() < 110) {
+        printf("[SKIP] lazy_jit requires LLVM 11 or later.\n");
+        return 0;
+    }
+    t.set_feature(Target::LazyJIT);
+
+    // A pipeline with several specializations, each of which has its
+    // own parallel loop body. Only the ones that run get compiled.
+    f(x, y) = in(x, y) * 3 + x;
+    g(x, y) = f(x, y) + f(x + 1, y) - y;
+
+    f.compute_root().parallel(y);
+    g.parallel(y).vectorize(x, 8, TailStrategy::GuardWithIf);
+    for (int i = 0; i < 4; i++) {
+        g.specialize(mode == i).parallel(y).vectorize(x, 4 << i, TailStrategy::GuardWithIf);
+    }
+
+    g.compile_jit(t);
+
+    Buffer<int> input(101, 50);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = x * 7 + y * 13;
+    });
+    in.set(input);
+
+    // The first call compiles the entry point, f, and the path taken.
+    const uint64_t before = JITModule::num_lazily_compiled_functions();
+    mode.set(0);
+    if (!run(t, input)) {
+        return -1;
+    }
+    const uint64_t after_first = JITModule::num_lazily_compiled_functions();
+    if (after_first == before) {
+        printf("Nothing was compiled lazily\n");
+        return -1;
+    }
+
+    // Taking the same path again compiles nothing more.
+    if (!run(t, input)) {
+        return -1;
+    }
+    if (JITModule::num_lazily_compiled_functions() != after_first) {
+        printf("Running the same path again compiled more functions\n");
+        return -1;
+    }
+
+    // Each path not taken so far has a loop body that was never compiled,
+    // and is compiled the first time the path runs, and only then.
+    uint64_t compiled = after_first;
+    for (int i = 1; i < 5; i++) {
+        mode.set(i);
+        for (int j = 0; j < 2; j++) {
+            if (!run(t, input)) {
+                return -1;
+            }
+            const uint64_t now = JITModule::num_lazily_compiled_functions();
+            if (j == 0 && now == compiled) {
+                printf("The loop body of path %d was compiled before it ran\n", i);
+                return -1;
+            }
+            if (j == 1 && now != compiled) {
+                printf("Running path %d again compiled more functions\n", i);
+                return -1;
+            }
+            compiled = now;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the loads from a buffer done inside the innermost serial loop
+// over rows.
+class CountLoadsInRowLoop : public IRMutator {
+    using IRMutator::visit;
+
+    bool in_row_loop = false;
+
+    Stmt visit(const For *op) override {
+        bool old = in_row_loop;
+        in_row_loop = in_row_loop || ends_with(op->name, ".yo");
+        Stmt s = IRMutator::visit(op);
+        in_row_loop = old;
+        return s;
+    }
+
+    Expr visit(const Load *op) override {
+        if (in_row_loop && op->name == buffer) {
+            count++;
+        }
+        return IRMutator::visit(op);
+    }
+
+public:
+    std::string buffer;
+    int count = 0;
+
+    CountLoadsInRowLoop(const std::string &b)
+        : buffer(b) {
+    }
+};
+
+int run_test(const Target &t, Buffer<uint16_t> in, Buffer<uint16_t> &out) {
+    ImageParam input(UInt(16), 2, "input");
+    Var x, y, xo, xi, yo, yi;
+
+    // A vertical stencil, unrolled over two rows of output and walking
+    // down columns of vectors, so that each input row loaded can be
+    // reused by the next iteration of the loop over rows.
+    Func blur_y;
+    blur_y(x, y) = input(x, y) + input(x, y + 1) + input(x, y + 2);
+    blur_y.split(x, xo, xi, 8)
+        .split(y, yo, yi, 2)
+        .reorder(xi, yi, yo, xo)
+        .vectorize(xi)
+        .unroll(yi);
+
+    CountLoadsInRowLoop *counter = new CountLoadsInRowLoop("input");
+    blur_y.add_custom_lowering_pass(counter);
+
+    input.set(in);
+    out = blur_y.realize(out.width(), out.height(), t);
+
+    return counter->count;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.has_gpu_feature()) {
+        printf("Not testing loop carrying on gpu targets\n");
+        printf("Success!\n");
+        return 0;
+    }
+
+    const int W = 64, H = 64;
+    Buffer<uint16_t> in(W, H + 2);
+    in.for_each_element([&](int x, int y) {
+        in(x, y) = (uint16_t)(rand() & 0xfff);
+    });
+
+    Buffer<uint16_t> without(W, H), with(W, H);
+    int loads_without = run_test(t.without_feature(Target::LoopCarry), in, without);
+    int loads_with = run_test(t.with_feature(Target::LoopCarry), in, with);
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            uint16_t correct = in(x, y) + in(x, y + 1) + in(x, y + 2);
+            if (without(x, y) != correct || with(x, y) != correct) {
+                printf("out(%d, %d) = %d, %d instead of %d\n",
+                       x, y, without(x, y), with(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    // Without carrying, each iteration loads four input rows. With it,
+    // only the two new rows should be loaded.
+    if (loads_with >= loads_without) {
+        printf("Expected fewer loads inside the loop over rows with loop carrying: %d vs %d\n",
+               loads_with, loads_without);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include "Halide.h"
+#include <atomic>
+#include <stdio.h>
+
+using namespace Halide;
+
+// Count calls to Halide's malloc and free. These may be called from
+// several threads at once.
+std::atomic<int> mallocs{0}, frees{0};
+
+void *my_malloc(void *user_context, size_t x) {
+    mallocs++;
+    void *orig = malloc(x + 64);
+    void *ptr = (void *)((((size_t)orig + 64) >> 6) << 6);
+    ((void **)ptr)[-1] = orig;
+    return ptr;
+}
+
+void my_free(void *user_context, void *ptr) {
+    frees++;
+    free(((void **)ptr)[-1]);
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly JIT does not support set_custom_allocator().\n");
+        return 0;
+    }
+
+    const int W = 1000, H = 256;
+
+    // A temporary computed per row of a parallel loop, with a size
+    // that depends on the output. Without pooling this would call
+    // halide_malloc once per row.
+    Var x, y;
+    Func f, g;
+    f(x, y) = x * 3 + y;
+    g(x, y) = f(x - 1, y) + f(x + 1, y);
+    f.compute_at(g, y);
+    g.parallel(y);
+
+    g.set_custom_allocator(my_malloc, my_free);
+
+    Buffer<int> out(W, H);
+    g.realize(out, t.with_feature(Target::PoolParallelAllocations));
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int correct = (x - 1) * 3 + y + (x + 1) * 3 + y;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    if (mallocs != frees) {
+        printf("%d calls to malloc but %d calls to free\n", (int)mallocs, (int)frees);
+        return -1;
+    }
+
+    if (mallocs >= H / 2) {
+        printf("Expected the per-row temporaries to reuse memory, "
+               "but there were %d calls to malloc for %d rows\n",
+               (int)mallocs, H);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -484,6 +484,10 @@ public:
             check("vpcmpeqq*ymm", 4, select(i64_1 == i64_2, i64(1), i64(2)));
             check("vpackusdw*ymm", 16, u16(clamp(i32_1, 0, max_u16)));
             check("vpcmpgtq*ymm", 4, select(i64_1 > i64_2, i64(1), i64(2)));
+
+            // Loads with data-dependent indices, e.g. lookup tables
+            check("vpgather", 8, in_i32(i32(u8_1)));
+            check("vgather", 8, in_f32(i32(u8_1)));
         }
 
         if (use_avx512) {
@@ -508,6 +512,9 @@ public:
             check("vpminuq", 8, min(u64_1, u64_2));
             check("vpmaxsq", 8, max(i64_1, i64_2));
             check("vpminsq", 8, min(i64_1, i64_2));
+
+            check("vpgather*zmm", 16, in_i32(i32(u8_1)));
+            check("vgather*zmm", 8, in_f64(i32(u8_1)));
         }
     }
 
@@ -0,0 +1,118 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// NB: You must compile with -rdynamic for llvm to be able to find the appropriate symbols
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+int fast_path_count = 0;
+extern "C" DLLEXPORT int count_fast_path() {
+    fast_path_count++;
+    return 0;
+}
+
+// Count the if statements that test the extent of the output, and
+// record at runtime whenever the specialized branch of one is taken.
+class InstrumentShapeChecks : public IRMutator {
+    using IRMutator::visit;
+
+    Stmt visit(const IfThenElse *op) override {
+        if (!expr_uses_var(op->condition, "f.extent.0")) {
+            return IRMutator::visit(op);
+        }
+        count++;
+        Stmt then_case = mutate(op->then_case);
+        Stmt else_case = mutate(op->else_case);
+        Stmt mark = Evaluate::make(Call::make(Int(32), "count_fast_path", {}, Call::Extern));
+        return IfThenElse::make(op->condition, Block::make(mark, then_case), else_case);
+    }
+
+public:
+    int count = 0;
+};
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment().with_feature(Target::SpecializeOnEstimates);
+
+    const int W = 67, H = 33;
+
+    ImageParam input(Int(32), 2, "input");
+    input.dim(0).set_estimate(0, W + 2);
+    input.dim(1).set_estimate(0, H);
+
+    Var x, y;
+    Func g("g"), f("f");
+    g(x, y) = input(x, y) + input(x + 1, y) * 2;
+    f(x, y) = g(x, y) + input(x + 2, y);
+    f.set_estimate(x, 0, W).set_estimate(y, 0, H);
+    f.vectorize(x, 8, TailStrategy::GuardWithIf);
+    g.compute_root().vectorize(x, 8, TailStrategy::GuardWithIf);
+
+    InstrumentShapeChecks *checks = new InstrumentShapeChecks;
+    f.add_custom_lowering_pass(checks);
+    f.compile_jit(t);
+
+    // Both f and the intermediate g should be specialized.
+    if (checks->count < 2) {
+        printf("Expected f and g to be specialized on the estimated shapes, "
+               "but found %d shape checks\n",
+               checks->count);
+        return -1;
+    }
+
+    // The estimated shape should take the fast path. A different size,
+    // a strided input, or offset mins should all take the generic path.
+    struct Shape {
+        const char *name;
+        int out_w, out_h, in_stride, min_x;
+        bool fast;
+    } shapes[] = {
+        {"dense", W, H, W + 2, 0, true},
+        {"resized", W - 3, H + 5, W - 1, 0, false},
+        {"strided", W, H, W + 10, 0, false},
+        {"offset min", W, H, W + 2, 5, false},
+    };
+
+    for (const Shape &s : shapes) {
+        Buffer<int> in_storage(s.in_stride, s.out_h);
+        in_storage.for_each_element([&](int x, int y) {
+            in_storage(x, y) = x * 3 + y * 17;
+        });
+        Buffer<int> in = in_storage;
+        in.crop(0, 0, s.out_w + 2);
+        in.set_min(s.min_x, 0);
+        input.set(in);
+
+        Buffer<int> out(s.out_w, s.out_h);
+        out.set_min(s.min_x, 0);
+        fast_path_count = 0;
+        f.realize(out, t);
+
+        if ((fast_path_count > 0) != s.fast) {
+            printf("%s: expected the %s path to be taken\n",
+                   s.name, s.fast ? "specialized" : "generic");
+            return -1;
+        }
+
+        for (int y = 0; y < s.out_h; y++) {
+            for (int x = s.min_x; x < s.min_x + s.out_w; x++) {
+                int correct = in(x, y) + in(x + 1, y) * 2 + in(x + 2, y);
+                if (out(x, y) != correct) {
+                    printf("%s: out(%d, %d) = %d instead of %d\n",
+                           s.name, x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include "Halide.h"
+#include <chrono>
+#include <stdio.h>
+#include <thread>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly JIT does not support tiered_jit.\n");
+        return 0;
+    }
+    t.set_feature(Target::TieredJIT);
+
+    Func f, g;
+    Var x, y;
+    ImageParam in(Float(32), 2);
+
+    f(x, y) = in(x, y) * 2.0f + 1.0f;
+    g(x, y) = f(x, y) + f(x + 1, y) + f(x, y + 1);
+    f.compute_at(g, y).vectorize(x, 8);
+    g.parallel(y).vectorize(x, 8, TailStrategy::GuardWithIf);
+
+    Buffer<float> input(201, 101);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = (x * 3 + y * 5) % 17;
+    });
+    in.set(input);
+
+    // Results must be the same before, during and after the switch to
+    // the optimized code, so realize the pipeline for a while.
+    auto start = std::chrono::steady_clock::now();
+    int iterations = 0;
+    while (iterations < 10 || std::chrono::steady_clock::now() - start < std::chrono::milliseconds(500)) {
+        Buffer<float> out = g.realize(200, 100, t);
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                float correct = (input(x, y) * 2 + 1) + (input(x + 1, y) * 2 + 1) + (input(x, y + 1) * 2 + 1);
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %f instead of %f on iteration %d\n", x, y, out(x, y), correct, iterations);
+                    return -1;
+                }
+            }
+        }
+        iterations++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // Check that the background compile finishes and that the module
+    // then switches to the optimized code.
+    {
+        Target jit_target = t.with_feature(Target::JIT);
+        Module m = g.compile_to_module({in}, "tiered", jit_target);
+        Internal::JITModule module(m, m.get_function_by_name("tiered"));
+        void *quick = module.main_function();
+        auto start = std::chrono::steady_clock::now();
+        while (!module.optimized_tier_ready() &&
+               std::chrono::steady_clock::now() - start < std::chrono::seconds(60)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        if (!module.optimized_tier_ready()) {
+            printf("The optimized version was not ready after 60 seconds\n");
+            return -1;
+        }
+        if (module.main_function() == quick) {
+            printf("The optimized version is ready, but calls still go to the quick one\n");
+            return -1;
+        }
+
+        Buffer<float> out(200, 100);
+        const void *args[] = {input.raw_buffer(), out.raw_buffer()};
+        int result = module.argv_function()(args);
+        if (result != 0) {
+            printf("Calling the optimized version returned %d\n", result);
+            return -1;
+        }
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                float correct = (input(x, y) * 2 + 1) + (input(x + 1, y) * 2 + 1) + (input(x, y + 1) * 2 + 1);
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %f instead of %f in the optimized version\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// Vectorized loads and stores with data-dependent indices. On x86
+// these become hardware gathers (AVX2) and scatters (AVX-512).
+template<typename T>
+bool test() {
+    const int W = 256, N = 1024;
+
+    // A lookup table and a random permutation of its indices.
+    Buffer<T> lut(W);
+    Buffer<int> perm(W);
+    for (int i = 0; i < W; i++) {
+        lut(i) = (T)(rand() % 1000);
+        perm(i) = i;
+    }
+    for (int i = W - 1; i > 0; i--) {
+        std::swap(perm(i), perm(rand() % (i + 1)));
+    }
+    Buffer<uint8_t> idx(N);
+    for (int i = 0; i < N; i++) {
+        idx(i) = (uint8_t)(rand() % W);
+    }
+
+    Var x;
+
+    // Gather from the lookup table.
+    Func gathered;
+    gathered(x) = lut(cast<int>(idx(x))) * 2;
+    gathered.vectorize(x, 16);
+
+    // Scatter through the permutation. Indices are unique, so
+    // vectorizing the reduction is safe.
+    RDom r(0, W);
+    Func scattered;
+    scattered(x) = cast<T>(0);
+    scattered(clamp(perm(r), 0, W - 1)) = lut(r) + 1;
+    scattered.update().allow_race_conditions().vectorize(r, 16);
+
+    Buffer<T> g = gathered.realize(N);
+    Buffer<T> s = scattered.realize(W);
+
+    for (int i = 0; i < N; i++) {
+        T correct = lut(idx(i)) * 2;
+        if (g(i) != correct) {
+            printf("gathered(%d) = %f instead of %f\n", i, (double)g(i), (double)correct);
+            return false;
+        }
+    }
+    for (int i = 0; i < W; i++) {
+        T correct = lut(i) + 1;
+        if (s(perm(i)) != correct) {
+            printf("scattered(%d) = %f instead of %f\n", perm(i), (double)s(perm(i)), (double)correct);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (!test<int32_t>() ||
+        !test<float>() ||
+        !test<int64_t>() ||
+        !test<double>()) {
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+#include "parallel_batch.h"
+
+using namespace Halide::Runtime;
+
+// Batch items run in parallel, so errors may be reported concurrently.
+static std::atomic<int> errors{0};
+
+void my_halide_error(void *user_context, const char *msg) {
+    errors++;
+}
+
+int main(int argc, char **argv) {
+    halide_set_error_handler(&my_halide_error);
+
+    // Tiles of many different sizes.
+    const int batch_size = 37;
+    const float scale = 3.0f;
+    std::vector<Buffer<uint8_t>> inputs;
+    std::vector<Buffer<float>> outputs;
+    for (int i = 0; i < batch_size; i++) {
+        const int W = 1 + (i * 7) % 23, H = 1 + (i * 5) % 17;
+        Buffer<uint8_t> input(W, H);
+        input.for_each_element([&](int x, int y) { input(x, y) = (uint8_t)(x + y * W + i); });
+        inputs.push_back(input);
+        outputs.emplace_back(W, H);
+    }
+
+    std::vector<halide_buffer_t *> input_ptrs, output_ptrs;
+    for (int i = 0; i < batch_size; i++) {
+        input_ptrs.push_back(inputs[i].raw_buffer());
+        output_ptrs.push_back(outputs[i].raw_buffer());
+    }
+
+    int result = parallel_batch_batch(batch_size, input_ptrs.data(), scale, output_ptrs.data());
+    if (result != 0) {
+        printf("parallel_batch_batch failed: %d\n", result);
+        return -1;
+    }
+
+    for (int i = 0; i < batch_size; i++) {
+        Buffer<float> expected(inputs[i].width(), inputs[i].height());
+        if (parallel_batch(inputs[i], scale, expected) != 0) {
+            printf("parallel_batch failed\n");
+            return -1;
+        }
+        outputs[i].for_each_element([&](int x, int y) {
+            if (outputs[i](x, y) != expected(x, y) ||
+                expected(x, y) != inputs[i](x, y) * scale + x) {
+                printf("outputs[%d](%d, %d) = %f instead of %f\n",
+                       i, x, y, outputs[i](x, y), expected(x, y));
+                exit(-1);
+            }
+        });
+    }
+
+    // An empty batch does nothing.
+    result = parallel_batch_batch(0, nullptr, scale, nullptr);
+    if (result != 0) {
+        printf("Empty batch failed: %d\n", result);
+        return -1;
+    }
+
+    // An item that fails makes the whole batch fail.
+    Buffer<float> too_big(inputs[3].width() + 1, inputs[3].height());
+    output_ptrs[3] = too_big.raw_buffer();
+    result = parallel_batch_batch(batch_size, input_ptrs.data(), scale, output_ptrs.data());
+    if (result == 0 || errors == 0) {
+        printf("Expected an error from the batch\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,26 @@
+#include "Halide.h"
+
+namespace {
+
+class ParallelBatch : public Halide::Generator<ParallelBatch> {
+public:
+    Input<Buffer<uint8_t>> input{"input", 2};
+    Input<float> scale{"scale"};
+    Output<Buffer<float>> output{"output", 2};
+
+    void generate() {
+        Var x, y;
+
+        output(x, y) = input(x, y) * scale + x;
+
+        // The batch dispatcher runs the items in parallel, and each
+        // item has parallel loops of its own.
+        output.vectorize(x, natural_vector_size<float>(), TailStrategy::GuardWithIf).parallel(y);
+
+        assert(get_target().has_feature(Target::ParallelBatch));
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(ParallelBatch, parallel_batch)
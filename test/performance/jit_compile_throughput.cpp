@@ -0,0 +1,78 @@
+#include "Halide.h"
+#include "halide_benchmark.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+/** \file Test to measure how JIT compilation of independent pipelines
+ * scales with the number of threads compiling at once.
+ */
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+// Make and compile a small pipeline, different for each seed so that
+// no compilation can be reused.
+void compile_one(int seed) {
+    Var x, y;
+    ImageParam in(Int(32), 2);
+    Func f, g;
+    f(x, y) = in(clamp(x, 0, 99), clamp(y, 0, 99)) * (seed + 1) + x;
+    g(x, y) = f(x - 1, y) + f(x + 1, y) + f(x, y - 1) + f(x, y + 1) + seed;
+    f.compute_at(g, y).vectorize(x, 8);
+    g.vectorize(x, 8).parallel(y);
+    g.compile_jit();
+
+    Buffer<int32_t> input(100, 100);
+    input.fill(1);
+    in.set(input);
+    Buffer<int32_t> result = g.realize(16, 16);
+    int32_t correct = 4 * (seed + 1) + 4 * 8 + seed;
+    int32_t actual = result(8, 8);
+    if (actual != correct) {
+        printf("result(8, 8) = %d instead of %d\n", actual, correct);
+        exit(-1);
+    }
+}
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (target.arch == Target::WebAssembly) {
+        printf("[SKIP] Performance tests are meaningless and/or misleading under WebAssembly interpreter.\n");
+        return 0;
+    }
+
+    // Make the shared runtime up front, so that it isn't counted.
+    compile_one(0);
+
+    const int max_threads = std::max(1, std::min(16, (int)std::thread::hardware_concurrency()));
+    const int compiles_per_thread = 8;
+    int seed = 1;
+    double single_thread_rate = 0;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        auto start = benchmark_now();
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([=]() {
+                for (int i = 0; i < compiles_per_thread; i++) {
+                    compile_one(seed + t * compiles_per_thread + i);
+                }
+            });
+        }
+        for (auto &w : workers) {
+            w.join();
+        }
+        seed += threads * compiles_per_thread;
+        double elapsed = benchmark_duration_seconds(start, benchmark_now());
+        double rate = threads * compiles_per_thread / elapsed;
+        if (threads == 1) {
+            single_thread_rate = rate;
+        }
+        printf("%2d threads: %g compilations per second (%.2fx one thread)\n",
+               threads, rate, rate / single_thread_rate);
+    }
+
+    printf("Success!\n");
+    return 0;
+}
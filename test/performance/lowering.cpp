@@ -0,0 +1,56 @@
+#include "Halide.h"
+#include "halide_benchmark.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/** \file Test to measure how long it takes to lower a deep pipeline,
+ * which is dominated by making and freeing IR nodes. Run it again with
+ * HL_IR_NODE_POOL=0 to compare against allocating nodes from the heap.
+ */
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+Pipeline make_pipeline(int stages) {
+    Var x, y;
+    ImageParam in(Float(32), 2);
+    std::vector<Func> fs(stages);
+    fs[0](x, y) = in(x, y);
+    for (int i = 1; i < stages; i++) {
+        fs[i](x, y) = (fs[i - 1](x - 1, y) + fs[i - 1](x + 1, y) +
+                       fs[i - 1](x, y - 1) + fs[i - 1](x, y + 1)) *
+                      0.25f;
+        if (i % 4 == 0) {
+            fs[i].compute_root().vectorize(x, 8).parallel(y);
+        }
+    }
+    fs.back().vectorize(x, 8).parallel(y);
+    return Pipeline(fs.back());
+}
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (target.arch == Target::WebAssembly) {
+        printf("[SKIP] Performance tests are meaningless and/or misleading under WebAssembly interpreter.\n");
+        return 0;
+    }
+
+    const int stages = 64;
+    const int samples = 5;
+    double best = 1e10;
+    for (int i = 0; i < samples; i++) {
+        Pipeline p = make_pipeline(stages);
+        auto start = benchmark_now();
+        p.compile_to_module(p.infer_arguments(), "lowering", target);
+        best = std::min(best, benchmark_duration_seconds(start, benchmark_now()));
+    }
+
+    const char *pool = getenv("HL_IR_NODE_POOL");
+    printf("Lowering a %d stage pipeline took %f ms (HL_IR_NODE_POOL=%s)\n",
+           stages, best * 1e3, pool ? pool : "");
+
+    printf("Success!\n");
+    return 0;
+}
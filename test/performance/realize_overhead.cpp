@@ -18,6 +18,16 @@ int main(int argc, char **argv) {
         return 0;
     }
 
+    {
+        // The first compilation in a process also links the runtime.
+        auto start = benchmark_now();
+        Func f;
+        f() = 42;
+        f.realize();
+        double t = benchmark_duration_seconds(start, benchmark_now());
+        std::cout << "No argument Func first compile and realize time " << t * 1e3 << "ms.\n";
+    }
+
     {
         global_to_prevent_opt = argc;
         double t = benchmark([&]() { null_call(); });
@@ -94,7 +94,10 @@ bool test() {
 
 int main(int argc, char **argv) {
     Target target = get_jit_target_from_environment();
-    if (target.arch == Target::WebAssembly) {
+    if (target.arch == Target::WebAssembly &&
+        !(Internal::WasmModule::runs_native_code() && target.has_feature(Target::WasmSimd128))) {
+        // With a compiling wasm engine we can measure wasm SIMD, but
+        // not under the interpreter.
         printf("[SKIP] Performance tests are meaningless and/or misleading under WebAssembly interpreter.\n");
         return 0;
     }
@@ -67,6 +67,11 @@ Arguments:
     (We anticipate adding other image formats in the future, in particular,
     TIFF and TMP.)
 
+    For large inputs and outputs, use the raw HTENSOR format (files ending in
+    .htensor), which supports any type and number of dimensions. HTENSOR
+    inputs are memory-mapped rather than decoded and copied, and are not
+    converted if the type already matches.
+
     For inputs, there are also "pseudo-file" specifiers you can use; currently
     supported are
 
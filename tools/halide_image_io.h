@@ -5,6 +5,7 @@
 #define HALIDE_IMAGE_IO_H
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <cstdarg>
 #include <cstddef>
@@ -16,6 +17,10 @@
 #include <string>
 #include <vector>
 
+#ifdef HALIDE_IMAGE_IO_USE_THREADS
+#include <thread>
+#endif
+
 #ifndef HALIDE_NO_PNG
 #include "png.h"
 #endif
@@ -30,6 +35,14 @@
 #include "jpeglib.h"
 #endif
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "HalideBuffer.h"   // for AllocationHeader
 #include "HalideRuntime.h"  // for halide_type_t
 
 namespace Halide {
@@ -80,6 +93,39 @@ inline bool CheckReturn(bool condition, const char *msg) {
     return condition;
 }
 
+// Call f(lo, hi) on disjoint subranges that together cover [begin, end),
+// using as many threads as the machine has, provided that each thread gets
+// at least min_per_thread items. This uses std::thread, so it is only
+// enabled if HALIDE_IMAGE_IO_USE_THREADS is defined before this header is
+// included; otherwise it always runs on the calling thread.
+template<typename Fn>
+void parallel_for_range(int64_t begin, int64_t end, int64_t min_per_thread, Fn &&f) {
+    const int64_t n = end - begin;
+#ifdef HALIDE_IMAGE_IO_USE_THREADS
+    const int64_t threads = std::min((int64_t)std::thread::hardware_concurrency(),
+                                     n / std::max((int64_t)1, min_per_thread));
+    if (threads > 1) {
+        std::vector<std::thread> workers;
+        for (int64_t i = 1; i < threads; i++) {
+            const int64_t lo = begin + n * i / threads;
+            const int64_t hi = begin + n * (i + 1) / threads;
+            workers.emplace_back([lo, hi, &f]() { f(lo, hi); });
+        }
+        f(begin, begin + n / threads);
+        for (std::thread &w : workers) {
+            w.join();
+        }
+        return;
+    }
+#endif
+    if (n > 0) {
+        f(begin, end);
+    }
+}
+
+// The number of bytes that is worth handing to another thread.
+constexpr int64_t kMinBytesPerThread = 256 * 1024;
+
 template<typename To, typename From>
 To convert(const From &from);
 
@@ -703,21 +749,18 @@ struct FileOpener {
 template<typename ElemType, typename ImageType>
 void read_big_endian_row(const uint8_t *src, int y, ImageType *im) {
     auto im_typed = im->template as<ElemType>();
-    const int xmin = im_typed.dim(0).min();
-    const int xmax = im_typed.dim(0).max();
-    if (im_typed.dimensions() > 2) {
-        const int cmin = im_typed.dim(2).min();
-        const int cmax = im_typed.dim(2).max();
-        for (int x = xmin; x <= xmax; x++) {
-            for (int c = cmin; c <= cmax; c++) {
-                im_typed(x, y, c + cmin) = read_big_endian<ElemType>(src);
-                src += sizeof(ElemType);
-            }
-        }
-    } else {
-        for (int x = xmin; x <= xmax; x++) {
-            im_typed(x, y) = read_big_endian<ElemType>(src);
-            src += sizeof(ElemType);
+    const int width = im_typed.dim(0).extent();
+    const int channels = im_typed.dimensions() > 2 ? im_typed.dim(2).extent() : 1;
+    const int x_stride = im_typed.dim(0).stride();
+    const int c_stride = im_typed.dimensions() > 2 ? im_typed.dim(2).stride() : 0;
+    ElemType *dst = im_typed.data() + (int64_t)(y - im_typed.dim(1).min()) * im_typed.dim(1).stride();
+    // Walk each channel separately, so that the inner loop has constant
+    // strides and can be vectorized.
+    for (int c = 0; c < channels; c++) {
+        const uint8_t *s = src + c * sizeof(ElemType);
+        ElemType *d = dst + c * c_stride;
+        for (int x = 0; x < width; x++) {
+            d[x * x_stride] = read_big_endian<ElemType>(s + x * channels * sizeof(ElemType));
         }
     }
 }
@@ -727,23 +770,100 @@ void read_big_endian_row(const uint8_t *src, int y, ImageType *im) {
 template<typename ElemType, typename ImageType>
 void write_big_endian_row(const ImageType &im, int y, uint8_t *dst) {
     auto im_typed = im.template as<typename std::add_const<ElemType>::type>();
-    const int xmin = im_typed.dim(0).min();
-    const int xmax = im_typed.dim(0).max();
-    if (im_typed.dimensions() > 2) {
-        const int cmin = im_typed.dim(2).min();
-        const int cmax = im_typed.dim(2).max();
-        for (int x = xmin; x <= xmax; x++) {
-            for (int c = cmin; c <= cmax; c++) {
-                write_big_endian<ElemType>(im_typed(x, y, c), dst);
-                dst += sizeof(ElemType);
-            }
+    const int width = im_typed.dim(0).extent();
+    const int channels = im_typed.dimensions() > 2 ? im_typed.dim(2).extent() : 1;
+    const int x_stride = im_typed.dim(0).stride();
+    const int c_stride = im_typed.dimensions() > 2 ? im_typed.dim(2).stride() : 0;
+    const ElemType *src = im_typed.data() + (int64_t)(y - im_typed.dim(1).min()) * im_typed.dim(1).stride();
+    for (int c = 0; c < channels; c++) {
+        const ElemType *s = src + c * c_stride;
+        uint8_t *d = dst + c * sizeof(ElemType);
+        for (int x = 0; x < width; x++) {
+            write_big_endian<ElemType>(s[x * x_stride], d + x * channels * sizeof(ElemType));
         }
-    } else {
-        for (int x = xmin; x <= xmax; x++) {
-            write_big_endian<ElemType>(im_typed(x, y), dst);
-            dst += sizeof(ElemType);
+    }
+}
+
+// The number of rows of an image to read or write at once. Rows are
+// reshuffled in parallel a chunk at a time.
+inline int rows_per_chunk(size_t row_bytes) {
+    return (int)std::max((size_t)1, (size_t)(4 * kMinBytesPerThread) / std::max((size_t)1, row_bytes));
+}
+
+// Read the rows [ymin, ymax] of an image a chunk at a time. read_chunk(data,
+// rows) must fill data with the next 'rows' rows of row_bytes each, and then
+// process_row(row, y) is called on each of them, in parallel. Returns false
+// if read_chunk does.
+template<typename ReadFn, typename RowFn>
+bool read_rows_in_chunks(size_t row_bytes, int ymin, int ymax, ReadFn &&read_chunk, RowFn &&process_row) {
+    const int chunk_rows = rows_per_chunk(row_bytes);
+    const int64_t min_rows_per_thread = std::max((int64_t)1, kMinBytesPerThread / (int64_t)std::max((size_t)1, row_bytes));
+    std::vector<uint8_t> chunk;
+    for (int y = ymin; y <= ymax; y += chunk_rows) {
+        const int rows = std::min(chunk_rows, ymax - y + 1);
+        chunk.resize(rows * row_bytes);
+        if (!read_chunk(chunk.data(), rows)) {
+            return false;
+        }
+        parallel_for_range(0, rows, min_rows_per_thread, [&](int64_t lo, int64_t hi) {
+            for (int64_t i = lo; i < hi; i++) {
+                process_row(chunk.data() + i * row_bytes, y + (int)i);
+            }
+        });
+    }
+    return true;
+}
+
+// The inverse of read_rows_in_chunks: fill_row(row, y) is called in parallel
+// on each row of a chunk, and then write_chunk(data, rows) writes it out.
+template<typename RowFn, typename WriteFn>
+bool write_rows_in_chunks(size_t row_bytes, int ymin, int ymax, RowFn &&fill_row, WriteFn &&write_chunk) {
+    const int chunk_rows = rows_per_chunk(row_bytes);
+    const int64_t min_rows_per_thread = std::max((int64_t)1, kMinBytesPerThread / (int64_t)std::max((size_t)1, row_bytes));
+    std::vector<uint8_t> chunk;
+    for (int y = ymin; y <= ymax; y += chunk_rows) {
+        const int rows = std::min(chunk_rows, ymax - y + 1);
+        chunk.resize(rows * row_bytes);
+        parallel_for_range(0, rows, min_rows_per_thread, [&](int64_t lo, int64_t hi) {
+            for (int64_t i = lo; i < hi; i++) {
+                fill_row(chunk.data() + i * row_bytes, y + (int)i);
+            }
+        });
+        if (!write_chunk(chunk.data(), rows)) {
+            return false;
         }
     }
+    return true;
+}
+
+// Read size bytes at the given offset of a file, using several threads for
+// large reads. Storage that can serve more than one request at a time (an
+// SSD, or a network file system) delivers more bandwidth this way.
+inline bool read_bytes_at(FileOpener &f, uint64_t offset, void *data, size_t size) {
+#ifndef _WIN32
+    const int fd = fileno(f.f);
+    std::atomic<bool> ok(true);
+    const int64_t block = 4 * kMinBytesPerThread;
+    const int64_t blocks = (size + block - 1) / block;
+    parallel_for_range(0, blocks, 4, [&](int64_t lo, int64_t hi) {
+        for (int64_t b = lo; b < hi && ok; b++) {
+            const size_t begin = b * block;
+            const size_t end = std::min((size_t)((b + 1) * block), size);
+            size_t done = begin;
+            while (done < end) {
+                ssize_t r = pread(fd, (uint8_t *)data + done, end - done, offset + done);
+                if (r <= 0) {
+                    ok = false;
+                    break;
+                }
+                done += r;
+            }
+        }
+    });
+    return ok;
+#else
+    return fseek(f.f, (long)offset, SEEK_SET) == 0 && f.read_bytes(data, size);
+#endif
 }
 
 #ifndef HALIDE_NO_PNG
@@ -804,13 +924,21 @@ bool load_png(const std::string &filename, ImageType *im) {
                              Internal::read_big_endian_row<uint8_t, ImageType> :
                              Internal::read_big_endian_row<uint16_t, ImageType>;
 
-    std::vector<uint8_t> row(png_get_rowbytes(png_ptr, info_ptr));
-    const int ymin = im->dim(1).min();
-    const int ymax = im->dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        png_read_row(png_ptr, row.data(), nullptr);
-        copy_to_image(row.data(), y, im);
-    }
+    // Decoding is inherently serial, but the rows are reshuffled into the
+    // image in parallel.
+    const size_t row_bytes = png_get_rowbytes(png_ptr, info_ptr);
+    std::vector<png_bytep> row_pointers;
+    Internal::read_rows_in_chunks(
+        row_bytes, im->dim(1).min(), im->dim(1).max(),
+        [&](uint8_t *data, int rows) {
+            row_pointers.resize(rows);
+            for (int i = 0; i < rows; i++) {
+                row_pointers[i] = data + i * row_bytes;
+            }
+            png_read_rows(png_ptr, row_pointers.data(), nullptr, rows);
+            return true;
+        },
+        [&](const uint8_t *row, int y) { copy_to_image(row, y, im); });
 
     png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
 
@@ -885,13 +1013,19 @@ bool save_png(ImageType &im, const std::string &filename) {
                                Internal::write_big_endian_row<uint8_t, ImageType> :
                                Internal::write_big_endian_row<uint16_t, ImageType>;
 
-    std::vector<uint8_t> row(png_get_rowbytes(png_ptr, info_ptr));
-    const int ymin = im.dim(1).min();
-    const int ymax = im.dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        copy_from_image(im, y, row.data());
-        png_write_row(png_ptr, row.data());
-    }
+    const size_t row_bytes = png_get_rowbytes(png_ptr, info_ptr);
+    std::vector<png_bytep> row_pointers;
+    Internal::write_rows_in_chunks(
+        row_bytes, im.dim(1).min(), im.dim(1).max(),
+        [&](uint8_t *row, int y) { copy_from_image(im, y, row); },
+        [&](uint8_t *data, int rows) {
+            row_pointers.resize(rows);
+            for (int i = 0; i < rows; i++) {
+                row_pointers[i] = data + i * row_bytes;
+            }
+            png_write_rows(png_ptr, row_pointers.data(), rows);
+            return true;
+        });
     png_write_end(png_ptr, NULL);
     png_destroy_write_struct(&png_ptr, &info_ptr);
 
@@ -958,17 +1092,12 @@ bool load_pnm(const std::string &filename, int channels, ImageType *im) {
                              Internal::read_big_endian_row<uint8_t, ImageType> :
                              Internal::read_big_endian_row<uint16_t, ImageType>;
 
-    std::vector<uint8_t> row(width * channels * (bit_depth / 8));
-    const int ymin = im->dim(1).min();
-    const int ymax = im->dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        if (!check(f.read_vector(&row), "Could not read data")) {
-            return false;
-        }
-        copy_to_image(row.data(), y, im);
-    }
-
-    return true;
+    const size_t row_bytes = width * channels * (bit_depth / 8);
+    return check(Internal::read_rows_in_chunks(
+                     row_bytes, im->dim(1).min(), im->dim(1).max(),
+                     [&](uint8_t *data, int rows) { return f.read_bytes(data, rows * row_bytes); },
+                     [&](const uint8_t *row, int y) { copy_to_image(row, y, im); }),
+                 "Could not read data");
 }
 
 template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
@@ -997,17 +1126,12 @@ bool save_pnm(ImageType &im, const int channels, const std::string &filename) {
                                Internal::write_big_endian_row<uint8_t, ImageType> :
                                Internal::write_big_endian_row<uint16_t, ImageType>;
 
-    std::vector<uint8_t> row(width * channels * (bit_depth / 8));
-    const int ymin = im.dim(1).min();
-    const int ymax = im.dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        copy_from_image(im, y, row.data());
-        if (!check(f.write_vector(row), "Could not write data")) {
-            return false;
-        }
-    }
-
-    return true;
+    const size_t row_bytes = width * channels * (bit_depth / 8);
+    return check(Internal::write_rows_in_chunks(
+                     row_bytes, im.dim(1).min(), im.dim(1).max(),
+                     [&](uint8_t *row, int y) { copy_from_image(im, y, row); },
+                     [&](const uint8_t *data, int rows) { return f.write_bytes(data, rows * row_bytes); }),
+                 "Could not write data");
 }
 
 template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
@@ -1224,7 +1348,7 @@ bool load_tmp(const std::string &filename, ImageType *im) {
         return false;
     }
 
-    if (!check(f.read_bytes(im->begin(), im->size_in_bytes()), "Count not read .tmp payload")) {
+    if (!check(read_bytes_at(f, sizeof(header), im->begin(), im->size_in_bytes()), "Count not read .tmp payload")) {
         return false;
     }
 
@@ -1306,6 +1430,362 @@ bool save_tmp(ImageType &im, const std::string &filename) {
     return true;
 }
 
+// ".htensor" is a raw tensor format for large inputs and outputs. A file is
+// a TensorHeader, the shape of each dimension as a halide_dimension_t, and
+// then the payload, exactly as it is laid out in memory, starting at an
+// offset that is a multiple of the header's alignment (a page, by
+// default). Loading maps the file into memory and points the Buffer straight
+// at the payload, so nothing is decoded, copied or converted, and pages are
+// only read from disk when the pipeline touches them. The mapping is private,
+// so writes to the Buffer never reach the file. Fields are in native byte
+// order; the magic number will not match on a machine with the other order.
+constexpr uint32_t kTensorMagic = 0x534e5448;  // "HTNS"
+constexpr uint32_t kTensorVersion = 1;
+constexpr uint32_t kTensorDefaultAlignment = 4096;
+
+struct TensorHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint8_t type_code;
+    uint8_t type_bits;
+    uint16_t type_lanes;
+    int32_t dimensions;
+    uint32_t alignment;
+    uint32_t reserved;
+    uint64_t payload_offset;
+    uint64_t payload_bytes;
+};
+
+inline uint64_t tensor_payload_offset(int dimensions, uint32_t alignment) {
+    const uint64_t header_bytes = sizeof(TensorHeader) + dimensions * sizeof(halide_dimension_t);
+    return (header_bytes + alignment - 1) / alignment * alignment;
+}
+
+template<CheckFunc check = CheckReturn>
+bool read_tensor_header(FileOpener &f, TensorHeader *header, std::vector<halide_dimension_t> *shape) {
+    if (!check(f.read_bytes(header, sizeof(TensorHeader)), "Could not read .htensor header")) {
+        return false;
+    }
+    if (!check(header->magic == kTensorMagic && header->version == kTensorVersion,
+               "Bad magic number or version on .htensor file")) {
+        return false;
+    }
+    if (!check(header->dimensions >= 0 && header->dimensions <= 64 && header->alignment > 0 &&
+                   header->type_bits > 0 && header->type_lanes > 0,
+               "Bad header on .htensor file")) {
+        return false;
+    }
+    shape->resize(header->dimensions);
+    if (!check(f.read_vector(shape), "Could not read .htensor shape")) {
+        return false;
+    }
+    // Check that the payload covers every element of the shape. A tensor
+    // with a zero extent has no elements, and needs no payload.
+    uint64_t span = 1;
+    bool empty = false;
+    for (const halide_dimension_t &d : *shape) {
+        if (!check(d.extent >= 0 && d.stride >= 0, "Bad shape in .htensor file")) {
+            return false;
+        }
+        if (d.extent == 0) {
+            empty = true;
+        } else {
+            span += (uint64_t)(d.extent - 1) * d.stride;
+        }
+    }
+    if (empty) {
+        span = 0;
+    }
+    const uint64_t elem_bytes = ((header->type_bits + 7) / 8) * header->type_lanes;
+    if (!check(header->payload_offset >= tensor_payload_offset(header->dimensions, 1) &&
+                   header->payload_bytes >= span * elem_bytes,
+               "Bad payload size in .htensor file")) {
+        return false;
+    }
+    return true;
+}
+
+template<CheckFunc check = CheckReturn>
+bool write_tensor_header(FileOpener &f, halide_type_t type, const std::vector<halide_dimension_t> &shape,
+                         uint64_t payload_bytes, uint32_t alignment) {
+    TensorHeader header = {};
+    header.magic = kTensorMagic;
+    header.version = kTensorVersion;
+    header.type_code = type.code;
+    header.type_bits = type.bits;
+    header.type_lanes = type.lanes;
+    header.dimensions = (int32_t)shape.size();
+    header.alignment = alignment;
+    header.payload_offset = tensor_payload_offset(header.dimensions, alignment);
+    header.payload_bytes = payload_bytes;
+
+    std::vector<uint8_t> padding(header.payload_offset - sizeof(header) - shape.size() * sizeof(halide_dimension_t));
+    return check(f.write_bytes(&header, sizeof(header)) &&
+                     f.write_vector(shape) &&
+                     f.write_vector(padding),
+                 "Could not write .htensor header");
+}
+
+#ifndef _WIN32
+// The AllocationHeader of a Buffer that points into a memory-mapped
+// .htensor file. It unmaps the file when the last Buffer using it goes away.
+struct MappedTensorAllocation {
+    Halide::Runtime::AllocationHeader header;
+    void *addr;
+    size_t length;
+
+    static void unmap(void *ptr) {
+        MappedTensorAllocation *m = (MappedTensorAllocation *)ptr;
+        munmap(m->addr, m->length);
+        free(m);
+    }
+};
+
+// Map the payload of a .htensor file and point im at it. Returns false if
+// the file can't be mapped, in which case im is left unchanged.
+template<typename RuntimeImageType>
+bool map_tensor_payload(const std::string &filename, const TensorHeader &header, RuntimeImageType *im) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0 &&
+              (uint64_t)st.st_size >= header.payload_offset + header.payload_bytes;
+    void *addr = MAP_FAILED;
+    const size_t length = ok ? (size_t)st.st_size : 0;
+    if (ok) {
+        addr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+
+    MappedTensorAllocation *m = (MappedTensorAllocation *)malloc(sizeof(MappedTensorAllocation));
+    if (!m) {
+        munmap(addr, length);
+        return false;
+    }
+    new (&m->header) Halide::Runtime::AllocationHeader(MappedTensorAllocation::unmap);
+    m->addr = addr;
+    m->length = length;
+    im->adopt_host_allocation((uint8_t *)addr + header.payload_offset, &m->header);
+    return true;
+}
+#endif
+
+// Get the Halide::Runtime::Buffer inside a Halide::Buffer, or the
+// Halide::Runtime::Buffer itself.
+template<typename ImageType>
+auto runtime_buffer_of(ImageType *im, int) -> decltype(im->get()) {
+    return im->get();
+}
+
+template<typename ImageType>
+ImageType *runtime_buffer_of(ImageType *im, long) {
+    return im;
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool load_htensor(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    TensorHeader header;
+    std::vector<halide_dimension_t> shape;
+    {
+        FileOpener f(filename, "rb");
+        if (!check(f.f != nullptr, "File could not be opened for reading")) {
+            return false;
+        }
+        if (!read_tensor_header<check>(f, &header, &shape)) {
+            return false;
+        }
+    }
+
+    const halide_type_t im_type((halide_type_code_t)header.type_code, header.type_bits, header.type_lanes);
+    *im = ImageType(im_type, nullptr, (int)shape.size(), shape.data());
+    if (im->number_of_elements() == 0) {
+        // There is nothing to map or read.
+        return true;
+    }
+
+#ifndef _WIN32
+    if (map_tensor_payload(filename, header, runtime_buffer_of(im, 0))) {
+        im->set_host_dirty();
+        return true;
+    }
+#endif
+
+    // Mapping isn't available, so read the payload instead.
+    im->allocate();
+    FileOpener f(filename, "rb");
+    if (!check(f.f != nullptr && read_bytes_at(f, header.payload_offset, im->begin(), im->size_in_bytes()),
+               "Could not read .htensor payload")) {
+        return false;
+    }
+    im->set_host_dirty();
+    return true;
+}
+
+inline const std::set<FormatInfo> &query_htensor() {
+    // Any type and any number of dimensions.
+    static std::set<FormatInfo> info = []() {
+        std::set<FormatInfo> info;
+        const halide_type_t types[] = {
+            halide_type_t(halide_type_float, 16),
+            halide_type_t(halide_type_float, 32),
+            halide_type_t(halide_type_float, 64),
+            halide_type_t(halide_type_bfloat, 16),
+            halide_type_t(halide_type_uint, 1),
+            halide_type_t(halide_type_uint, 8),
+            halide_type_t(halide_type_int, 8),
+            halide_type_t(halide_type_uint, 16),
+            halide_type_t(halide_type_int, 16),
+            halide_type_t(halide_type_uint, 32),
+            halide_type_t(halide_type_int, 32),
+            halide_type_t(halide_type_uint, 64),
+            halide_type_t(halide_type_int, 64),
+        };
+        for (const halide_type_t &t : types) {
+            for (int d = 0; d <= 16; d++) {
+                info.insert({t, d});
+            }
+        }
+        return info;
+    }();
+    return info;
+}
+
+}  // namespace Internal
+
+// Writes a .htensor file incrementally, so that an output too large to hold
+// in memory can be produced and saved a piece at a time. The shape is fixed
+// up front, and the payload is written in dense planar order: each call to
+// write() appends the next slab of the outermost dimension, i.e. a buffer
+// with the full extent of every other dimension, whose min in the outermost
+// dimension is where the previous slab ended. For example:
+//
+//    TensorWriter w("out.htensor", halide_type_of<float>(), {width, height});
+//    for (int y = 0; y < height; y += 64) {
+//        Buffer<float> strip = pipeline.realize({width, std::min(64, height - y)});
+//        strip.set_min({0, y});
+//        w.write(strip);
+//    }
+//    w.finish();
+template<Internal::CheckFunc check = Internal::CheckReturn>
+class TensorWriter {
+public:
+    TensorWriter(const std::string &filename, halide_type_t type, const std::vector<int> &extents,
+                 uint32_t alignment = Internal::kTensorDefaultAlignment)
+        : f(filename, "wb"), type(type), extents(extents) {
+        ok = check(f.f != nullptr, "File could not be opened for writing") &&
+             check(alignment > 0, "Alignment of .htensor file must be positive");
+        if (!ok) {
+            return;
+        }
+
+        std::vector<halide_dimension_t> shape;
+        int64_t stride = 1;
+        for (int extent : extents) {
+            shape.emplace_back(0, extent, (int32_t)stride);
+            stride *= extent;
+        }
+        remaining = (uint64_t)stride * type.bytes();
+        ok = Internal::write_tensor_header<check>(f, type, shape, remaining, alignment);
+    }
+
+    // Append the next slab of the tensor. Returns false upon failure.
+    template<typename ImageType>
+    bool write(ImageType &slab) {
+        if (!ok) {
+            return false;
+        }
+        const int d = (int)extents.size();
+        bool shape_ok = slab.type() == type && slab.dimensions() == d;
+        for (int i = 0; shape_ok && i < d; i++) {
+            shape_ok = (i == d - 1) ? slab.dim(i).min() == next : (slab.dim(i).min() == 0 && slab.dim(i).extent() == extents[i]);
+        }
+        // The slab must also end within the outermost dimension. A
+        // zero-dimensional tensor is a single slab.
+        const int slab_extent = (d > 0) ? slab.dim(d - 1).extent() : 1;
+        const int total_extent = (d > 0) ? extents[d - 1] : 1;
+        shape_ok = shape_ok && (int64_t)next + slab_extent <= total_extent;
+        if (!check(shape_ok, "Slab does not match the shape of the .htensor file")) {
+            return ok = false;
+        }
+        if (slab.number_of_elements() > 0) {
+            slab.copy_to_host();
+            auto slab_d = slab.template as<const void>();
+            ok = Internal::write_planar_payload<decltype(slab_d), check>(slab_d, f);
+        }
+        next += slab_extent;
+        remaining -= (uint64_t)slab.number_of_elements() * slab.type().bytes();
+        return ok;
+    }
+
+    // Check that the whole tensor was written, and flush it. Returns false
+    // upon failure.
+    bool finish() {
+        if (!ok) {
+            return false;
+        }
+        ok = check(remaining == 0, "Not all of the .htensor payload was written") &&
+             check(fflush(f.f) == 0, "Could not write .htensor payload");
+        return ok;
+    }
+
+private:
+    Internal::FileOpener f;
+    const halide_type_t type;
+    const std::vector<int> extents;
+    bool ok = false;
+    int next = 0;
+    uint64_t remaining = 0;
+};
+
+namespace Internal {
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool save_htensor(ImageType &im, const std::string &filename) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    im.copy_to_host();
+
+    // If the buffer is dense, in any order of dimensions, write it as it is
+    // laid out in memory, so that it is loaded back with the same layout.
+    // An empty buffer goes through the writer, which gives it a valid shape
+    // and no payload.
+    bool dense = im.number_of_elements() > 0 &&
+                 im.size_in_bytes() == im.number_of_elements() * im.type().bytes();
+    for (int i = 0; i < im.dimensions(); i++) {
+        dense = dense && im.dim(i).stride() > 0;
+    }
+    if (dense) {
+        std::vector<halide_dimension_t> shape;
+        for (int i = 0; i < im.dimensions(); i++) {
+            shape.emplace_back(im.dim(i).min(), im.dim(i).extent(), im.dim(i).stride());
+        }
+        FileOpener f(filename, "wb");
+        if (!check(f.f != nullptr, "File could not be opened for writing")) {
+            return false;
+        }
+        return write_tensor_header<check>(f, im.type(), shape, im.size_in_bytes(), kTensorDefaultAlignment) &&
+               check(f.write_bytes(im.begin(), im.size_in_bytes()), "Could not write .htensor payload");
+    }
+
+    // Otherwise write it in planar order. The writer expects slabs with
+    // mins of zero.
+    std::vector<int> extents;
+    auto slab = im;
+    for (int i = 0; i < im.dimensions(); i++) {
+        extents.push_back(im.dim(i).extent());
+        slab.translate(i, -im.dim(i).min());
+    }
+    TensorWriter<check> w(filename, im.type(), extents);
+    return w.write(slab) && w.finish();
+}
+
 // ".mat" is the matlab level 5 format documented here:
 // http://www.mathworks.com/help/pdf_doc/matlab/matfile_format.pdf
 
@@ -1458,7 +1938,7 @@ bool load_mat(const std::string &filename, ImageType *im) {
         return false;
     }
 
-    if (!check(f.read_bytes(im->begin(), im->size_in_bytes()), "Could not read .tmp payload")) {
+    if (!check(read_bytes_at(f, (uint64_t)ftell(f.f), im->begin(), im->size_in_bytes()), "Could not read .tmp payload")) {
         return false;
     }
 
@@ -1985,6 +2465,7 @@ bool find_imageio(const std::string &filename, ImageIO<ImageType, check> *result
 #endif
         {"ppm", {load_ppm<ImageType, check>, save_ppm<ConstImageType, check>, query_ppm}},
         {"tmp", {load_tmp<ImageType, check>, save_tmp<ConstImageType, check>, query_tmp}},
+        {"htensor", {load_htensor<ImageType, check>, save_htensor<ConstImageType, check>, query_htensor}},
         {"mat", {load_mat<ImageType, check>, save_mat<ConstImageType, check>, query_mat}},
         {"tiff", {load_tiff<ImageType, check>, save_tiff<ConstImageType, check>, query_tiff}},
     };
@@ -2062,7 +2543,26 @@ struct ImageTypeConversion {
             dst_elem = Internal::convert<DstElemType>(src_elem);
         };
         // TODO: do we need src.copy_to_host() here?
-        dst.for_each_value(converter, src);
+        // Convert slices of the outermost dimension on separate threads. Within
+        // each, for_each_value runs a simple loop over the innermost dimension,
+        // which the compiler can vectorize.
+        const int d = dst.dimensions() - 1;
+        if (d < 0 || dst.number_of_elements() == 0) {
+            dst.for_each_value(converter, src);
+        } else {
+            const int64_t slice_bytes = (int64_t)dst.number_of_elements() / dst.dim(d).extent() *
+                                        std::max(sizeof(SrcElemType), sizeof(DstElemType));
+            const int64_t min_slices_per_thread = std::max((int64_t)1, Internal::kMinBytesPerThread / std::max((int64_t)1, slice_bytes));
+            Internal::parallel_for_range(dst.dim(d).min(), dst.dim(d).max() + 1, min_slices_per_thread,
+                                         [&](int64_t lo, int64_t hi) {
+                                             // Halide::Buffer has no cropped(), so crop shallow copies.
+                                             DstImageType dst_slices = dst;
+                                             SrcImageType src_slices = src;
+                                             dst_slices.crop(d, (int)lo, (int)(hi - lo));
+                                             src_slices.crop(d, (int)lo, (int)(hi - lo));
+                                             dst_slices.for_each_value(converter, src_slices);
+                                         });
+        }
         dst.set_host_dirty();
 
         return dst;